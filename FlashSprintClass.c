@@ -0,0 +1,1350 @@
+/*
+ FlashSprint class engine (see FlashSprintClass.h)
+
+ Everything needed to schedule a whole class studying one shared deck:
+ deck content shared by all learners, compact per-learner state with idle
+ eviction, online Elo difficulties, the backlog catch-up planner and the
+ class-wide IRT fit, with the benchmarks that drive them.
+
+ Compile together with the console:
+   gcc -std=c11 -O2 -pthread -o flashcards FlashSprintConcole.c FlashSprintClass.c
+*/
+
+#define _GNU_SOURCE   // mkdtemp, pthread barriers, MAP_POPULATE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "FlashSprintClass.h"
+
+/* --- Shared deck content + per-learner scheduling overlays --- */
+/* Deck content (questions, answers, tags) is built once, frozen and shared by
+   every learner studying it. Cards are content-addressed: each card index has a
+   64-bit hash of its text, duplicate cards collapse to one index, and frozen
+   decks are interned by a hash over all card hashes so building the same deck
+   twice yields the same shared copy. Hashes only find candidates; the text is
+   compared before anything is merged. A learner holds only scheduling state for
+   the cards they have actually studied (see Learner below). Enrolling is one
+   allocation, whatever the deck size. */
+typedef struct DeckContent {
+    int refs;                  // owner + enrolled learners
+    int frozen;
+    uint32_t count, cap;
+    uint64_t *hash;            // content hash per card index
+    uint32_t *q_off, *a_off, *t_off;   // offsets into text; tags NUL-separated
+    uint8_t *tag_count;
+    char *text;
+    size_t text_used, text_cap;
+    uint32_t *lookup;          // content hash -> index + 1 (open addressing)
+    uint32_t lookup_mask;
+    uint64_t deck_hash;
+    struct DeckContent *next_interned;
+    _Atomic int32_t *difficulty;       // per card once frozen, see deck_difficulty
+    _Atomic uint32_t *reviews;         // pooled review count per card
+} DeckContent;
+
+static DeckContent *deck_registry = NULL;
+
+static DeckContent *deck_content_new(uint32_t cap_hint) {
+    DeckContent *d = calloc(1, sizeof(DeckContent));
+    d->refs = 1;
+    d->cap = cap_hint ? cap_hint : 64;
+    d->hash = malloc(sizeof(uint64_t) * d->cap);
+    d->q_off = malloc(sizeof(uint32_t) * d->cap);
+    d->a_off = malloc(sizeof(uint32_t) * d->cap);
+    d->t_off = malloc(sizeof(uint32_t) * d->cap);
+    d->tag_count = malloc(d->cap);
+    uint32_t slots = 16;
+    while (slots < d->cap * 2) slots <<= 1;
+    d->lookup = calloc(slots, sizeof(uint32_t));
+    d->lookup_mask = slots - 1;
+    d->text_cap = 4096;
+    d->text = malloc(d->text_cap);
+    return d;
+}
+
+static uint32_t deck_text_put(DeckContent *d, const char *s) {
+    size_t n = strlen(s) + 1;
+    while (d->text_used + n > d->text_cap) d->text_cap *= 2;
+    if (d->text_cap > UINT32_MAX) { fprintf(stderr, "deck text exceeds 4 GiB\n"); exit(1); }
+    d->text = realloc(d->text, d->text_cap);
+    memcpy(d->text + d->text_used, s, n);
+    uint32_t off = (uint32_t)d->text_used;
+    d->text_used += n;
+    return off;
+}
+
+static uint64_t card_content_hash(const char *q, const char *a, char **tags, int tag_count) {
+    uint64_t h = hash64_bytes(q, strlen(q) + 1, HASH64_SEED);
+    h = hash64_bytes(a, strlen(a) + 1, h);
+    for (int i = 0; i < tag_count; ++i) h = hash64_bytes(tags[i], strlen(tags[i]) + 1, h);
+    return h;
+}
+
+static void deck_lookup_insert(DeckContent *d, uint64_t h, uint32_t index) {
+    uint32_t i = (uint32_t)h & d->lookup_mask;
+    while (d->lookup[i]) i = (i + 1) & d->lookup_mask;
+    d->lookup[i] = index + 1;
+}
+
+static void deck_lookup_grow(DeckContent *d) {
+    uint32_t slots = (d->lookup_mask + 1) * 2;
+    free(d->lookup);
+    d->lookup = calloc(slots, sizeof(uint32_t));
+    d->lookup_mask = slots - 1;
+    for (uint32_t i = 0; i < d->count; ++i) deck_lookup_insert(d, d->hash[i], i);
+}
+
+/* a hash hit is only a candidate: the text decides */
+static int deck_card_same(const DeckContent *d, uint32_t idx, const char *q, const char *a,
+                          char **tags, int tag_count) {
+    if (d->tag_count[idx] != tag_count) return 0;
+    if (strcmp(d->text + d->q_off[idx], q) != 0 || strcmp(d->text + d->a_off[idx], a) != 0) return 0;
+    const char *t = d->text + d->t_off[idx];
+    for (int i = 0; i < tag_count; ++i) {
+        if (strcmp(t, tags[i]) != 0) return 0;
+        t += strlen(t) + 1;
+    }
+    return 1;
+}
+
+/* content-addressed lookup: index of the card with this content, or -1 */
+static int64_t deck_content_find(const DeckContent *d, uint64_t h, const char *q, const char *a,
+                                 char **tags, int tag_count) {
+    uint32_t i = (uint32_t)h & d->lookup_mask;
+    while (d->lookup[i]) {
+        uint32_t idx = d->lookup[i] - 1;
+        if (d->hash[idx] == h && deck_card_same(d, idx, q, a, tags, tag_count)) return idx;
+        i = (i + 1) & d->lookup_mask;
+    }
+    return -1;
+}
+
+/* add a card while building; identical content returns the existing index */
+static uint32_t deck_content_add(DeckContent *d, const char *q, const char *a,
+                                 char **tags, int tag_count) {
+    if (d->frozen) { fprintf(stderr, "deck content is frozen\n"); exit(1); }
+    if (tag_count > 255) tag_count = 255;
+    uint64_t h = card_content_hash(q, a, tags, tag_count);
+    int64_t found = deck_content_find(d, h, q, a, tags, tag_count);
+    if (found >= 0) return (uint32_t)found;
+    if (d->count == d->cap) {
+        d->cap *= 2;
+        d->hash = realloc(d->hash, sizeof(uint64_t) * d->cap);
+        d->q_off = realloc(d->q_off, sizeof(uint32_t) * d->cap);
+        d->a_off = realloc(d->a_off, sizeof(uint32_t) * d->cap);
+        d->t_off = realloc(d->t_off, sizeof(uint32_t) * d->cap);
+        d->tag_count = realloc(d->tag_count, d->cap);
+    }
+    uint32_t idx = d->count++;
+    d->hash[idx] = h;
+    d->q_off[idx] = deck_text_put(d, q);
+    d->a_off[idx] = deck_text_put(d, a);
+    d->t_off[idx] = (uint32_t)d->text_used;
+    for (int i = 0; i < tag_count; ++i) deck_text_put(d, tags[i]);
+    d->tag_count[idx] = (uint8_t)tag_count;
+    if (d->count * 2 > d->lookup_mask + 1) deck_lookup_grow(d);
+    else deck_lookup_insert(d, h, idx);
+    return idx;
+}
+
+static void deck_content_release(DeckContent *d) {
+    if (!d || --d->refs > 0) return;
+    for (DeckContent **pp = &deck_registry; *pp; pp = &(*pp)->next_interned)
+        if (*pp == d) { *pp = d->next_interned; break; }
+    free(d->hash); free(d->q_off); free(d->a_off); free(d->t_off);
+    free(d->tag_count); free(d->text); free(d->lookup);
+    free((void *)d->difficulty); free((void *)d->reviews);
+    free(d);
+}
+
+/* Two decks built from the same cards in the same order lay out their text
+   identically, so equal content is equal bytes. */
+static int deck_content_same(const DeckContent *x, const DeckContent *y) {
+    size_t n = x->count;
+    return x->count == y->count && x->text_used == y->text_used &&
+           memcmp(x->text, y->text, x->text_used) == 0 &&
+           memcmp(x->q_off, y->q_off, n * sizeof(uint32_t)) == 0 &&
+           memcmp(x->a_off, y->a_off, n * sizeof(uint32_t)) == 0 &&
+           memcmp(x->t_off, y->t_off, n * sizeof(uint32_t)) == 0 &&
+           memcmp(x->tag_count, y->tag_count, n) == 0;
+}
+
+/* Freeze a built deck and intern it: if the same content is already shared,
+   the new copy is dropped and the shared one is returned (retained). */
+static DeckContent *deck_content_freeze(DeckContent *d) {
+    uint64_t h = HASH64_SEED;
+    for (uint32_t i = 0; i < d->count; ++i) h = hash64_bytes(&d->hash[i], sizeof(uint64_t), h);
+    for (DeckContent *e = deck_registry; e; e = e->next_interned) {
+        if (e->deck_hash == h && deck_content_same(e, d)) {
+            deck_content_release(d);
+            e->refs++;
+            return e;
+        }
+    }
+    d->text = realloc(d->text, d->text_used ? d->text_used : 1);
+    d->text_cap = d->text_used;
+    d->deck_hash = h;
+    d->difficulty = calloc(d->count ? d->count : 1, sizeof(*d->difficulty));
+    d->reviews = calloc(d->count ? d->count : 1, sizeof(*d->reviews));
+    d->frozen = 1;
+    d->next_interned = deck_registry;
+    deck_registry = d;
+    return d;
+}
+
+static const char *deck_question(const DeckContent *d, uint32_t i) { return d->text + d->q_off[i]; }
+
+static size_t deck_content_bytes(const DeckContent *d) {
+    return sizeof(*d) + d->cap * (sizeof(uint64_t) + 3 * sizeof(uint32_t) + 1)
+         + d->text_cap + (d->lookup_mask + 1) * sizeof(uint32_t)
+         + (d->frozen ? d->count * (sizeof(int32_t) + sizeof(uint32_t)) : 0);
+}
+
+/* --- Online card difficulty (Elo) ---
+   Every shared deck keeps one difficulty per card, pooled over all learners
+   studying it, and every learner keeps an ability; both are logits, so a
+   learner of ability t answers a card of difficulty b correctly with
+   probability 1 / (1 + e^(b - t)). Each review nudges both towards the
+   outcome by K * (surprise), with K shrinking as a card collects reviews.
+   Card difficulties are fixed point in atomics and updated with fetch-add,
+   so learners on different threads review the same deck without locks; a
+   racing update can read a slightly stale difficulty, which only costs a
+   little of one step. */
+#define ELO_ONE 65536              // fixed point: difficulty units per logit
+#define ELO_CARD_K 0.8             // first-review step; K = ELO_CARD_K / (1 + n / 20)
+#define ELO_CARD_K_MIN 0.05
+#define ELO_LEARNER_K 0.3
+#define ELO_LEARNER_K_MIN 0.02
+
+/* e^x for |x| <= 30 without libm: 2^(x log2 e) as a power of two times a
+   polynomial for the remaining |fraction| <= 1/2 (relative error below 1e-6).
+   Branch-free, since the class fit calls it once per review per pass. */
+static double elo_exp(double x) {
+    x = x > 30 ? 30 : x < -30 ? -30 : x;
+    double y = x * 1.4426950408889634;
+    double n = (y + 6755399441055744.0) - 6755399441055744.0;   // round to nearest
+    double f = (y - n) * 0.6931471805599453;
+    double p = 1 + f * (1 + f * (1.0 / 2 + f * (1.0 / 6 + f * (1.0 / 24 + f * (1.0 / 120
+               + f * (1.0 / 720))))));
+    union { uint64_t u; double d; } scale = { (uint64_t)((int64_t)n + 1023) << 52 };
+    return p * scale.d;
+}
+
+/* probability that a learner of ability t recalls a card of difficulty b */
+static double elo_recall(double t, double b) { return 1 / (1 + elo_exp(b - t)); }
+
+/* logits to fixed point, rounded to nearest: truncating would drop the
+   small late-K steps of well-known cards and bias every step towards zero */
+static int32_t elo_fixed(double x) {
+    x *= ELO_ONE;
+    return (int32_t)(x < 0 ? x - 0.5 : x + 0.5);
+}
+
+static double deck_difficulty(const DeckContent *d, uint32_t i) {
+    return atomic_load_explicit(&d->difficulty[i], memory_order_relaxed) / (double)ELO_ONE;
+}
+
+/* Moves card i's difficulty after a review that the learner was expected to
+   pass with probability p. */
+static void deck_difficulty_update(DeckContent *d, uint32_t i, double p, int correct) {
+    uint32_t n = atomic_fetch_add_explicit(&d->reviews[i], 1, memory_order_relaxed);
+    double k = ELO_CARD_K / (1 + n / 20.0);
+    if (k < ELO_CARD_K_MIN) k = ELO_CARD_K_MIN;
+    double step = k * (p - (correct ? 1 : 0));
+    atomic_fetch_add_explicit(&d->difficulty[i], elo_fixed(step), memory_order_relaxed);
+}
+
+/* Up to k card indices in order of decreasing difficulty, cards with fewer
+   than min_reviews left out. */
+static uint32_t deck_hardest(const DeckContent *d, uint32_t min_reviews, uint32_t *out, uint32_t k) {
+    int32_t *key = malloc(sizeof(int32_t) * (k ? k : 1));
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < d->count; ++i) {
+        if (atomic_load_explicit(&d->reviews[i], memory_order_relaxed) < min_reviews) continue;
+        topk_offer(key, out, &n, k, atomic_load_explicit(&d->difficulty[i], memory_order_relaxed), i);
+    }
+    topk_sort(key, out, n);
+    free(key);
+    return n;
+}
+
+/* Per-learner scheduling state. Most learners have studied a few hundred of a
+   deck's cards, so the state starts sparse: the studied card indices, kept
+   sorted for binary search, with a packed due day and state word alongside
+   (8 bytes per card, one allocation). Once half the deck is studied a dense
+   array indexed by card is smaller, and the learner switches to it for good.
+   Days are counted from an arbitrary epoch chosen by the caller (e.g. days
+   since 1970); due days are stored as 16-bit offsets from the learner's first
+   review day. */
+#define LEARNER_BOXES 5
+#define LEARNER_BOX_BITS 3                                   // state = reviews << 3 | box
+#define LEARNER_MAX_REVIEWS (UINT16_MAX >> LEARNER_BOX_BITS) // reviews saturate here
+
+/* An append-only log of reviews for the class-wide fit (see class_fit). One
+   log per shard or thread; the learners writing to a log share its owner. */
+#define REVIEW_CORRECT 0x80000000u
+
+typedef struct ReviewEvent {
+    uint32_t learner;          // Learner id
+    uint32_t card;             // card index | REVIEW_CORRECT
+} ReviewEvent;
+
+typedef struct ReviewLog {
+    ReviewEvent *events;
+    size_t used, cap;
+} ReviewLog;
+
+static void review_log_append(ReviewLog *log, uint32_t learner, uint32_t card, int correct) {
+    if (log->used == log->cap) {
+        log->cap = log->cap ? log->cap * 2 : 1024;
+        log->events = realloc(log->events, sizeof(ReviewEvent) * log->cap);
+        if (!log->events) { perror("realloc"); exit(1); }
+    }
+    log->events[log->used++] = (ReviewEvent){learner, card | (correct ? REVIEW_CORRECT : 0)};
+}
+
+typedef struct Learner {
+    int id;
+    int dense;
+    DeckContent *deck;
+    uint32_t base;             // day that due offsets count from
+    uint32_t next_due;         // no studied card is due before this day
+    uint32_t used, cap;        // studied cards; sparse capacity
+    uint32_t *cards;           // sparse: sorted card indices; NULL when dense
+    uint16_t *due;             // due day - base, per entry (dense: per card)
+    uint16_t *state;           // per entry (dense: per card, 0 = unstudied)
+    uint8_t evicted;           // state arrays are only in the snapshot file
+    uint8_t dirty;             // changed since the snapshot was written
+    uint8_t snapshot;          // a snapshot file exists
+    double last_active;        // now_seconds() of the last review or due query
+    float ability;             // Elo ability in logits, against deck_difficulty
+    uint32_t answered;         // reviews counted towards ability
+    ReviewLog *log;            // if set, reviews are appended here (not owned)
+} Learner;
+
+static Learner *learner_enroll(DeckContent *deck, int id) {
+    Learner *l = calloc(1, sizeof(Learner));
+    l->id = id;
+    l->deck = deck;
+    l->next_due = UINT32_MAX;
+    deck->refs++;
+    return l;
+}
+
+static void learner_snapshot_path(const Learner *l, char *out, size_t cap, const char *suffix);
+
+static void learner_free(Learner *l) {
+    if (!l) return;
+    if (l->snapshot) {
+        char path[512];
+        learner_snapshot_path(l, path, sizeof(path), "");
+        unlink(path);
+    }
+    deck_content_release(l->deck);
+    free(l->dense ? (void *)l->due : (void *)l->cards);
+    free(l);
+}
+
+/* first sparse entry with a card index >= card */
+static uint32_t learner_lower_bound(const Learner *l, uint32_t card) {
+    uint32_t lo = 0, hi = l->used;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (l->cards[mid] < card) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+/* sparse: moves the entries into one block of cap entries */
+static void learner_sparse_grow(Learner *l, uint32_t cap) {
+    uint8_t *block = malloc((size_t)cap * (sizeof(uint32_t) + 2 * sizeof(uint16_t)));
+    if (!block) { perror("malloc"); exit(1); }
+    uint32_t *cards = (uint32_t *)block;
+    uint16_t *due = (uint16_t *)(cards + cap);
+    uint16_t *state = due + cap;
+    if (l->used) {
+        memcpy(cards, l->cards, sizeof(uint32_t) * l->used);
+        memcpy(due, l->due, sizeof(uint16_t) * l->used);
+        memcpy(state, l->state, sizeof(uint16_t) * l->used);
+    }
+    free(l->cards);
+    l->cards = cards;
+    l->due = due;
+    l->state = state;
+    l->cap = cap;
+}
+
+static void learner_densify(Learner *l) {
+    uint32_t count = l->deck->count;
+    uint16_t *block = calloc((size_t)count * 2, sizeof(uint16_t));
+    if (!block) { perror("calloc"); exit(1); }
+    for (uint32_t i = 0; i < l->used; ++i) {
+        block[l->cards[i]] = l->due[i];
+        block[count + l->cards[i]] = l->state[i];
+    }
+    free(l->cards);
+    l->cards = NULL;
+    l->due = block;
+    l->state = block + count;
+    l->cap = 0;
+    l->dense = 1;
+}
+
+/* entry for card, inserting an unstudied one if needed */
+static uint32_t learner_entry(Learner *l, uint32_t card) {
+    if (!l->dense) {
+        uint32_t i = learner_lower_bound(l, card);
+        if (i < l->used && l->cards[i] == card) return i;
+        // dense costs 4 bytes per deck card, sparse 8 per studied card
+        if ((uint64_t)(l->used + 1) * 2 < l->deck->count) {
+            if (l->used == l->cap) learner_sparse_grow(l, l->cap < 8 ? 8 : l->cap + l->cap / 2);
+            uint32_t tail = l->used - i;
+            memmove(l->cards + i + 1, l->cards + i, sizeof(uint32_t) * tail);
+            memmove(l->due + i + 1, l->due + i, sizeof(uint16_t) * tail);
+            memmove(l->state + i + 1, l->state + i, sizeof(uint16_t) * tail);
+            l->cards[i] = card;
+            l->due[i] = 0;
+            l->state[i] = 0;
+            l->used++;
+            return i;
+        }
+        learner_densify(l);
+    }
+    if (!l->state[card]) l->used++;
+    return card;
+}
+
+/* Idle learners are evicted to a snapshot file, leaving only the Learner
+   header resident, and rehydrated on their next review or due query. The
+   header keeps next_due, so asking an idle learner for due cards before that
+   day does not touch the disk. Snapshots are a cache of the daemon's memory:
+   written with rename for atomicity but not fsync'd. */
+#define LEARNER_SNAP_MAGIC "FSLRN1"
+#define LEARNER_SNAP_VERSION 1
+
+typedef struct LearnerSnapshot {
+    char magic[8];
+    uint32_t version;
+    int32_t id;
+    uint64_t deck_hash;
+    uint32_t deck_count;
+    uint32_t dense;
+    uint32_t base, next_due;
+    uint32_t used, entries;    // entries = used (sparse) or deck_count (dense)
+    uint64_t payload_hash;     // cards (sparse only), then due, then state
+} LearnerSnapshot;
+
+static const char *learner_snapshot_dir = ".";
+
+static void learner_snapshot_path(const Learner *l, char *out, size_t cap, const char *suffix) {
+    snprintf(out, cap, "%s/learner-%d.snap%s", learner_snapshot_dir, l->id, suffix);
+}
+
+/* the state arrays in file order; returns how many */
+static int learner_payload(const Learner *l, struct iovec *iov) {
+    uint32_t entries = l->dense ? l->deck->count : l->used;
+    int n = 0;
+    if (!l->dense) iov[n++] = (struct iovec){l->cards, sizeof(uint32_t) * entries};
+    iov[n++] = (struct iovec){l->due, sizeof(uint16_t) * entries};
+    iov[n++] = (struct iovec){l->state, sizeof(uint16_t) * entries};
+    return n;
+}
+
+/* Writes l's snapshot (unless the one on disk is current) and frees its state.
+   Returns 0, or -1 with l left resident. */
+static int learner_evict(Learner *l) {
+    if (l->evicted || l->used == 0) return 0;
+    if (l->dirty || !l->snapshot) {
+        char path[512], tmp[520];
+        learner_snapshot_path(l, path, sizeof(path), "");
+        learner_snapshot_path(l, tmp, sizeof(tmp), ".tmp");
+        struct iovec iov[4];
+        int n = learner_payload(l, iov + 1);
+        LearnerSnapshot h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, LEARNER_SNAP_MAGIC, sizeof(LEARNER_SNAP_MAGIC));
+        h.version = LEARNER_SNAP_VERSION;
+        h.id = l->id;
+        h.deck_hash = l->deck->deck_hash;
+        h.deck_count = l->deck->count;
+        h.dense = (uint32_t)l->dense;
+        h.base = l->base;
+        h.next_due = l->next_due;
+        h.used = l->used;
+        h.entries = l->dense ? l->deck->count : l->used;
+        h.payload_hash = HASH64_SEED;
+        size_t total = sizeof(h);
+        for (int i = 1; i <= n; ++i) {
+            h.payload_hash = hash64_bytes(iov[i].iov_base, iov[i].iov_len, h.payload_hash);
+            total += iov[i].iov_len;
+        }
+        iov[0] = (struct iovec){&h, sizeof(h)};
+        int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) { perror(tmp); return -1; }
+        ssize_t wrote = writev(fd, iov, n + 1);
+        close(fd);
+        if (wrote != (ssize_t)total || rename(tmp, path) != 0) {
+            perror(path);
+            unlink(tmp);
+            return -1;
+        }
+        l->snapshot = 1;
+        l->dirty = 0;
+    }
+    free(l->dense ? (void *)l->due : (void *)l->cards);
+    l->cards = NULL;
+    l->due = l->state = NULL;
+    l->cap = 0;
+    l->evicted = 1;
+    return 0;
+}
+
+/* Maps l's snapshot back into memory. A missing or damaged snapshot is
+   reported and the learner starts over empty rather than taking the
+   daemon down. */
+static void learner_wake(Learner *l) {
+    if (!l->evicted) return;
+    char path[512];
+    learner_snapshot_path(l, path, sizeof(path), "");
+    l->evicted = 0;
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    const uint8_t *map = MAP_FAILED;
+    if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(LearnerSnapshot))
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    if (fd >= 0) close(fd);
+    int ok = 0;
+    if (map != MAP_FAILED) {
+        LearnerSnapshot h;
+        memcpy(&h, map, sizeof(h));
+        size_t entry = h.dense ? 2 * sizeof(uint16_t) : sizeof(uint32_t) + 2 * sizeof(uint16_t);
+        ok = memcmp(h.magic, LEARNER_SNAP_MAGIC, sizeof(LEARNER_SNAP_MAGIC)) == 0 &&
+             h.version == LEARNER_SNAP_VERSION && h.id == l->id &&
+             h.deck_hash == l->deck->deck_hash && h.deck_count == l->deck->count &&
+             h.entries == (h.dense ? h.deck_count : h.used) &&
+             (uint64_t)st.st_size == sizeof(h) + (uint64_t)h.entries * entry &&
+             hash64_bytes(map + sizeof(h), (size_t)st.st_size - sizeof(h), HASH64_SEED) == h.payload_hash;
+        if (ok) {
+            l->dense = (int)h.dense;
+            l->base = h.base;
+            l->next_due = h.next_due;
+            l->used = h.used;
+            const uint8_t *p = map + sizeof(h);
+            if (l->dense) {
+                uint16_t *block = malloc(sizeof(uint16_t) * 2 * (size_t)h.entries);
+                if (!block) { perror("malloc"); exit(1); }
+                memcpy(block, p, sizeof(uint16_t) * 2 * (size_t)h.entries);
+                l->due = block;
+                l->state = block + h.entries;
+            } else {
+                uint32_t used = l->used;
+                l->used = 0;   // nothing for the grow to carry over
+                learner_sparse_grow(l, used < 8 ? 8 : used);
+                l->used = used;
+                memcpy(l->cards, p, sizeof(uint32_t) * used);
+                memcpy(l->due, p + sizeof(uint32_t) * used, sizeof(uint16_t) * used);
+                memcpy(l->state, p + (sizeof(uint32_t) + sizeof(uint16_t)) * used,
+                       sizeof(uint16_t) * used);
+            }
+        }
+        munmap((void *)map, (size_t)st.st_size);
+    }
+    if (!ok) {
+        fprintf(stderr, "%s: missing or damaged learner snapshot, state lost\n", path);
+        l->dense = 0;
+        l->used = 0;
+        l->next_due = UINT32_MAX;
+        l->snapshot = 0;
+    }
+}
+
+/* Evicts every learner not used since idle_since (a now_seconds() time);
+   returns how many were evicted. */
+static int learner_evict_idle(Learner **ls, int n, double idle_since) {
+    int evicted = 0;
+    for (int i = 0; i < n; ++i) {
+        if (ls[i]->evicted || ls[i]->used == 0 || ls[i]->last_active >= idle_since) continue;
+        if (learner_evict(ls[i]) == 0) evicted++;
+    }
+    return evicted;
+}
+
+/* One Elo step for the learner's ability and the card's pooled difficulty;
+   returns the recall predicted for the card's next review. */
+static double learner_elo(Learner *l, uint32_t card, int correct) {
+    DeckContent *d = l->deck;
+    double p = elo_recall(l->ability, deck_difficulty(d, card));
+    deck_difficulty_update(d, card, p, correct);
+    double k = ELO_LEARNER_K / (1 + l->answered / 50.0);
+    if (k < ELO_LEARNER_K_MIN) k = ELO_LEARNER_K_MIN;
+    l->ability += (float)(k * ((correct ? 1 : 0) - p));
+    l->answered++;
+    return elo_recall(l->ability, deck_difficulty(d, card));
+}
+
+/* Leitner step, same rule as the Flutter app: box up on correct, back to 0 on a
+   miss; the next review is 1 day out in box 0 and 2^(box-1) days after that.
+   The review also updates the card's pooled difficulty and the learner's
+   ability, and intervals past box 0 are scaled by 0.5 + the predicted recall,
+   so cards this learner finds easy come back later and hard ones sooner. */
+static void learner_review(Learner *l, uint32_t card, int correct, uint32_t today) {
+    if (card >= l->deck->count) return;
+    learner_wake(l);
+    l->last_active = now_seconds();
+    l->dirty = 1;
+    if (l->used == 0) l->base = today;
+    uint32_t i = learner_entry(l, card);
+    uint32_t reviews = l->state[i] >> LEARNER_BOX_BITS;
+    uint32_t box = l->state[i] & ((1u << LEARNER_BOX_BITS) - 1);
+    if (reviews < LEARNER_MAX_REVIEWS) reviews++;
+    if (correct) { if (box < LEARNER_BOXES - 1) box++; }
+    else box = 0;
+    uint32_t days = box == 0 ? 1 : 1u << (box - 1);
+    if (l->deck->difficulty) {
+        double p = learner_elo(l, card, correct);
+        if (box > 0) {
+            days = (uint32_t)(days * (0.5 + p) + 0.5);
+            if (days == 0) days = 1;
+        }
+    }
+    if (l->log) review_log_append(l->log, (uint32_t)l->id, card, correct);
+    uint32_t due = today + days;
+    uint32_t offset = due <= l->base ? 0 : due - l->base;
+    if (offset > UINT16_MAX) offset = UINT16_MAX;
+    l->due[i] = (uint16_t)offset;
+    l->state[i] = (uint16_t)(reviews << LEARNER_BOX_BITS | box);
+    if (l->base + offset < l->next_due) l->next_due = l->base + offset;
+}
+
+/* Studied cards due on or before today, in card order; unstudied cards are
+   new, not due. A scan that finds nothing due records the earliest due day,
+   so asking again before then costs nothing. */
+static int learner_due(Learner *l, uint32_t today, uint32_t *out, int max) {
+    l->last_active = now_seconds();
+    if (l->used == 0 || today < l->next_due) return 0;
+    learner_wake(l);
+    uint32_t limit = today - l->base > UINT16_MAX ? UINT16_MAX : today - l->base;
+    uint32_t earliest = UINT16_MAX;
+    int n = 0;
+    if (l->dense) {
+        for (uint32_t c = 0; c < l->deck->count && n < max; ++c) {
+            if (!l->state[c]) continue;
+            if (l->due[c] <= limit) out[n++] = c;
+            else if (l->due[c] < earliest) earliest = l->due[c];
+        }
+    } else {
+        for (uint32_t i = 0; i < l->used && n < max; ++i) {
+            if (l->due[i] <= limit) out[n++] = l->cards[i];
+            else if (l->due[i] < earliest) earliest = l->due[i];
+        }
+    }
+    if (n == 0) l->next_due = l->base + earliest;
+    return n;
+}
+
+static size_t learner_bytes(const Learner *l) {
+    size_t entries = l->evicted ? 0 : l->dense ? l->deck->count : l->cap;
+    return sizeof(*l) + entries * (l->dense ? 2 * sizeof(uint16_t)
+                                            : sizeof(uint32_t) + 2 * sizeof(uint16_t));
+}
+
+/* --- Backlog catch-up --- */
+/* After a break a learner can have thousands of overdue cards, and serving
+   them in due order spends the first days on cards long forgotten while
+   the ones still remembered slip further. learner_catch_up triages the
+   backlog instead: it ranks the overdue cards with a heap and reschedules
+   them from today at per_day a day, best first. The best days * per_day
+   make the plan; the rest are deferred past it at the same per_day, still
+   in rank order, so no day after the plan carries more than a planned day
+   does. Ranking takes one pass over the learner's due entries.
+
+   Ranking by retrievability estimates recall today on a power forgetting
+   curve, R = 1 / (1 + t / 9S), which is 0.9 when a card falls due: t is
+   the days since the last review and S the card's stability, its box
+   interval scaled the way learner_review scales it by the Elo recall
+   prediction. Cards most likely still remembered go first. Ranking by
+   overdue ratio (days overdue / box interval, smallest first) uses the
+   schedule alone. */
+typedef struct CatchUpPlan {
+    uint32_t overdue;          // cards due on or before today when planned
+    uint32_t days, per_day;    // per_day is the filled capacity when asked for 0
+    uint32_t planned;          // overdue cards placed on days 0..days-1
+    uint32_t deferred;         // overdue cards pushed past the plan, per_day a day
+    uint32_t *cards;           // overdue cards, best first, planned ones then
+                               // deferred; day d holds cards[d * per_day, (d + 1) * per_day)
+} CatchUpPlan;
+
+static void catch_up_plan_free(CatchUpPlan *p) {
+    free(p->cards);
+    p->cards = NULL;
+}
+
+/* Plans and applies a catch-up for every card due on or before today.
+   per_day 0 spreads the whole backlog evenly over days. */
+static void learner_catch_up(Learner *l, uint32_t today, uint32_t days, uint32_t per_day,
+                             int mode, CatchUpPlan *plan) {
+    memset(plan, 0, sizeof(*plan));
+    if (days == 0) days = 1;
+    plan->days = days;
+    if (l->used == 0 || today < l->base) return;
+    learner_wake(l);
+    l->last_active = now_seconds();
+    uint32_t limit = today - l->base > UINT16_MAX ? UINT16_MAX : today - l->base;
+    // every overdue card is ranked: the deferred ones keep their order too
+    uint32_t k = l->used;
+    int32_t *key = malloc(sizeof(int32_t) * k);
+    uint32_t *pick = malloc(sizeof(uint32_t) * k), n = 0;
+    uint32_t entries = l->dense ? l->deck->count : l->used;
+    for (uint32_t i = 0; i < entries; ++i) {
+        if (l->dense && !l->state[i]) continue;
+        if (l->due[i] > limit) continue;
+        uint32_t card = l->dense ? i : l->cards[i];
+        uint32_t box = l->state[i] & ((1u << LEARNER_BOX_BITS) - 1);
+        double interval = box == 0 ? 1 : 1u << (box - 1);
+        double stability = interval;
+        if (mode != CATCHUP_OVERDUE_RATIO && l->deck->difficulty)
+            stability *= 0.5 + elo_recall(l->ability, deck_difficulty(l->deck, card));
+        double score = catch_up_score(mode, limit - l->due[i], interval, stability);
+        plan->overdue++;
+        topk_offer(key, pick, &n, k, catch_up_key(score), i);
+    }
+    topk_sort(key, pick, n);
+    if (per_day == 0) per_day = (n + days - 1) / days;
+    if (per_day == 0) per_day = 1;
+    for (uint32_t r = 0; r < n; ++r) {
+        uint32_t day = limit + r / per_day;
+        l->due[pick[r]] = (uint16_t)(day > UINT16_MAX ? UINT16_MAX : day);
+        if (!l->dense) pick[r] = l->cards[pick[r]];
+    }
+    // nothing is due before today now: the overdue cards start at today and
+    // the rest were not overdue
+    if (plan->overdue > 0) l->next_due = l->base + limit;
+    l->dirty = l->dirty || plan->overdue > 0;
+    plan->per_day = per_day;
+    plan->planned = (uint64_t)per_day * days < n ? per_day * days : n;
+    plan->deferred = n - plan->planned;
+    plan->cards = pick;
+    free(key);
+}
+
+/* --- Class-wide difficulty fit (IRT) ---
+   The online Elo estimate only moves each card a little per review. The
+   batch fit below instead fits the same Rasch model, recall probability
+   1 / (1 + e^(b - t)), to every review in the class logs at once, by
+   alternating optimization: with difficulties fixed, each learner's ability
+   takes one Newton step over that learner's reviews; then, with abilities
+   fixed, each card's difficulty takes one over the card's reviews. A
+   standard-normal prior on both keeps learners or cards with all-correct
+   (or all-missed) histories finite. The review logs are first regrouped
+   into two sparse matrices, one with a row per learner and one with a row
+   per card, so each half-step is one parallel pass over contiguous rows.
+   Threads split the rows by review count and meet at a barrier between
+   half-steps. */
+#define FIT_MAX_ITERATIONS 30
+#define FIT_TOLERANCE 1e-3         // stop once no estimate moves more (logits)
+
+typedef struct FitRows {
+    uint32_t rows;
+    size_t *start;             // entries of row r: entry[start[r], start[r + 1])
+    uint32_t *entry;           // the other side's index | REVIEW_CORRECT
+} FitRows;
+
+typedef struct FitJob {
+    ReviewLog **logs;
+    int nlogs;
+    size_t *log_start;         // prefix over logs: global index of each log's first event
+    size_t total;
+    int threads;
+    uint32_t *hist;            // per thread: learner counts, then card counts
+    FitRows by_learner, by_card;
+    float *ability, *difficulty;
+    double max_step[2][SORT_MAX_THREADS];   // by iteration parity
+    int iterations;
+    pthread_barrier_t barrier;
+} FitJob;
+
+static const ReviewEvent *fit_event(const FitJob *job, size_t g, int *log) {
+    while (g >= job->log_start[*log + 1]) ++*log;
+    return &job->logs[*log]->events[g - job->log_start[*log]];
+}
+
+/* row range for thread t, balanced by entries */
+static void fit_split(const FitRows *m, int t, int threads, uint32_t *lo, uint32_t *hi) {
+    size_t total = m->start[m->rows];
+    uint32_t bounds[2];
+    for (int k = 0; k < 2; ++k) {
+        size_t target = total * (size_t)(t + k) / threads;
+        uint32_t a = 0, b = m->rows;
+        while (a < b) {
+            uint32_t mid = a + (b - a) / 2;
+            if (m->start[mid] < target) a = mid + 1; else b = mid;
+        }
+        bounds[k] = t + k == threads ? m->rows : a;
+    }
+    *lo = bounds[0];
+    *hi = bounds[1];
+}
+
+/* one Newton step for the row's own parameter x against the other side's
+   parameters; sign is +1 for abilities and -1 for difficulties */
+static double fit_step(const FitRows *m, uint32_t r, float *x, const float *other, double sign) {
+    double own = x[r], g = -own, h = 1;    // prior
+    for (size_t e = m->start[r]; e < m->start[r + 1]; ++e) {
+        uint32_t v = m->entry[e];
+        // recall probability: 1 / (1 + e^(difficulty - ability))
+        double p = 1 / (1 + elo_exp(sign * (other[v & ~REVIEW_CORRECT] - own)));
+        g += sign * ((v & REVIEW_CORRECT ? 1 : 0) - p);
+        h += p * (1 - p);
+    }
+    double step = g / h;
+    if (step > 1) step = 1;
+    if (step < -1) step = -1;
+    x[r] += (float)step;
+    return step < 0 ? -step : step;
+}
+
+static void *fit_worker(void *ctx, int t) {
+    FitJob *job = ctx;
+    uint32_t nl = job->by_learner.rows, nc = job->by_card.rows;
+    uint32_t *hist = job->hist + (size_t)t * (nl + nc);
+    size_t lo = job->total * t / job->threads, hi = job->total * (t + 1) / job->threads;
+    int log = 0;
+
+    // regroup this thread's slice of the logs: count, claim, scatter
+    for (size_t g = lo; g < hi; ++g) {
+        const ReviewEvent *ev = fit_event(job, g, &log);
+        if (ev->learner >= nl || (ev->card & ~REVIEW_CORRECT) >= nc) continue;
+        hist[ev->learner]++;
+        hist[nl + (ev->card & ~REVIEW_CORRECT)]++;
+    }
+    pthread_barrier_wait(&job->barrier);
+    if (t == 0) {
+        // row r's entries from thread t follow those from threads before it
+        FitRows *m[2] = {&job->by_learner, &job->by_card};
+        uint32_t base[2] = {0, nl};
+        for (int k = 0; k < 2; ++k) {
+            size_t at = 0;
+            for (uint32_t r = 0; r < m[k]->rows; ++r) {
+                m[k]->start[r] = at;
+                for (int u = 0; u < job->threads; ++u) {
+                    uint32_t *c = &job->hist[(size_t)u * (nl + nc) + base[k] + r];
+                    uint32_t n = *c;
+                    *c = (uint32_t)(at - m[k]->start[r]);
+                    at += n;
+                }
+            }
+            m[k]->start[m[k]->rows] = at;
+        }
+    }
+    pthread_barrier_wait(&job->barrier);
+    log = 0;
+    for (size_t g = lo; g < hi; ++g) {
+        const ReviewEvent *ev = fit_event(job, g, &log);
+        uint32_t card = ev->card & ~REVIEW_CORRECT, outcome = ev->card & REVIEW_CORRECT;
+        if (ev->learner >= nl || card >= nc) continue;
+        job->by_learner.entry[job->by_learner.start[ev->learner] + hist[ev->learner]++] = card | outcome;
+        job->by_card.entry[job->by_card.start[card] + hist[nl + card]++] = ev->learner | outcome;
+    }
+    pthread_barrier_wait(&job->barrier);
+
+    uint32_t l_lo, l_hi, c_lo, c_hi;
+    fit_split(&job->by_learner, t, job->threads, &l_lo, &l_hi);
+    fit_split(&job->by_card, t, job->threads, &c_lo, &c_hi);
+    for (int it = 0; it < FIT_MAX_ITERATIONS; ++it) {
+        double moved = 0, s;
+        for (uint32_t r = l_lo; r < l_hi; ++r)
+            if ((s = fit_step(&job->by_learner, r, job->ability, job->difficulty, 1)) > moved) moved = s;
+        pthread_barrier_wait(&job->barrier);
+        for (uint32_t r = c_lo; r < c_hi; ++r)
+            if ((s = fit_step(&job->by_card, r, job->difficulty, job->ability, -1)) > moved) moved = s;
+        job->max_step[it & 1][t] = moved;
+        pthread_barrier_wait(&job->barrier);
+        // every thread reaches the same verdict from the same slots
+        moved = 0;
+        for (int u = 0; u < job->threads; ++u)
+            if (job->max_step[it & 1][u] > moved) moved = job->max_step[it & 1][u];
+        if (t == 0) job->iterations = it + 1;
+        if (moved < FIT_TOLERANCE) break;
+    }
+    return NULL;
+}
+
+/* Fits abilities and difficulties to the events in logs, whose learner
+   fields index ls (learners with ids 0..nlearners-1). The results are
+   written back as each reviewed card's difficulty, which the scheduler and
+   deck_hardest read, and as each learner's ability; later reviews continue
+   from them online, at the step size of the card's fitted review count.
+   Returns the number of alternating iterations run. */
+static int class_fit(DeckContent *deck, Learner **ls, uint32_t nlearners,
+                     ReviewLog **logs, int nlogs, int threads) {
+    FitJob *job = calloc(1, sizeof(FitJob));
+    job->logs = logs;
+    job->nlogs = nlogs;
+    job->log_start = malloc(sizeof(size_t) * (nlogs + 1));
+    job->log_start[0] = 0;
+    for (int i = 0; i < nlogs; ++i) job->log_start[i + 1] = job->log_start[i] + logs[i]->used;
+    job->total = job->log_start[nlogs];
+    if (threads <= 0) threads = sort_threads(job->total);
+    if (threads > SORT_MAX_THREADS) threads = SORT_MAX_THREADS;
+    job->threads = threads;
+    uint32_t nc = deck->count;
+    job->hist = calloc((size_t)threads * (nlearners + nc), sizeof(uint32_t));
+    job->by_learner = (FitRows){nlearners, malloc(sizeof(size_t) * (nlearners + 1)),
+                                malloc(sizeof(uint32_t) * (job->total ? job->total : 1))};
+    job->by_card = (FitRows){nc, malloc(sizeof(size_t) * (nc + 1)),
+                             malloc(sizeof(uint32_t) * (job->total ? job->total : 1))};
+    job->ability = calloc(nlearners ? nlearners : 1, sizeof(float));
+    job->difficulty = calloc(nc ? nc : 1, sizeof(float));
+    if (!job->hist || !job->by_learner.entry || !job->by_card.entry) { perror("class_fit"); exit(1); }
+    pthread_barrier_init(&job->barrier, NULL, threads);
+    sort_run_threads(threads, fit_worker, job);
+    pthread_barrier_destroy(&job->barrier);
+
+    for (uint32_t c = 0; c < nc; ++c) {
+        size_t n = job->by_card.start[c + 1] - job->by_card.start[c];
+        if (n == 0) continue;
+        atomic_store_explicit(&deck->difficulty[c], elo_fixed(job->difficulty[c]),
+                              memory_order_relaxed);
+        if (atomic_load_explicit(&deck->reviews[c], memory_order_relaxed) < n)
+            atomic_store_explicit(&deck->reviews[c], (uint32_t)n, memory_order_relaxed);
+    }
+    for (uint32_t i = 0; i < nlearners; ++i) {
+        if (ls[i]->id < 0 || (uint32_t)ls[i]->id >= nlearners) continue;
+        uint32_t id = (uint32_t)ls[i]->id;
+        size_t n = job->by_learner.start[id + 1] - job->by_learner.start[id];
+        if (n == 0) continue;
+        ls[i]->ability = job->ability[id];
+        if (ls[i]->answered < n) ls[i]->answered = (uint32_t)n;
+    }
+    int iterations = job->iterations;
+    free(job->log_start); free(job->hist);
+    free(job->by_learner.start); free(job->by_learner.entry);
+    free(job->by_card.start); free(job->by_card.entry);
+    free(job->ability); free(job->difficulty);
+    free(job);
+    return iterations;
+}
+
+/* synthetic DSA-style deck used by the class benchmarks */
+static DeckContent *bench_build_deck(uint32_t cards) {
+    char q[128], a[128], t0[16], t1[16];
+    char *tags[2] = {t0, t1};
+    DeckContent *d = deck_content_new(cards);
+    for (uint32_t i = 0; i < cards; ++i) {
+        snprintf(q, sizeof(q), "Synthetic question %u about %s?", i,
+                 shard_tag_vocab[i % SHARD_TAG_VOCAB]);
+        snprintf(a, sizeof(a), "Synthetic answer %u", i);
+        snprintf(t0, sizeof(t0), "%s", shard_tag_vocab[i % SHARD_TAG_VOCAB]);
+        snprintf(t1, sizeof(t1), "%s", shard_tag_vocab[(i / 7) % SHARD_TAG_VOCAB]);
+        deck_content_add(d, q, a, tags, 2);
+    }
+    return deck_content_freeze(d);
+}
+
+int bench_class(int argc, char **argv) {
+    int learners = argc > 0 ? atoi(argv[0]) : 500;
+    uint32_t cards = argc > 1 ? (uint32_t)atoi(argv[1]) : 100000;
+    int studied = argc > 2 ? atoi(argv[2]) : 300;
+    if (learners <= 0) learners = 500;
+    if (cards == 0) cards = 100000;
+    if (studied < 0) studied = 0;
+
+    double t0 = now_seconds();
+    DeckContent *deck = bench_build_deck(cards);
+    double build = now_seconds() - t0;
+    DeckContent *again = bench_build_deck(cards);   // interned: same shared copy
+    printf("deck: %u cards, %.1f MB shared content, built in %.0f ms (rebuild shared: %s)\n",
+           deck->count, deck_content_bytes(deck) / 1e6, build * 1e3,
+           again == deck ? "yes" : "no");
+    deck_content_release(again);
+
+    Learner **ls = malloc(sizeof(Learner*) * learners);
+    t0 = now_seconds();
+    for (int i = 0; i < learners; ++i) ls[i] = learner_enroll(deck, i);
+    double enroll = now_seconds() - t0;
+
+    unsigned int rng = 88172645u;
+    for (int i = 0; i < learners; ++i) {
+        for (int k = 0; k < studied; ++k) {
+            rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+            learner_review(ls[i], rng % cards, (rng >> 8) % 4 != 0, 20000 + k / 50);
+        }
+    }
+    size_t overlay = 0, entries = 0;
+    int dense = 0;
+    for (int i = 0; i < learners; ++i) {
+        overlay += learner_bytes(ls[i]);
+        entries += ls[i]->used;
+        dense += ls[i]->dense;
+    }
+    printf("learners: %d (%d dense), enroll %.0f ns each, %.0f bytes/learner, %.1f bytes/studied card\n",
+           learners, dense, enroll / learners * 1e9, (double)overlay / learners,
+           entries ? (double)overlay / entries : 0.0);
+    printf("full copy per learner would be %.1f MB; learner state total %.1f MB\n",
+           (double)deck_content_bytes(deck) * learners / 1e6, overlay / 1e6);
+    uint32_t due[64];
+    const uint32_t today = 20000 + studied / 50;
+    size_t total_due = 0;
+    t0 = now_seconds();
+    for (int i = 0; i < learners; ++i) total_due += (size_t)learner_due(ls[i], today, due, 64);
+    double query = now_seconds() - t0;
+    printf("due queries: %.0f ns per learner (%.1f due each, up to 64)\n",
+           query / learners * 1e9, (double)total_due / learners);
+    int ndue = learner_due(ls[0], today, due, 8);
+    if (ndue > 0)
+        printf("learner 0: first due card #%u \"%s\"\n", due[0], deck_question(deck, due[0]));
+    for (int i = 0; i < learners; ++i) learner_free(ls[i]);
+    free(ls);
+    deck_content_release(deck);
+    return 0;
+}
+
+static uint64_t bench_learner_hash(const Learner *l) {
+    struct iovec iov[3];
+    int n = learner_payload(l, iov);
+    uint64_t h = hash64_bytes(&l->used, sizeof(l->used), HASH64_SEED);
+    for (int i = 0; i < n; ++i) h = hash64_bytes(iov[i].iov_base, iov[i].iov_len, h);
+    return h;
+}
+
+static int bench_double_cmp(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+int bench_evict(int argc, char **argv) {
+    int learners = argc > 0 ? atoi(argv[0]) : 100000;
+    uint32_t cards = argc > 1 ? (uint32_t)atoi(argv[1]) : 100000;
+    int studied = argc > 2 ? atoi(argv[2]) : 300;
+    int active_pct = argc > 3 ? atoi(argv[3]) : 5;
+    if (learners <= 0) learners = 100000;
+    if (cards == 0) cards = 100000;
+    if (studied < 1) studied = 1;
+    if (active_pct < 0 || active_pct > 100) active_pct = 5;
+
+    char dir[] = "/tmp/flashcards-evict-XXXXXX";
+    if (!mkdtemp(dir)) { perror("mkdtemp"); return 1; }
+    learner_snapshot_dir = dir;
+    DeckContent *deck = bench_build_deck(cards);
+    Learner **ls = malloc(sizeof(Learner*) * learners);
+    uint64_t *check = malloc(sizeof(uint64_t) * learners);
+    unsigned int rng = 88172645u;
+    for (int i = 0; i < learners; ++i) {
+        ls[i] = learner_enroll(deck, i);
+        for (int k = 0; k < studied; ++k) {
+            rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+            learner_review(ls[i], rng % cards, (rng >> 8) % 4 != 0, 20000 + k / 50);
+        }
+    }
+    size_t before = 0;
+    for (int i = 0; i < learners; ++i) {
+        before += learner_bytes(ls[i]);
+        check[i] = bench_learner_hash(ls[i]);
+    }
+
+    // the active share asks for its due cards after the cut-off; the rest idle
+    const uint32_t today = 20000 + studied / 50;
+    uint32_t due[64];
+    double cut = now_seconds();
+    for (int i = 0; i < learners; ++i)
+        if (i % 100 < active_pct) learner_due(ls[i], today, due, 64);
+    double t0 = now_seconds();
+    int evicted = learner_evict_idle(ls, learners, cut);
+    double evict = now_seconds() - t0;
+    size_t after = 0;
+    for (int i = 0; i < learners; ++i) after += learner_bytes(ls[i]);
+    printf("learners: %d, %d%% active; evicted %d in %.0f ms (%.1f us each)\n",
+           learners, active_pct, evicted, evict * 1e3, evicted ? evict / evicted * 1e6 : 0.0);
+    printf("resident learner state: %.1f MB -> %.1f MB (%.0f -> %.0f bytes/learner)\n",
+           before / 1e6, after / 1e6, (double)before / learners, (double)after / learners);
+
+    // rehydrate a sample of the evicted learners one at a time
+    int sample = 0, mismatched = 0;
+    double *lat = malloc(sizeof(double) * (evicted ? evicted : 1));
+    for (int i = 0; i < learners && sample < 10000; ++i) {
+        if (!ls[i]->evicted) continue;
+        t0 = now_seconds();
+        learner_wake(ls[i]);
+        lat[sample++] = now_seconds() - t0;
+        if (bench_learner_hash(ls[i]) != check[i]) mismatched++;
+    }
+    if (sample > 0) {
+        qsort(lat, sample, sizeof(double), bench_double_cmp);
+        double sum = 0;
+        for (int i = 0; i < sample; ++i) sum += lat[i];
+        printf("rehydrate (page cache): %d learners, mean %.1f us, p99 %.1f us, max %.1f us, %s\n",
+               sample, sum / sample * 1e6, lat[sample * 99 / 100] * 1e6,
+               lat[sample - 1] * 1e6, mismatched ? "MISMATCH" : "state intact");
+    }
+    free(lat);
+    free(check);
+    for (int i = 0; i < learners; ++i) learner_free(ls[i]);
+    free(ls);
+    deck_content_release(deck);
+    rmdir(dir);
+    return mismatched ? 1 : 0;
+}
+
+/* simulated class: true abilities and difficulties, outcomes drawn from them */
+typedef struct EloWorker {
+    Learner **learners;        // this worker's learners
+    int count;
+    const float *ability;      // true ability per learner in this worker's range
+    const float *difficulty;   // true difficulty per card
+    uint32_t cards;
+    long reviews;
+    uint64_t rng;
+} EloWorker;
+
+/* roughly normal, mean 0, standard deviation sd (sum of four uniforms) */
+static float bench_normalish(uint64_t *s, double sd) {
+    double u = 0;
+    for (int k = 0; k < 4; ++k) u += (bench_xorshift(s) >> 11) * (1.0 / 9007199254740992.0);
+    return (float)((u - 2) * 1.7320508 * sd);
+}
+
+static void *elo_worker_main(void *arg) {
+    EloWorker *w = arg;
+    for (long r = 0; r < w->reviews; ++r) {
+        uint64_t x = bench_xorshift(&w->rng);
+        int li = (int)(x % (uint64_t)w->count);
+        uint32_t card = (uint32_t)((x >> 20) % w->cards);
+        double p = elo_recall(w->ability[li], w->difficulty[card]);
+        int correct = (bench_xorshift(&w->rng) >> 11) * (1.0 / 9007199254740992.0) < p;
+        learner_review(w->learners[li], card, correct, 20000 + (uint32_t)(r / 100000));
+    }
+    return NULL;
+}
+
+/* fraction of sampled pairs that est orders the same way as truth */
+static double bench_concordance(const float *est, const float *truth, uint32_t n, uint64_t seed) {
+    long agree = 0, pairs = 0;
+    for (int k = 0; k < 1000000 && n > 1; ++k) {
+        uint32_t i = (uint32_t)(bench_xorshift(&seed) % n), j = (uint32_t)(bench_xorshift(&seed) % n);
+        if (truth[i] == truth[j] || est[i] == est[j]) continue;
+        agree += (truth[i] < truth[j]) == (est[i] < est[j]);
+        pairs++;
+    }
+    return pairs ? (double)agree / pairs : 0;
+}
+
+int bench_elo(int argc, char **argv) {
+    int learners = argc > 0 ? atoi(argv[0]) : 2000;
+    uint32_t cards = argc > 1 ? (uint32_t)atoi(argv[1]) : 20000;
+    long reviews = argc > 2 ? atol(argv[2]) : 4000000;
+    int threads = argc > 3 ? atoi(argv[3]) : 4;
+    if (learners <= 0) learners = 2000;
+    if (cards == 0) cards = 20000;
+    if (reviews <= 0) reviews = 4000000;
+    if (threads <= 0 || threads > 64) threads = 4;
+    if (threads > learners) threads = learners;
+
+    DeckContent *deck = bench_build_deck(cards);
+    cards = deck->count;
+    uint64_t rng = 0x2545f4914f6cdd1dull;
+    float *true_b = malloc(sizeof(float) * cards), *true_t = malloc(sizeof(float) * learners);
+    for (uint32_t i = 0; i < cards; ++i) true_b[i] = bench_normalish(&rng, 1.2);
+    for (int i = 0; i < learners; ++i) true_t[i] = 1.0f + bench_normalish(&rng, 1.0);
+    Learner **ls = malloc(sizeof(Learner*) * learners);
+    for (int i = 0; i < learners; ++i) ls[i] = learner_enroll(deck, i);
+
+    // each worker owns a contiguous range of learners; the deck is shared
+    EloWorker w[64];
+    pthread_t tid[64];
+    double t0 = now_seconds();
+    for (int t = 0; t < threads; ++t) {
+        int lo = (int)((long)learners * t / threads), hi = (int)((long)learners * (t + 1) / threads);
+        w[t] = (EloWorker){ls + lo, hi - lo, true_t + lo, true_b, cards,
+                           reviews / threads, 0x9e3779b97f4a7c15ull * (t + 1)};
+        if (pthread_create(&tid[t], NULL, elo_worker_main, &w[t]) != 0) {
+            fprintf(stderr, "elo: pthread_create failed\n");
+            exit(1);
+        }
+    }
+    for (int t = 0; t < threads; ++t) pthread_join(tid[t], NULL);
+    double run = now_seconds() - t0;
+    long done = reviews / threads * threads;
+    printf("elo bench: %d learners, %u cards, %ld reviews on %d threads: %.0f ns/review, %.1f M reviews/s\n",
+           learners, cards, done, threads, run / done * 1e9, done / run / 1e6);
+
+    float *est_b = malloc(sizeof(float) * cards), *est_t = malloc(sizeof(float) * learners);
+    long pooled = 0;
+    for (uint32_t i = 0; i < cards; ++i) {
+        est_b[i] = (float)deck_difficulty(deck, i);
+        pooled += atomic_load_explicit(&deck->reviews[i], memory_order_relaxed);
+    }
+    for (int i = 0; i < learners; ++i) est_t[i] = ls[i]->ability;
+    printf("  pooled reviews counted %ld of %ld; %.0f reviews per card\n",
+           pooled, done, (double)pooled / cards);
+    printf("  ordering agrees with truth: difficulty %.3f of card pairs, ability %.3f of learner pairs\n",
+           bench_concordance(est_b, true_b, cards, 7), bench_concordance(est_t, true_t, (uint32_t)learners, 11));
+
+    uint32_t top[100];
+    t0 = now_seconds();
+    uint32_t ntop = deck_hardest(deck, 20, top, 100);
+    double rank = now_seconds() - t0;
+    printf("  hardest 100 cards ranked in %.2f ms; top 3:\n", rank * 1e3);
+    for (uint32_t i = 0; i < ntop && i < 3; ++i)
+        printf("    #%u \"%s\" difficulty %.2f (true %.2f)\n", top[i],
+               deck_question(deck, top[i]), deck_difficulty(deck, top[i]), true_b[top[i]]);
+
+    for (int i = 0; i < learners; ++i) learner_free(ls[i]);
+    free(ls);
+    free(true_b); free(true_t); free(est_b); free(est_t);
+    deck_content_release(deck);
+    return 0;
+}
+
+int bench_irt(int argc, char **argv) {
+    int learners = argc > 0 ? atoi(argv[0]) : 20000;
+    uint32_t cards = argc > 1 ? (uint32_t)atoi(argv[1]) : 50000;
+    long reviews = argc > 2 ? atol(argv[2]) : 10000000;
+    int threads = argc > 3 ? atoi(argv[3]) : 0;
+    if (learners <= 0) learners = 20000;
+    if (cards == 0) cards = 50000;
+    if (reviews <= 0) reviews = 10000000;
+    enum { LOGS = 8 };
+
+    DeckContent *deck = bench_build_deck(cards);
+    cards = deck->count;
+    uint64_t rng = 0x2545f4914f6cdd1dull;
+    float *true_b = malloc(sizeof(float) * cards), *true_t = malloc(sizeof(float) * learners);
+    for (uint32_t i = 0; i < cards; ++i) true_b[i] = bench_normalish(&rng, 1.2);
+    for (int i = 0; i < learners; ++i) true_t[i] = 1.0f + bench_normalish(&rng, 1.0);
+    Learner **ls = malloc(sizeof(Learner*) * learners);
+    for (int i = 0; i < learners; ++i) ls[i] = learner_enroll(deck, i);
+
+    // learner i's reviews go to shard log i % LOGS; the online estimate
+    // follows the same stream for comparison
+    ReviewLog logs[LOGS] = {{0}};
+    ReviewLog *lp[LOGS];
+    for (int k = 0; k < LOGS; ++k) lp[k] = &logs[k];
+    double t0 = now_seconds();
+    for (long r = 0; r < reviews; ++r) {
+        uint64_t x = bench_xorshift(&rng);
+        int li = (int)(x % (uint64_t)learners);
+        uint32_t card = (uint32_t)((x >> 24) % cards);
+        double p = elo_recall(true_t[li], true_b[card]);
+        int correct = (bench_xorshift(&rng) >> 11) * (1.0 / 9007199254740992.0) < p;
+        review_log_append(&logs[li % LOGS], (uint32_t)li, card, correct);
+        learner_elo(ls[li], card, correct);
+    }
+    double online = now_seconds() - t0;
+    float *est_b = malloc(sizeof(float) * cards), *est_t = malloc(sizeof(float) * learners);
+    for (uint32_t i = 0; i < cards; ++i) est_b[i] = (float)deck_difficulty(deck, i);
+    for (int i = 0; i < learners; ++i) est_t[i] = ls[i]->ability;
+    printf("irt bench: %d learners, %u cards, %ld reviews in %d logs (%.0f MB)\n",
+           learners, cards, reviews, LOGS, reviews * sizeof(ReviewEvent) / 1e6);
+    printf("  online Elo: %.0f ns/review; agrees with truth on %.3f of card pairs, %.3f of learner pairs\n",
+           online / reviews * 1e9, bench_concordance(est_b, true_b, cards, 7),
+           bench_concordance(est_t, true_t, (uint32_t)learners, 11));
+
+    t0 = now_seconds();
+    int iterations = class_fit(deck, ls, (uint32_t)learners, lp, LOGS, threads);
+    double fit = now_seconds() - t0;
+    for (uint32_t i = 0; i < cards; ++i) est_b[i] = (float)deck_difficulty(deck, i);
+    for (int i = 0; i < learners; ++i) est_t[i] = ls[i]->ability;
+    double err = 0;
+    for (uint32_t i = 0; i < cards; ++i) err += est_b[i] > true_b[i] ? est_b[i] - true_b[i] : true_b[i] - est_b[i];
+    printf("  class fit: %.2f s, %d iterations on %d threads; agrees on %.3f of card pairs, %.3f of learner pairs\n",
+           fit, iterations, threads > 0 ? threads : sort_threads((size_t)reviews),
+           bench_concordance(est_b, true_b, cards, 7),
+           bench_concordance(est_t, true_t, (uint32_t)learners, 11));
+    printf("  mean |difficulty error| %.3f logits\n", err / cards);
+
+    uint32_t top[3];
+    uint32_t ntop = deck_hardest(deck, 20, top, 3);
+    for (uint32_t i = 0; i < ntop; ++i)
+        printf("    #%u \"%s\" difficulty %.2f (true %.2f)\n", top[i],
+               deck_question(deck, top[i]), deck_difficulty(deck, top[i]), true_b[top[i]]);
+
+    for (int k = 0; k < LOGS; ++k) free(logs[k].events);
+    for (int i = 0; i < learners; ++i) learner_free(ls[i]);
+    free(ls);
+    free(true_b); free(true_t); free(est_b); free(est_t);
+    deck_content_release(deck);
+    return 0;
+}
+
+/* one learner's history: `study` days of clearing everything due plus new
+   cards, answered from true difficulties, then nothing for `away` days */
+static Learner *bench_catchup_learner(DeckContent *deck, const float *true_b,
+                                      uint32_t study, uint32_t per_day_new) {
+    Learner *l = learner_enroll(deck, 0);
+    uint32_t *due = malloc(sizeof(uint32_t) * deck->count), next_new = 0;
+    uint64_t rng = 0x5851f42d4c957f2dull;
+    for (uint32_t day = 0; day < study; ++day) {
+        int n = learner_due(l, 20000 + day, due, (int)deck->count);
+        for (uint32_t k = 0; k < per_day_new && next_new < deck->count; ++k) due[n++] = next_new++;
+        for (int i = 0; i < n; ++i) {
+            double p = elo_recall(1.0, true_b[due[i]]);
+            int correct = (bench_xorshift(&rng) >> 11) * (1.0 / 9007199254740992.0) < p;
+            learner_review(l, due[i], correct, 20000 + day);
+        }
+    }
+    free(due);
+    return l;
+}
+
+int bench_catchup(int argc, char **argv) {
+    uint32_t cards = argc > 0 ? (uint32_t)atoi(argv[0]) : 50000;
+    uint32_t away = argc > 1 ? (uint32_t)atoi(argv[1]) : 14;
+    uint32_t days = argc > 2 ? (uint32_t)atoi(argv[2]) : 7;
+    uint32_t per_day = argc > 3 ? (uint32_t)atoi(argv[3]) : 1500;
+    if (cards == 0) cards = 50000;
+    if (days == 0) days = 7;
+    const uint32_t study = 60, per_day_new = cards / study;
+
+    DeckContent *deck = bench_build_deck(cards);
+    cards = deck->count;
+    uint64_t rng = 0x2545f4914f6cdd1dull;
+    float *true_b = malloc(sizeof(float) * cards);
+    for (uint32_t i = 0; i < cards; ++i) true_b[i] = bench_normalish(&rng, 1.2);
+    const uint32_t today = 20000 + study + away;
+    printf("catchup bench: %u cards studied over %u days, then %u days away; plan %u days at %u/day\n",
+           cards, study, away, days, per_day);
+
+    static const char *mode_name[] = {"retrievability", "overdue ratio"};
+    for (int mode = CATCHUP_RETRIEVABILITY; mode <= CATCHUP_OVERDUE_RATIO; ++mode) {
+        Learner *l = bench_catchup_learner(deck, true_b, study, per_day_new);
+        CatchUpPlan plan;
+        double t0 = now_seconds();
+        learner_catch_up(l, today, days, per_day, mode, &plan);
+        double took = now_seconds() - t0;
+        printf("  by %s: %u overdue planned in %.2f ms; %u on the plan, %u deferred\n",
+               mode_name[mode], plan.overdue, took * 1e3, plan.planned, plan.deferred);
+        // what the learner will be served each day, read back from the due entries
+        printf("    due per day:");
+        uint32_t span = 2 * days < 14 ? 14 : 2 * days, *load = calloc(span + 1, sizeof(uint32_t));
+        uint32_t entries = l->dense ? cards : l->used;
+        for (uint32_t i = 0; i < entries; ++i) {
+            if (l->dense && !l->state[i]) continue;
+            uint32_t d = l->base + l->due[i] - today;
+            load[d < span ? d : span]++;
+        }
+        for (uint32_t d = 0; d < span; ++d) printf(" %u", load[d]);
+        printf(" (+%u later)\n", load[span]);
+        if (plan.planned > 0) {
+            uint32_t first = plan.cards[0], last = plan.cards[plan.planned - 1];
+            printf("    first planned #%u (true difficulty %.2f), last #%u (%.2f)\n",
+                   first, true_b[first], last, true_b[last]);
+        }
+        catch_up_plan_free(&plan);
+        learner_free(l);
+    }
+    free(true_b);
+    deck_content_release(deck);
+    return 0;
+}
+
@@ -0,0 +1,59 @@
+/*
+ FlashSprint class engine: one shared deck studied by many learners
+
+ FlashSprintClass.c holds what serves a whole class rather than the one
+ learner at the console: shared, content-addressed deck content with a
+ compact scheduling overlay per learner, idle-learner eviction and
+ rehydration, online Elo card difficulty, the backlog catch-up planner
+ and the class-wide IRT fit. The interactive app does not use it; it is
+ driven by the --bench modes below and linked into the same binary:
+
+   gcc -std=c11 -O2 -pthread -o flashcards FlashSprintConcole.c FlashSprintClass.c
+
+ This header is the whole interface between the two files: the helpers
+ the class engine borrows from the console, and its benchmark entry
+ points.
+*/
+
+#ifndef FLASHSPRINT_CLASS_H
+#define FLASHSPRINT_CLASS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* --- From FlashSprintConcole.c --- */
+
+double now_seconds(void);
+
+/* 64-bit FNV-1a, continuing from h */
+uint64_t hash64_bytes(const void *p, size_t n, uint64_t h);
+#define HASH64_SEED 1469598103934665603ULL
+
+/* tags of the synthetic benchmark decks */
+#define SHARD_TAG_VOCAB 8
+extern const char *shard_tag_vocab[SHARD_TAG_VOCAB];
+uint64_t bench_xorshift(uint64_t *s);
+
+/* worker threads for n items, and running fn(ctx, t) on t = 0..threads-1 */
+#define SORT_MAX_THREADS 16
+int sort_threads(size_t n);
+void sort_run_threads(int threads, void *(*fn)(void *, int), void *ctx);
+
+/* bounded top-k selection over int32 keys, best (largest) first */
+void topk_offer(int32_t *key, uint32_t *val, uint32_t *n, uint32_t k, int32_t v, uint32_t item);
+void topk_sort(int32_t *key, uint32_t *val, uint32_t n);
+
+/* catch-up ranking, shared by the practice loop and the learner planner */
+enum { CATCHUP_RETRIEVABILITY, CATCHUP_OVERDUE_RATIO };
+double catch_up_score(int mode, double overdue, double interval, double stability);
+int32_t catch_up_key(double score);
+
+/* --- From FlashSprintClass.c: ./flashcards --bench <name> ... --- */
+
+int bench_class(int argc, char **argv);
+int bench_evict(int argc, char **argv);
+int bench_elo(int argc, char **argv);
+int bench_irt(int argc, char **argv);
+int bench_catchup(int argc, char **argv);
+
+#endif  // FLASHSPRINT_CLASS_H
@@ -5,18 +5,74 @@
   - Tag-based search via a hash map (separate chaining)
   - Console interactive interface: add, practice, search, list, save/load, exit
   - Implemented using Queues and Hash Maps (DSA concepts)
+  - Sharded benchmark engine with NUMA-local, huge-page-backed arenas
+  - Live deck mode: scheduling state memory-mapped and updated in place
+  - Streaming deck diff and three-way merge of saved files
+  - Card listings sorted by any key: parallel radix sort (integer keys) and
+    parallel merge sort (text) over key columns
+  - Thinking-time quantiles per card, tag and learner from mergeable t-digests
+  - Practice rounds interleaved by tag so neighbouring cards avoid sharing tags
+  - Backlog catch-up: a large backlog is spread over several practice rounds,
+    cards most likely still remembered first
+  - The same deck engine as an embeddable C++17 value type: FlashSprintDeck.hpp
+
+ A class engine for many learners sharing one deck lives in its own file,
+ FlashSprintClass.c, and is exercised by the --bench modes (class, evict,
+ elo, irt, catchup):
+  - Shared immutable deck content with compact per-learner scheduling state
+    (sparse sorted entries, dense per-card arrays once half the deck is studied)
+  - Idle learners evicted to snapshot files and rehydrated on their next request
+  - Online Elo difficulty per shared-deck card, pooled across learners and
+    updated lock-free; scales intervals and ranks the hardest cards
+  - Class-wide IRT fit of abilities and difficulties over all review logs
+    (parallel alternating Newton steps over sparse learner/card rows)
+  - Backlog catch-up planning: overdue cards ranked by retrievability or
+    overdue ratio and spread over the coming days within a daily capacity
 
  Compile:
-   gcc -std=c11 -O2 -o flashcards flashcards.c
+   gcc -std=c11 -O2 -pthread -o flashcards FlashSprintConcole.c FlashSprintClass.c
 
  Run:
    ./flashcards
+   ./flashcards --live NAME      (open/create NAME.deck as the live deck)
+   ./flashcards diff OLD NEW
+   ./flashcards merge BASE OURS THEIRS OUT
+   ./flashcards --bench shards [cards] [shards]
+   ./flashcards --bench class [learners] [cards] [studied]
+   ./flashcards --bench evict [learners] [cards] [studied] [active%]
+   ./flashcards --bench sort [cards] [threads]
+   ./flashcards --bench digest [values] [shards]
+   ./flashcards --bench elo [learners] [cards] [reviews] [threads]
+   ./flashcards --bench irt [learners] [cards] [reviews] [threads]
+   ./flashcards --bench interleave [cards] [tags]
+   ./flashcards --bench catchup [cards] [days away] [plan days] [per day]
+
+ The C++ library has its own check and benchmark, which can also verify a
+ deck file saved by this app (see FlashSprintDeckBench.cpp):
+   g++ -std=c++17 -O2 -pthread -o deckbench FlashSprintDeck.cpp FlashSprintDeckBench.cpp
+   ./deckbench [cards] [deck file]
 */
 
+#define _GNU_SOURCE   // strsep, pthread affinity, MAP_HUGETLB
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+#include "FlashSprintClass.h"
 
 #define TAG_HASH_SIZE 1031    // prime-ish size for tag hash
 #define MAX_TAGS 16
@@ -32,6 +88,129 @@ static char *my_strdup(const char *s) {
     return p;
 }
 
+/* --- Streaming quantile sketches (t-digest) --- */
+/* A merging t-digest: values are buffered, and when the buffer fills it is
+   sorted together with the centroids and merged in one pass, under a size
+   limit that keeps centroids small near the tails. A centroid spanning Δq of
+   the distribution around quantile q may grow while
+       Δq <= (2π/compression) * sqrt(q (1 - q)),
+   which is the scale function k1 = compression/(2π) * asin(2q - 1) taken one
+   k unit at a time (checked squared, so no libm). That caps a digest at about
+   compression centroids whatever the number of values, with quantile error
+   roughly 1/compression in the middle and much less at the ends. Digests
+   merge by feeding one's centroids through the other's buffer, so per-shard
+   digests combine cheaply. */
+#define TDIGEST_CARD 20.0f     // compression for per-card digests (~0.7 KB)
+#define TDIGEST_WIDE 100.0f    // per tag and per learner (~3.2 KB)
+
+typedef struct TDigestCentroid {
+    float mean;
+    float weight;
+} TDigestCentroid;
+
+typedef struct TDigest {
+    float compression;
+    int cap;                   // merged + buffered centroids that fit
+    int count;                 // merged centroids, sorted by mean
+    int buffered;              // pending values after them
+    double total;              // weight of everything added
+    float min, max;
+    TDigestCentroid c[];
+} TDigest;
+
+static TDigest *tdigest_new(float compression) {
+    int cap = 4 * (int)compression;   // half merged, half buffer
+    TDigest *d = malloc(sizeof(TDigest) + sizeof(TDigestCentroid) * cap);
+    if (!d) { perror("malloc"); exit(1); }
+    d->compression = compression;
+    d->cap = cap;
+    d->count = d->buffered = 0;
+    d->total = 0;
+    d->min = d->max = 0;
+    return d;
+}
+
+static size_t tdigest_bytes(const TDigest *d) {
+    return d ? sizeof(TDigest) + sizeof(TDigestCentroid) * d->cap : 0;
+}
+
+static int tdigest_centroid_cmp(const void *a, const void *b) {
+    float x = ((const TDigestCentroid *)a)->mean, y = ((const TDigestCentroid *)b)->mean;
+    return (x > y) - (x < y);
+}
+
+static void tdigest_flush(TDigest *d) {
+    if (d->buffered == 0) return;
+    int n = d->count + d->buffered;
+    qsort(d->c, n, sizeof(TDigestCentroid), tdigest_centroid_cmp);
+    const double scale = 2 * 3.14159265358979 / d->compression;
+    double before = 0;   // weight of the centroids already emitted
+    int out = 0;
+    TDigestCentroid cur = d->c[0];
+    for (int i = 1; i < n; ++i) {
+        double w = (double)cur.weight + d->c[i].weight;
+        double q = (before + w / 2) / d->total;
+        double dq = w / d->total;
+        if (dq * dq <= scale * scale * q * (1 - q)) {
+            cur.mean += (float)((d->c[i].mean - cur.mean) * (d->c[i].weight / w));
+            cur.weight = (float)w;
+        } else {
+            before += cur.weight;
+            d->c[out++] = cur;
+            cur = d->c[i];
+        }
+    }
+    d->c[out++] = cur;
+    d->count = out;
+    d->buffered = 0;
+}
+
+static void tdigest_add_weighted(TDigest *d, float x, float weight) {
+    if (d->total == 0 || x < d->min) d->min = x;
+    if (d->total == 0 || x > d->max) d->max = x;
+    if (d->count + d->buffered == d->cap) tdigest_flush(d);
+    d->c[d->count + d->buffered++] = (TDigestCentroid){x, weight};
+    d->total += weight;
+}
+
+static void tdigest_add(TDigest *d, float x) { tdigest_add_weighted(d, x, 1); }
+
+/* folds src into dst (src is flushed but otherwise unchanged) */
+static void tdigest_merge(TDigest *dst, TDigest *src) {
+    if (!src || src->total == 0) return;
+    tdigest_flush(src);
+    float lo = src->min, hi = src->max;
+    for (int i = 0; i < src->count; ++i)
+        tdigest_add_weighted(dst, src->c[i].mean, src->c[i].weight);
+    if (lo < dst->min) dst->min = lo;
+    if (hi > dst->max) dst->max = hi;
+}
+
+/* value at quantile q in [0, 1], interpolating between centroid midpoints */
+static float tdigest_quantile(TDigest *d, double q) {
+    if (!d || d->total == 0) return 0;
+    tdigest_flush(d);
+    if (q <= 0) return d->min;
+    if (q >= 1) return d->max;
+    const double target = q * d->total;
+    const TDigestCentroid *c = d->c;
+    double prev_mid = 0, seen = 0;
+    float prev_mean = d->min;
+    for (int i = 0; i < d->count; ++i) {
+        double mid = seen + c[i].weight / 2;
+        if (target < mid) {
+            double span = mid - prev_mid;
+            return span > 0 ? prev_mean + (float)((c[i].mean - prev_mean) * (target - prev_mid) / span)
+                            : c[i].mean;
+        }
+        prev_mid = mid;
+        prev_mean = c[i].mean;
+        seen += c[i].weight;
+    }
+    double span = d->total - prev_mid;
+    return span > 0 ? prev_mean + (float)((d->max - prev_mean) * (target - prev_mid) / span) : d->max;
+}
+
 /* --- Card structure --- */
 typedef struct Card {
     int id;
@@ -42,6 +221,9 @@ typedef struct Card {
     /* Spaced repetition fields */
     int interval;      // number of rotations to skip when answered correctly (>=1)
     int due_in;        // remaining rotations before this card is due (0 => due now)
+    int slot;          // record index in the live deck, -1 when text is malloc'd
+    int overdue;       // rounds spent due but held back by a catch-up
+    TDigest *think;    // seconds to reveal the answer; NULL until first practiced
     struct Card *next; // for linking lists
 } Card;
 
@@ -107,6 +289,40 @@ static void queue_free_nodes(Queue *q) {
     q->size = 0;
 }
 
+static void radix_sort_u64(uint64_t *keys, uint32_t *vals, size_t n, int threads);
+
+/* Bulk build after a load: appends cards to q soonest-due first, ties in the
+   given order. A radix sort over due_in orders them in one bucket pass
+   (two once due dates spread past 4096 rotations), so building is linear
+   rather than n ordered inserts, and practice finds due cards at the
+   head instead of rotating past the rest. */
+static void queue_build(Queue *q, Card **cards, size_t n) {
+    if (n == 0) return;
+    uint64_t *keys = malloc(sizeof(uint64_t) * n);
+    uint32_t *order = malloc(sizeof(uint32_t) * n);
+    QueueNode *nodes = NULL, *last = NULL;
+    if (!keys || !order) { perror("malloc"); exit(1); }
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = (uint32_t)cards[i]->due_in ^ 0x80000000u;
+        order[i] = (uint32_t)i;
+    }
+    radix_sort_u64(keys, order, n, sort_threads(n));
+    for (size_t i = n; i-- > 0;) {
+        QueueNode *node = malloc(sizeof(QueueNode));
+        if (!node) { perror("malloc"); exit(1); }
+        node->card = cards[order[i]];
+        node->next = nodes;
+        nodes = node;
+        if (!last) last = node;
+    }
+    free(keys);
+    free(order);
+    if (!q->tail) q->head = nodes;
+    else q->tail->next = nodes;
+    q->tail = last;
+    q->size += (int)n;
+}
+
 /* --- Hash map for tags: map tag string -> linked list of Card* --- */
 typedef struct TagEntry {
     char *tag;
@@ -123,6 +339,7 @@ typedef struct CardListNode {
 typedef struct TagEntry2 {
     char *tag;
     CardListNode *cards;
+    TDigest *think;    // over every card with this tag, NULL until practiced
     struct TagEntry2 *next;
 } TagEntry2;
 
@@ -157,6 +374,7 @@ static void tag_add_card(const char *tag, Card *card) {
         e = malloc(sizeof(TagEntry2));
         e->tag = my_strdup(tag);
         e->cards = NULL;
+        e->think = NULL;
         e->next = tag_map[h];
         tag_map[h] = e;
     }
@@ -198,6 +416,7 @@ static void tag_remove_card(Card *card) {
                         if (prev) prev->next = cur->next;
                         else tag_map[h] = cur->next;
                         free(cur->tag);
+                        free(cur->think);
                         free(cur);
                         break;
                     }
@@ -223,6 +442,9 @@ static Card *create_card(const char *q, const char *a, char **tags, int tag_coun
     for (int i = 0; i < tag_count; ++i) c->tags[i] = my_strdup(tags[i]);
     c->interval = 1; // start with interval 1
     c->due_in = 0;    // due immediately when added
+    c->slot = -1;
+    c->overdue = 0;
+    c->think = NULL;
     c->next = NULL;
     // insert into cards list head
     c->next = cards_head;
@@ -247,11 +469,14 @@ static void delete_card(Card *c) {
     }
     // remove from tag map
     tag_remove_card(c);
-    // free memory
-    free(c->question);
-    free(c->answer);
-    for (int i=0;i<c->tag_count;++i) free(c->tags[i]);
+    // free memory (live deck cards point into the mapped text instead)
+    if (c->slot < 0) {
+        free(c->question);
+        free(c->answer);
+        for (int i=0;i<c->tag_count;++i) free(c->tags[i]);
+    }
     free(c->tags);
+    free(c->think);
     free(c);
 }
 
@@ -296,11 +521,86 @@ static char **parse_tags(const char *line, int *out_count) {
 }
 
 /* --- Persistence: save/load simple text format --- */
+/* One card per block of KEY=value lines ended by "---". CardRec is a block as
+   read from disk (tags kept as the raw comma-separated line); the reader is
+   shared by load_cards_from_file and the streaming diff/merge tools. */
+typedef struct CardRec {
+    int id, interval, due_in;
+    char *question, *answer, *tags;
+} CardRec;
+
+typedef struct CardReader {
+    FILE *f;
+    const char *name;
+    int last_id;               // for sorted-input checks
+} CardReader;
+
+static void card_rec_free(CardRec *r) {
+    free(r->question); free(r->answer); free(r->tags);
+    r->question = r->answer = r->tags = NULL;
+}
+
+/* read the next complete block into r (owned strings); 0 at end of file */
+static int card_reader_next(CardReader *rd, CardRec *r) {
+    char line[LINEBUF];
+    memset(r, 0, sizeof(*r));
+    r->interval = 1;
+    while (fgets(line, sizeof(line), rd->f)) {
+        trim_newline(line);
+        if (strncmp(line, "ID=", 3) == 0) {
+            r->id = atoi(line+3);
+        } else if (strncmp(line, "Q=", 2) == 0) {
+            free(r->question);
+            r->question = my_strdup(line+2);
+        } else if (strncmp(line, "A=", 2) == 0) {
+            free(r->answer);
+            r->answer = my_strdup(line+2);
+        } else if (strncmp(line, "T=", 2) == 0) {
+            free(r->tags);
+            r->tags = my_strdup(line+2);
+        } else if (strncmp(line, "I=", 2) == 0) {
+            r->interval = atoi(line+2);
+        } else if (strncmp(line, "D=", 2) == 0) {
+            r->due_in = atoi(line+2);
+        } else if (strcmp(line, "---") == 0) {
+            if (r->question && r->answer) break;
+            card_rec_free(r);
+            memset(r, 0, sizeof(*r));
+            r->interval = 1;
+        }
+    }
+    // a last block without trailing --- still counts
+    if (!r->question || !r->answer) { card_rec_free(r); return 0; }
+    if (!r->tags) r->tags = my_strdup("");
+    if (r->interval <= 0) r->interval = 1;
+    if (r->due_in < 0) r->due_in = 0;
+    return 1;
+}
+
+static void card_rec_write(FILE *f, const CardRec *r) {
+    fprintf(f, "ID=%d\nQ=%s\nA=%s\nT=%s\nI=%d\nD=%d\n---\n",
+            r->id, r->question, r->answer, r->tags, r->interval, r->due_in);
+}
+
+static int card_id_cmp(const void *a, const void *b) {
+    int x = (*(Card *const *)a)->id, y = (*(Card *const *)b)->id;
+    return (x > y) - (x < y);
+}
+
+/* cards are written in ascending id order so saved decks can be diffed and
+   merged as streams */
 static void save_cards_to_file(const char *filename) {
     FILE *f = fopen(filename, "w");
     if (!f) { perror("fopen"); return; }
+    size_t n = 0;
+    for (Card *c = cards_head; c; c = c->next) n++;
+    Card **sorted = malloc(sizeof(Card*) * (n ? n : 1));
+    n = 0;
+    for (Card *c = cards_head; c; c = c->next) sorted[n++] = c;
+    qsort(sorted, n, sizeof(Card*), card_id_cmp);
     // simple format: card per block
-    for (Card *c = cards_head; c; c = c->next) {
+    for (size_t k = 0; k < n; ++k) {
+        Card *c = sorted[k];
         fprintf(f, "ID=%d\n", c->id);
         fprintf(f, "Q=%s\n", c->question);
         fprintf(f, "A=%s\n", c->answer);
@@ -314,6 +614,7 @@ static void save_cards_to_file(const char *filename) {
         fprintf(f, "D=%d\n", c->due_in);
         fprintf(f, "---\n");
     }
+    free(sorted);
     fclose(f);
     printf("Saved %s\n", filename);
 }
@@ -328,6 +629,7 @@ static void clear_all_data(Queue *q) {
             CardListNode *cn = e->cards;
             while (cn) { CardListNode *cnx = cn->next; free(cn); cn = cnx; }
             free(e->tag);
+            free(e->think);
             free(e);
             e = nx;
         }
@@ -337,10 +639,13 @@ static void clear_all_data(Queue *q) {
     Card *c = cards_head;
     while (c) {
         Card *nx = c->next;
-        for (int i=0;i<c->tag_count;++i) free(c->tags[i]);
+        if (c->slot < 0) {
+            for (int i=0;i<c->tag_count;++i) free(c->tags[i]);
+            free(c->question);
+            free(c->answer);
+        }
         free(c->tags);
-        free(c->question);
-        free(c->answer);
+        free(c->think);
         free(c);
         c = nx;
     }
@@ -349,73 +654,500 @@ static void clear_all_data(Queue *q) {
     if (q) queue_free_nodes(q);
 }
 
-/* Parsing helper: read file and reconstruct cards */
+/* --- Live deck: scheduling state in a memory-mapped file --- */
+/* A live deck is three files next to each other:
+     NAME.deck  header + fixed-width LiveRecord array (mapped read/write)
+     NAME.text  append-only string heap with questions, answers, tags (mapped read-only)
+     NAME.redo  small redo log of reviews since the last checkpoint
+   Cards opened from a live deck point straight into the mappings, so a restart is
+   just mmap + replay of the redo log; nothing is parsed or copied. Reviews write
+   the record in place and append a redo entry (fdatasync every LIVE_SYNC_EVERY);
+   a checkpoint msyncs the records and truncates the log. Rotation decrements of
+   due_in are written in place without logging: losing one only shows a card a
+   rotation later. Both mappings reserve LIVE_RESERVE bytes of address space up
+   front so growing the files never moves a pointer. */
+#define LIVE_MAGIC "FSLIVE1"
+#define LIVE_VERSION 1
+#define LIVE_RESERVE (1ULL << 36)
+#define LIVE_SYNC_EVERY 32
+#define LIVE_CHECKPOINT_EVERY 4096
+#define LIVE_REC_LIVE 1u
+
+typedef struct LiveHeader {
+    char magic[8];
+    uint32_t version, record_size;
+    uint32_t count, capacity;    // records used / records the file has room for
+    int32_t next_id;
+    uint32_t pad;
+    uint64_t heap_used;          // committed bytes in NAME.text
+    uint64_t checkpoint_seq;     // redo entries <= this are already in the records
+    char reserved[16];
+} LiveHeader;
+
+typedef struct LiveRecord {
+    int32_t id, interval, due_in;
+    uint32_t flags;
+    uint64_t q_off, a_off, t_off;  // NUL-terminated strings in the heap; tags back to back
+    uint32_t tag_count, pad;
+} LiveRecord;
+
+typedef struct LiveRedo {
+    uint64_t seq;
+    uint32_t slot;
+    int32_t interval, due_in;
+    uint32_t check;              // rejects a torn tail after a crash
+} LiveRedo;
+
+typedef struct LiveDeck {
+    char *base;                  // NAME without extension
+    int deck_fd, text_fd, redo_fd;
+    LiveHeader *hdr;             // start of the deck mapping
+    LiveRecord *recs;
+    const char *heap;
+    uint64_t seq;                // last redo sequence written
+    int unsynced, logged;
+} LiveDeck;
+
+static LiveDeck *live_deck = NULL;
+
+/* 64-bit FNV-1a */
+uint64_t hash64_bytes(const void *p, size_t n, uint64_t h) {
+    const unsigned char *b = p;
+    for (size_t i = 0; i < n; ++i) { h ^= b[i]; h *= 1099511628211ULL; }
+    return h;
+}
+
+static uint32_t live_redo_check(const LiveRedo *r) {
+    return (uint32_t)hash64_bytes(r, offsetof(LiveRedo, check), HASH64_SEED);
+}
+
+static char *live_path(const char *base, const char *ext) {
+    size_t n = strlen(base) + strlen(ext) + 1;
+    char *p = malloc(n);
+    snprintf(p, n, "%s%s", base, ext);
+    return p;
+}
+
+static int live_grow(LiveDeck *d, uint32_t need) {
+    if (need <= d->hdr->capacity) return 0;
+    uint32_t cap = d->hdr->capacity ? d->hdr->capacity : 1024;
+    while (cap < need) cap *= 2;
+    if ((uint64_t)sizeof(LiveHeader) + (uint64_t)cap * sizeof(LiveRecord) > LIVE_RESERVE ||
+        ftruncate(d->deck_fd, sizeof(LiveHeader) + (off_t)cap * sizeof(LiveRecord)) != 0) {
+        perror("live deck grow");
+        return -1;
+    }
+    d->hdr->capacity = cap;
+    return 0;
+}
+
+static uint64_t live_heap_append(LiveDeck *d, const char *s) {
+    size_t n = strlen(s) + 1;
+    uint64_t off = d->hdr->heap_used;
+    if (off + n > LIVE_RESERVE || pwrite(d->text_fd, s, n, off) != (ssize_t)n) {
+        perror("live deck text");
+        exit(1);
+    }
+    d->hdr->heap_used = off + n;
+    return off;
+}
+
+static void live_checkpoint(LiveDeck *d) {
+    size_t len = sizeof(LiveHeader) + (size_t)d->hdr->count * sizeof(LiveRecord);
+    fdatasync(d->text_fd);
+    d->hdr->checkpoint_seq = d->seq;
+    msync(d->hdr, len, MS_SYNC);
+    if (ftruncate(d->redo_fd, 0) == 0) lseek(d->redo_fd, 0, SEEK_SET);
+    d->logged = d->unsynced = 0;
+}
+
+/* apply redo entries newer than the last checkpoint; stop at the first torn one */
+static void live_replay(LiveDeck *d) {
+    LiveRedo r;
+    int applied = 0;
+    d->seq = d->hdr->checkpoint_seq;
+    lseek(d->redo_fd, 0, SEEK_SET);
+    while (read(d->redo_fd, &r, sizeof(r)) == (ssize_t)sizeof(r)) {
+        if (r.check != live_redo_check(&r) || r.slot >= d->hdr->count) break;
+        if (r.seq <= d->hdr->checkpoint_seq) continue;
+        d->recs[r.slot].interval = r.interval;
+        d->recs[r.slot].due_in = r.due_in;
+        d->seq = r.seq;
+        applied++;
+    }
+    if (applied) printf("Replayed %d review(s) from redo log.\n", applied);
+    live_checkpoint(d);
+}
+
+/* wire a Card onto a mapped record; text and tags point into the heap */
+static Card *live_attach_card(LiveDeck *d, uint32_t slot) {
+    LiveRecord *r = &d->recs[slot];
+    Card *c = malloc(sizeof(Card));
+    c->id = r->id;
+    c->question = (char *)d->heap + r->q_off;
+    c->answer = (char *)d->heap + r->a_off;
+    c->tag_count = (int)r->tag_count;
+    c->tags = malloc(sizeof(char*) * (r->tag_count ? r->tag_count : 1));
+    const char *t = d->heap + r->t_off;
+    for (uint32_t i = 0; i < r->tag_count; ++i) {
+        c->tags[i] = (char *)t;
+        t += strlen(t) + 1;
+    }
+    c->interval = r->interval;
+    c->due_in = r->due_in;
+    c->slot = (int)slot;
+    c->overdue = 0;
+    c->think = NULL;
+    c->next = cards_head;
+    cards_head = c;
+    for (int i = 0; i < c->tag_count; ++i) tag_add_card(c->tags[i], c);
+    return c;
+}
+
+/* copy a card into deck d and repoint it at the mapped text. The card's old
+   text is freed when it was malloc'd, or left alone when it still belongs to
+   the previous live deck (which stays mapped until the import is done). */
+static void live_append(LiveDeck *d, Card *c) {
+    if (!d) return;
+    if (live_grow(d, d->hdr->count + 1) != 0) return;
+    uint32_t slot = d->hdr->count;
+    LiveRecord *r = &d->recs[slot];
+    memset(r, 0, sizeof(*r));
+    r->id = c->id;
+    r->interval = c->interval;
+    r->due_in = c->due_in;
+    r->q_off = live_heap_append(d, c->question);
+    r->a_off = live_heap_append(d, c->answer);
+    r->t_off = d->hdr->heap_used;
+    for (int i = 0; i < c->tag_count; ++i) live_heap_append(d, c->tags[i]);
+    r->tag_count = (uint32_t)c->tag_count;
+    r->flags = LIVE_REC_LIVE;
+    d->hdr->count = slot + 1;
+    if (c->id >= d->hdr->next_id) d->hdr->next_id = c->id + 1;
+
+    int owned = c->slot < 0;
+    if (owned) { free(c->question); free(c->answer); }
+    c->question = (char *)d->heap + r->q_off;
+    c->answer = (char *)d->heap + r->a_off;
+    const char *t = d->heap + r->t_off;
+    for (int i = 0; i < c->tag_count; ++i) {
+        if (owned) free(c->tags[i]);
+        c->tags[i] = (char *)t;
+        t += strlen(t) + 1;
+    }
+    c->slot = (int)slot;
+}
+
+static void live_remove(Card *c) {
+    if (!live_deck || c->slot < 0) return;
+    live_deck->recs[c->slot].flags &= ~LIVE_REC_LIVE;
+    live_checkpoint(live_deck);
+}
+
+/* rotation bookkeeping: in place, not logged */
+static void live_touch(Card *c) {
+    if (!live_deck || c->slot < 0) return;
+    live_deck->recs[c->slot].due_in = c->due_in;
+}
+
+static void live_review(Card *c) {
+    LiveDeck *d = live_deck;
+    if (!d || c->slot < 0) return;
+    LiveRedo r = {0};
+    r.seq = ++d->seq;
+    r.slot = (uint32_t)c->slot;
+    r.interval = c->interval;
+    r.due_in = c->due_in;
+    r.check = live_redo_check(&r);
+    if (write(d->redo_fd, &r, sizeof(r)) != (ssize_t)sizeof(r)) perror("live deck redo");
+    d->recs[c->slot].interval = c->interval;
+    d->recs[c->slot].due_in = c->due_in;
+    if (++d->unsynced >= LIVE_SYNC_EVERY) { fdatasync(d->redo_fd); d->unsynced = 0; }
+    if (++d->logged >= LIVE_CHECKPOINT_EVERY) live_checkpoint(d);
+}
+
+/* checkpoint and unmap; cards pointing into the mappings must be cleared first */
+static void live_close(void) {
+    LiveDeck *d = live_deck;
+    if (!d) return;
+    live_checkpoint(d);
+    munmap(d->hdr, LIVE_RESERVE);
+    munmap((void *)d->heap, LIVE_RESERVE);
+    close(d->deck_fd); close(d->text_fd); close(d->redo_fd);
+    printf("Closed live deck %s\n", d->base);
+    free(d->base);
+    free(d);
+    live_deck = NULL;
+}
+
+/* Open NAME as the live deck. An existing deck replaces the in-memory cards;
+   a new one is created from them. */
+static int live_open(const char *base, Queue *q) {
+    char *deck_path = live_path(base, ".deck");
+    char *text_path = live_path(base, ".text");
+    char *redo_path = live_path(base, ".redo");
+    LiveDeck *d = calloc(1, sizeof(LiveDeck));
+    d->hdr = MAP_FAILED;
+    d->heap = MAP_FAILED;
+    d->deck_fd = open(deck_path, O_RDWR | O_CREAT, 0644);
+    d->text_fd = open(text_path, O_RDWR | O_CREAT, 0644);
+    d->redo_fd = open(redo_path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    free(deck_path); free(text_path); free(redo_path);
+    if (d->deck_fd < 0 || d->text_fd < 0 || d->redo_fd < 0) { perror("open"); goto fail; }
+
+    struct stat st;
+    if (fstat(d->deck_fd, &st) != 0) goto fail;
+    int fresh = st.st_size == 0;
+    if (fresh && ftruncate(d->deck_fd, sizeof(LiveHeader)) != 0) goto fail;
+    if (!fresh && st.st_size < (off_t)sizeof(LiveHeader)) {
+        fprintf(stderr, "%s.deck: truncated header\n", base);
+        goto fail;
+    }
+    d->hdr = mmap(NULL, LIVE_RESERVE, PROT_READ | PROT_WRITE, MAP_SHARED, d->deck_fd, 0);
+    d->heap = mmap(NULL, LIVE_RESERVE, PROT_READ, MAP_SHARED, d->text_fd, 0);
+    if (d->hdr == MAP_FAILED || d->heap == MAP_FAILED) { perror("mmap"); goto fail; }
+    if (!fresh && (memcmp(d->hdr->magic, LIVE_MAGIC, sizeof(LIVE_MAGIC)) != 0 ||
+                   d->hdr->version != LIVE_VERSION ||
+                   d->hdr->record_size != sizeof(LiveRecord))) {
+        fprintf(stderr, "%s.deck: not a live deck (or wrong version)\n", base);
+        goto fail;
+    }
+    d->recs = (LiveRecord *)(d->hdr + 1);
+    d->base = my_strdup(base);
+
+    if (fresh) {
+        memcpy(d->hdr->magic, LIVE_MAGIC, sizeof(LIVE_MAGIC));
+        d->hdr->version = LIVE_VERSION;
+        d->hdr->record_size = sizeof(LiveRecord);
+        d->hdr->next_id = next_card_id;
+        int n = 0;
+        for (Card *c = cards_head; c; c = c->next) { live_append(d, c); n++; }
+        live_checkpoint(d);
+        live_close();   // the previous deck, now that its text has been copied
+        live_deck = d;
+        printf("Created live deck %s with %d cards\n", base, n);
+    } else {
+        clear_all_data(q);
+        live_close();
+        live_deck = d;
+        live_replay(d);
+        Card **mapped = malloc(sizeof(Card*) * (d->hdr->count ? d->hdr->count : 1));
+        if (!mapped) { perror("malloc"); exit(1); }
+        int n = 0;
+        for (uint32_t i = 0; i < d->hdr->count; ++i) {
+            if (!(d->recs[i].flags & LIVE_REC_LIVE)) continue;
+            mapped[n++] = live_attach_card(d, i);
+        }
+        queue_build(q, mapped, (size_t)n);
+        free(mapped);
+        if (d->hdr->next_id > next_card_id) next_card_id = d->hdr->next_id;
+        printf("Mapped live deck %s (%d cards)\n", base, n);
+    }
+    return 0;
+fail:
+    if (d->hdr != MAP_FAILED) munmap(d->hdr, LIVE_RESERVE);
+    if (d->heap != MAP_FAILED) munmap((void *)d->heap, LIVE_RESERVE);
+    if (d->deck_fd >= 0) close(d->deck_fd);
+    if (d->text_fd >= 0) close(d->text_fd);
+    if (d->redo_fd >= 0) close(d->redo_fd);
+    free(d->base);
+    free(d);
+    return -1;
+}
+
+/* entries of an array of Card*, by the card's id and then by position, so a
+   sort keeps the first of each repeated id first */
+static int card_entry_cmp(const void *a, const void *b) {
+    Card *const *x = *(Card *const *const *)a, *const *y = *(Card *const *const *)b;
+    if ((*x)->id != (*y)->id) return ((*x)->id > (*y)->id) - ((*x)->id < (*y)->id);
+    return (x > y) - (x < y);
+}
+
+/* Parsing helper: read file and reconstruct cards. The file's ids are kept;
+   cards without one, and every repeat of an id after its first card, are
+   numbered after the largest id in the file, so diff and merge (which match
+   by id) never see two cards share one. */
 static void load_cards_from_file(const char *filename, Queue *q) {
     FILE *f = fopen(filename, "r");
     if (!f) { perror("fopen"); return; }
     clear_all_data(q);
-    char line[LINEBUF];
-    int id=0, interval=1, due=0;
-    char *qtext=NULL, *atext=NULL, *tagsline=NULL;
-    while (fgets(line, sizeof(line), f)) {
-        trim_newline(line);
-        if (strncmp(line, "ID=", 3) == 0) {
-            id = atoi(line+3);
-        } else if (strncmp(line, "Q=", 2) == 0) {
-            free(qtext);
-            qtext = my_strdup(line+2);
-        } else if (strncmp(line, "A=", 2) == 0) {
-            free(atext);
-            atext = my_strdup(line+2);
-        } else if (strncmp(line, "T=", 2) == 0) {
-            free(tagsline);
-            tagsline = my_strdup(line+2);
-        } else if (strncmp(line, "I=", 2) == 0) {
-            interval = atoi(line+2);
-        } else if (strncmp(line, "D=", 2) == 0) {
-            due = atoi(line+2);
-        } else if (strcmp(line, "---") == 0) {
-            if (qtext && atext) {
-                int tcount=0;
-                char **tks = parse_tags(tagsline?tagsline:"", &tcount);
-                Card *c = create_card(qtext, atext, tks, tcount);
-                c->interval = interval>0?interval:1;
-                c->due_in = due>=0?due:0;
-                // ensure next_card_id > id
-                if (id >= next_card_id) next_card_id = id + 1;
-                // enqueue into queue
-                queue_enqueue(q, c);
-                for (int i=0;i<tcount;++i) free(tks[i]);
-                free(tks);
-            }
-            free(qtext); qtext=NULL;
-            free(atext); atext=NULL;
-            free(tagsline); tagsline=NULL;
-            id = 0; interval=1; due=0;
-        }
-    }
-    // catch last if no trailing ---
-    if (qtext && atext) {
-        int tcount=0; char **tks = parse_tags(tagsline?tagsline:"", &tcount);
-        Card *c = create_card(qtext, atext, tks, tcount);
-        c->interval = interval>0?interval:1;
-        c->due_in = due>=0?due:0;
-        if (id >= next_card_id) next_card_id = id + 1;
-        queue_enqueue(q, c);
+    live_close();
+    CardReader rd = { f, filename, 0 };
+    CardRec rec;
+    Card **loaded = NULL;
+    size_t n = 0, cap = 0;
+    int first_free = next_card_id;   // create_card's ids below are all replaced
+    while (card_reader_next(&rd, &rec)) {
+        int tcount=0;
+        char **tks = parse_tags(rec.tags, &tcount);
+        Card *c = create_card(rec.question, rec.answer, tks, tcount);
+        c->id = rec.id > 0 ? rec.id : 0;   // 0: numbered below
+        if (c->id >= first_free) first_free = c->id + 1;
+        c->interval = rec.interval;
+        c->due_in = rec.due_in;
+        if (n == cap) {
+            cap = cap ? cap * 2 : 256;
+            loaded = realloc(loaded, sizeof(Card*) * cap);
+            if (!loaded) { perror("realloc"); exit(1); }
+        }
+        loaded[n++] = c;
         for (int i=0;i<tcount;++i) free(tks[i]);
         free(tks);
+        card_rec_free(&rec);
     }
-    free(qtext); free(atext); free(tagsline);
     fclose(f);
+    next_card_id = first_free;
+    Card ***by_id = malloc(sizeof(Card**) * (n ? n : 1));
+    for (size_t i = 0; i < n; ++i) by_id[i] = &loaded[i];
+    qsort(by_id, n, sizeof(Card**), card_entry_cmp);
+    size_t repeats = 0;
+    for (size_t i = 1, prev = 0; i < n; ++i) {
+        if ((*by_id[i])->id > 0 && (*by_id[i])->id == (*by_id[prev])->id) {
+            (*by_id[i])->id = 0;
+            repeats++;
+        } else {
+            prev = i;
+        }
+    }
+    free(by_id);
+    for (size_t i = 0; i < n; ++i)
+        if (loaded[i]->id == 0) loaded[i]->id = next_card_id++;
+    if (repeats) printf("%zu repeated card id(s) renumbered\n", repeats);
+    queue_build(q, loaded, n);
+    free(loaded);
     printf("Loaded %s\n", filename);
 }
 
+/* --- Session planning: tag interleaving --- */
+/* A practice round serves every card that came due in it. Ten "queue"
+   cards in a row invite pattern matching rather than recall, so the round
+   is reordered first: cards are bucketed by their first tag (one radix
+   sort over tag hashes) and dealt round-robin from the buckets, fullest
+   bucket first so the big topics don't pile up at the end. A max-heap over
+   bucket sizes makes each pick O(log tags). When the picked card shares any
+   tag with the previous one, the runner-up bucket is tried instead; only
+   when every remaining card is of one topic do repeats happen. */
+typedef struct SessionBucket {
+    uint32_t next, end;        // remaining cards: order[next, end)
+} SessionBucket;
+
+static int cards_share_tag(const Card *a, const Card *b) {
+    for (int i = 0; i < a->tag_count; ++i)
+        for (int j = 0; j < b->tag_count; ++j)
+            if (strcmp(a->tags[i], b->tags[j]) == 0) return 1;
+    return 0;
+}
+
+/* heap of bucket indices, fullest first; ties by index keep the plan stable */
+static int session_before(const SessionBucket *b, uint32_t x, uint32_t y) {
+    uint32_t nx = b[x].end - b[x].next, ny = b[y].end - b[y].next;
+    return nx != ny ? nx > ny : x < y;
+}
+
+static void session_heap_push(uint32_t *heap, uint32_t *n, const SessionBucket *b, uint32_t v) {
+    uint32_t at = (*n)++;
+    while (at > 0 && session_before(b, v, heap[(at - 1) / 2])) {
+        heap[at] = heap[(at - 1) / 2];
+        at = (at - 1) / 2;
+    }
+    heap[at] = v;
+}
+
+static uint32_t session_heap_pop(uint32_t *heap, uint32_t *n, const SessionBucket *b) {
+    uint32_t top = heap[0], v = heap[--*n], at = 0, c;
+    while ((c = 2 * at + 1) < *n) {
+        if (c + 1 < *n && session_before(b, heap[c + 1], heap[c])) c++;
+        if (!session_before(b, heap[c], v)) break;
+        heap[at] = heap[c];
+        at = c;
+    }
+    if (*n) heap[at] = v;
+    return top;
+}
+
+/* Reorders cards[0, n) in place so neighbours avoid sharing tags. */
+static void session_interleave(Card **cards, size_t n) {
+    if (n < 3) return;
+    uint64_t *keys = malloc(sizeof(uint64_t) * n);
+    uint32_t *order = malloc(sizeof(uint32_t) * n);
+    Card **out = malloc(sizeof(Card*) * n);
+    if (!keys || !order || !out) { perror("malloc"); exit(1); }
+    for (size_t i = 0; i < n; ++i) {
+        const Card *c = cards[i];
+        keys[i] = c->tag_count ? hash64_bytes(c->tags[0], strlen(c->tags[0]), HASH64_SEED) : 0;
+        order[i] = (uint32_t)i;
+    }
+    radix_sort_u64(keys, order, n, sort_threads(n));
+
+    uint32_t buckets = 0;
+    for (size_t i = 0; i < n; ++i) buckets += i == 0 || keys[i] != keys[i - 1];
+    SessionBucket *b = malloc(sizeof(SessionBucket) * buckets);
+    uint32_t *heap = malloc(sizeof(uint32_t) * buckets), heap_n = 0;
+    if (!b || !heap) { perror("malloc"); exit(1); }
+    uint32_t k = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (i > 0 && keys[i] == keys[i - 1]) continue;
+        b[k].next = (uint32_t)i;
+        if (k > 0) b[k - 1].end = (uint32_t)i;
+        k++;
+    }
+    b[k - 1].end = (uint32_t)n;
+    for (uint32_t i = 0; i < buckets; ++i) session_heap_push(heap, &heap_n, b, i);
+
+    const Card *prev = NULL;
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t pick = session_heap_pop(heap, &heap_n, b), held = UINT32_MAX;
+        if (prev && heap_n > 0 && cards_share_tag(prev, cards[order[b[pick].next]])) {
+            held = pick;
+            pick = session_heap_pop(heap, &heap_n, b);
+            if (cards_share_tag(prev, cards[order[b[pick].next]])
+                && b[held].end - b[held].next > b[pick].end - b[pick].next) {
+                // both clash: keep draining the fuller one
+                uint32_t t = pick; pick = held; held = t;
+            }
+        }
+        const Card *c = cards[order[b[pick].next++]];
+        out[i] = (Card *)c;
+        prev = c;
+        if (b[pick].next < b[pick].end) session_heap_push(heap, &heap_n, b, pick);
+        if (held != UINT32_MAX) session_heap_push(heap, &heap_n, b, held);
+    }
+    memcpy(cards, out, sizeof(Card*) * n);
+    free(keys); free(order); free(out); free(b); free(heap);
+}
+
 /* --- Practice scheduler logic --- */
-/* One rotation: we repeatedly dequeue until we find a card with due_in == 0,
-   but to keep things fair we decrement due_in for cards that are ahead of schedule.
-   Implementation: loop through queue nodes: we pop head, if due_in > 0, decrement and reenqueue.
-   If due_in == 0, present; after handling, reenqueue with new due_in calculated.
+/* One rotation: we pass over the whole queue once, decrementing due_in for cards
+   that are ahead of schedule and reenqueueing them. Cards with due_in == 0 are
+   pulled out into the round's session, interleaved by tag, and presented in
+   that order; after handling, each is reenqueued with its new due_in.
+
+   A first round of more than CATCHUP_PROMPT_AT due cards (a big deck just
+   loaded, say) offers a catch-up: the backlog is spread over as many rounds
+   as the learner asks for, and each round serves only its share, picked by
+   practice_catch_up (below, ranked like the class engine's planner); the
+   rest stay due.
 */
+#define CATCHUP_PROMPT_AT 100
+
+static size_t practice_catch_up(Queue *q, Card **session, size_t n, size_t per_round);
+
+/* the learner's reveal times across every card practiced this run */
+static TDigest *learner_think = NULL;
+
+/* records one reveal time against the card, each of its tags and the learner */
+static void record_think_time(Card *c, float seconds) {
+    if (!c->think) c->think = tdigest_new(TDIGEST_CARD);
+    tdigest_add(c->think, seconds);
+    for (int i = 0; i < c->tag_count; ++i) {
+        TagEntry2 *e = tag_find(c->tags[i]);
+        if (!e) continue;
+        if (!e->think) e->think = tdigest_new(TDIGEST_WIDE);
+        tdigest_add(e->think, seconds);
+    }
+    if (!learner_think) learner_think = tdigest_new(TDIGEST_WIDE);
+    tdigest_add(learner_think, seconds);
+}
 
 static void practice_loop(Queue *q) {
     if (!q || q->size == 0) {
@@ -423,44 +1155,75 @@ static void practice_loop(Queue *q) {
         return;
     }
     printf("Starting practice. Enter 'q' at any prompt to stop practicing.\n");
+    Card **session = NULL;
+    size_t session_n = 0, session_at = 0, session_cap = 0;
+    size_t per_round = 0;      // catch-up capacity; 0 serves every due card
+    int first_round = 1;
     int cont = 1;
     while (cont) {
-        // search for next due card. But to avoid infinite loop if no due card,
-        // we will process up to q->size nodes to find one due; if none due, decrement all due_in and continue.
-        int scanned = 0;
-        Card *c = NULL;
-        int initial_size = q->size;
-        while (scanned < initial_size) {
-            Card *card = queue_dequeue(q);
-            if (!card) break;
-            if (card->due_in > 0) {
-                card->due_in -= 1;
-                queue_enqueue(q, card);
-            } else {
-                c = card;
-                break;
+        if (session_at == session_n) {
+            // next rotation: collect every due card, age the rest
+            session_n = session_at = 0;
+            int initial_size = q->size;
+            for (int scanned = 0; scanned < initial_size; ++scanned) {
+                Card *card = queue_dequeue(q);
+                if (!card) break;
+                if (card->due_in > 0) {
+                    card->due_in -= 1;
+                    live_touch(card);
+                    queue_enqueue(q, card);
+                    continue;
+                }
+                if (session_n == session_cap) {
+                    session_cap = session_cap ? session_cap * 2 : 16;
+                    session = realloc(session, sizeof(Card*) * session_cap);
+                    if (!session) { perror("realloc"); exit(1); }
+                }
+                session[session_n++] = card;
             }
-            scanned++;
-        }
-        if (!c) {
-            // none were due; if queue still has elements, continue next rotation
-            if (q->size == 0) { printf("Queue empty.\n"); return; }
-            // else continue to next loop iteration to attempt again
-            continue;
+            if (session_n == 0) {
+                // none were due; if queue still has elements, continue next rotation
+                if (q->size == 0) { printf("Queue empty.\n"); free(session); return; }
+                continue;
+            }
+            if (first_round && session_n > CATCHUP_PROMPT_AT) {
+                char answer[16];
+                printf("%zu cards are due. Catch up over how many rounds? [1 = all now]: ", session_n);
+                if (fgets(answer, sizeof(answer), stdin)) {
+                    int rounds = atoi(answer);
+                    if (rounds > 1) per_round = (session_n + (size_t)rounds - 1) / (size_t)rounds;
+                }
+            }
+            first_round = 0;
+            size_t due = session_n;
+            if (per_round && session_n > per_round)
+                session_n = practice_catch_up(q, session, session_n, per_round);
+            session_interleave(session, session_n);
+            if (session_n < due)
+                printf("\nCatching up: %zu of %zu due cards this round, most likely remembered first.\n",
+                       session_n, due);
+            else if (session_n > 1)
+                printf("\n%zu cards due this round.\n", session_n);
         }
+        Card *c = session[session_at++];
         // Present card c
         printf("\n---\nCard #%d\nQ: %s\n(press Enter to see answer, 'q' to stop)\n", c->id, c->question);
+        double shown = now_seconds();
         char cmd[16];
-        if (!fgets(cmd, sizeof(cmd), stdin)) return;
+        if (!fgets(cmd, sizeof(cmd), stdin)) { queue_enqueue(q, c); break; }
         trim_newline(cmd);
         if (strcmp(cmd, "q") == 0) {
             // reenqueue the card unchanged and stop
             queue_enqueue(q, c);
             break;
         }
+        float think = (float)(now_seconds() - shown);
+        record_think_time(c, think);
         printf("A: %s\n", c->answer);
+        if (c->think->total > 1)
+            printf("(%.1f s to answer; usually %.1f s)\n", think, tdigest_quantile(c->think, 0.5));
         printf("Did you answer correctly? (y/n) or 'q' to stop: ");
-        if (!fgets(cmd, sizeof(cmd), stdin)) return;
+        if (!fgets(cmd, sizeof(cmd), stdin)) { queue_enqueue(q, c); break; }
         trim_newline(cmd);
         if (strcmp(cmd, "q") == 0) { queue_enqueue(q, c); break; }
         if (cmd[0] == 'y' || cmd[0] == 'Y') {
@@ -475,17 +1238,493 @@ static void practice_loop(Queue *q) {
             c->due_in = 1;
             printf("Keep practicing — interval reset to 1.\n");
         }
+        c->overdue = 0;
+        live_review(c);
         // reenqueue
         queue_enqueue(q, c);
     }
+    // cards of the round not yet presented go back unchanged
+    while (session_at < session_n) queue_enqueue(q, session[session_at++]);
+    free(session);
+    if (learner_think)
+        printf("Thinking time so far: p50 %.1f s, p90 %.1f s over %.0f reviews\n",
+               tdigest_quantile(learner_think, 0.5), tdigest_quantile(learner_think, 0.9),
+               learner_think->total);
     printf("Exiting practice.\n");
 }
 
+/* --- Sorted listings: parallel radix sort and merge sort over key columns --- */
+/* A listing copies the sort key of every card into a column (structure of
+   arrays: one array of keys, one of card positions), sorts the columns and
+   prints cards through the resulting permutation.
+
+   Integer keys use an LSD radix sort. Each pass is split across threads.
+   Every thread histograms its chunk, then works out its own output ranges
+   from all the histograms (digit-major, thread-minor), so the scatter needs
+   no locks and stays stable. Only the bits that vary between keys are
+   sorted, and a pass where every key has the same digit is skipped.
+
+   Text keys use a merge sort on 16-byte records: an 8-byte big-endian prefix
+   of the string and the card position. Threads sort chunks, then merge runs
+   pairwise. Each round splits its output evenly across threads with
+   merge-path co-ranking, so the last merges are parallel too. Runs whose
+   prefixes tie are refined with the next 8 bytes and sorted again, which
+   keeps nearly all compares on integers held in cache. */
+#define SORT_MIN_PER_THREAD 65536
+
+int sort_threads(size_t n) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t t = n / SORT_MIN_PER_THREAD;
+    if (cpus < 1) cpus = 1;
+    if (t > (size_t)cpus) t = (size_t)cpus;
+    if (t > SORT_MAX_THREADS) t = SORT_MAX_THREADS;
+    return t < 1 ? 1 : (int)t;
+}
+
+/* runs fn(ctx, t, threads) on threads threads, the calling thread as t = 0 */
+typedef struct SortWorker {
+    void *(*fn)(void *ctx, int t);
+    void *ctx;
+    int t;
+} SortWorker;
+
+static void *sort_worker_main(void *arg) {
+    SortWorker *w = arg;
+    return w->fn(w->ctx, w->t);
+}
+
+void sort_run_threads(int threads, void *(*fn)(void *, int), void *ctx) {
+    pthread_t tid[SORT_MAX_THREADS];
+    SortWorker w[SORT_MAX_THREADS];
+    int started = 1;
+    for (int t = 1; t < threads; ++t) {
+        w[t] = (SortWorker){fn, ctx, t};
+        if (pthread_create(&tid[t], NULL, sort_worker_main, &w[t]) != 0) break;
+        started++;
+    }
+    // Callers size their barriers for threads; a thread we could not start
+    // would deadlock them, so that is fatal.
+    if (started != threads) { fprintf(stderr, "sort: pthread_create failed\n"); exit(1); }
+    fn(ctx, 0);
+    for (int t = 1; t < threads; ++t) pthread_join(tid[t], NULL);
+}
+
+#define RADIX_MAX_BITS 12
+
+typedef struct RadixJob {
+    uint64_t *keys[2];
+    uint32_t *vals[2];          // NULL: keys carry their values in the low 32 bits
+    size_t n;
+    int threads;
+    int shift, width, passes;   // digits: width bits each, from bit shift up
+    int result;                 // buffer holding the sorted columns
+    size_t (*hist)[2][1 << RADIX_MAX_BITS];   // [thread][pass parity][digit]
+    uint64_t (*stage)[1 << RADIX_MAX_BITS][8]; // [thread][digit]: one cache line per bucket
+    pthread_barrier_t barrier;
+} RadixJob;
+
+static void *radix_worker(void *arg, int t) {
+    RadixJob *job = arg;
+    const size_t lo = job->n * t / job->threads, hi = job->n * (t + 1) / job->threads;
+    const size_t buckets = (size_t)1 << job->width, mask = buckets - 1;
+    size_t offset[1 << RADIX_MAX_BITS];
+    int cur = 0, parity = 0;
+    for (int pass = 0; pass < job->passes; ++pass, parity ^= 1) {
+        const int shift = job->shift + pass * job->width;
+        const uint64_t *keys = job->keys[cur];
+        size_t *h = job->hist[t][parity];
+        memset(h, 0, sizeof(size_t) * buckets);
+        for (size_t i = lo; i < hi; ++i) h[(keys[i] >> shift) & mask]++;
+        pthread_barrier_wait(&job->barrier);
+
+        // Where this thread's keys go: after every smaller digit, then after
+        // earlier threads' keys with the same digit.
+        size_t at = 0;
+        int single = 0;
+        for (size_t d = 0; d < buckets; ++d) {
+            size_t total = 0;
+            for (int u = 0; u < job->threads; ++u) {
+                if (u == t) offset[d] = at + total;
+                total += job->hist[u][parity][d];
+            }
+            if (total == job->n) single = 1;
+            at += total;
+        }
+        // Every thread sees the same histograms, so all skip together; the
+        // next pass writes the other parity, so no barrier is needed here.
+        if (single) continue;
+
+        uint64_t *out_keys = job->keys[cur ^ 1];
+        if (job->vals[0]) {
+            const uint32_t *vals = job->vals[cur];
+            uint32_t *out_vals = job->vals[cur ^ 1];
+            for (size_t i = lo; i < hi; ++i) {
+                size_t o = offset[(keys[i] >> shift) & mask]++;
+                out_keys[o] = keys[i];
+                out_vals[o] = vals[i];
+            }
+        } else {
+            // Dense ids fill every bucket to the same power-of-two size, so
+            // direct stores would hit thousands of addresses that alias in
+            // the cache. Stage a line per bucket and write it out whole.
+            uint64_t (*stage)[8] = job->stage[t];
+            uint8_t fill[1 << RADIX_MAX_BITS];
+            memset(fill, 0, buckets);
+            for (size_t i = lo; i < hi; ++i) {
+                const uint64_t k = keys[i];
+                const size_t d = (k >> shift) & mask;
+                stage[d][fill[d]] = k;
+                if (++fill[d] == 8) {
+                    memcpy(out_keys + offset[d], stage[d], sizeof(stage[d]));
+                    offset[d] += 8;
+                    fill[d] = 0;
+                }
+            }
+            for (size_t d = 0; d < buckets; ++d)
+                memcpy(out_keys + offset[d], stage[d], sizeof(uint64_t) * fill[d]);
+        }
+        cur ^= 1;
+        pthread_barrier_wait(&job->barrier);
+    }
+    if (t == 0) job->result = cur;
+    return NULL;
+}
+
+static void radix_run(RadixJob *job, int threads) {
+    job->threads = threads;
+    job->hist = malloc(sizeof(*job->hist) * threads);
+    job->stage = job->vals[0] ? NULL : aligned_alloc(64, sizeof(*job->stage) * threads);
+    job->result = 0;
+    if (!job->hist || (!job->vals[0] && !job->stage)) { perror("malloc"); exit(1); }
+    pthread_barrier_init(&job->barrier, NULL, threads);
+    sort_run_threads(threads, radix_worker, job);
+    pthread_barrier_destroy(&job->barrier);
+    free(job->hist);
+    free(job->stage);
+}
+
+/* Sorts keys ascending, permuting vals alongside; stable. When the keys span
+   less than 2^32, each (key - min, val) pair is packed into one word and only
+   the bits that vary are sorted, in up to 12-bit digits: half the bytes moved
+   and far fewer passes than 8 over the full width. */
+static void radix_sort_u64(uint64_t *keys, uint32_t *vals, size_t n, int threads) {
+    if (n < 2) return;
+    uint64_t min = keys[0], max = keys[0];
+    for (size_t i = 1; i < n; ++i) {
+        if (keys[i] < min) min = keys[i];
+        if (keys[i] > max) max = keys[i];
+    }
+    if (min == max) return;
+    RadixJob job;
+    job.n = n;
+    job.keys[1] = malloc(sizeof(uint64_t) * n);
+    if (!job.keys[1]) { perror("malloc"); exit(1); }
+    if (max - min <= UINT32_MAX) {
+        int bits = 64 - __builtin_clzll(max - min);
+        job.passes = (bits + RADIX_MAX_BITS - 1) / RADIX_MAX_BITS;
+        job.width = (bits + job.passes - 1) / job.passes;
+        job.shift = 32;
+        job.vals[0] = job.vals[1] = NULL;
+        job.keys[0] = keys;   // packed in place
+        for (size_t i = 0; i < n; ++i) keys[i] = (keys[i] - min) << 32 | vals[i];
+        radix_run(&job, threads);
+        const uint64_t *r = job.keys[job.result];
+        for (size_t i = 0; i < n; ++i) { vals[i] = (uint32_t)r[i]; keys[i] = min + (r[i] >> 32); }
+    } else {
+        job.passes = 8;
+        job.width = 8;
+        job.shift = 0;
+        job.keys[0] = keys;
+        job.vals[0] = vals;
+        job.vals[1] = malloc(sizeof(uint32_t) * n);
+        if (!job.vals[1]) { perror("malloc"); exit(1); }
+        radix_run(&job, threads);
+        if (job.result == 1) {
+            memcpy(keys, job.keys[1], sizeof(uint64_t) * n);
+            memcpy(vals, job.vals[1], sizeof(uint32_t) * n);
+        }
+        free(job.vals[1]);
+    }
+    free(job.keys[1]);
+}
+
+typedef struct TextRec {
+    uint64_t prefix;   // next 8 bytes of the string from depth, big-endian
+    uint32_t val;      // card position
+    uint32_t depth;    // bytes of the string already known equal to its run's
+} TextRec;
+
+static uint64_t text_prefix(const char *s, uint32_t depth) {
+    uint64_t p = 0;
+    s += depth;
+    for (int i = 0; i < 8; ++i) {
+        p = p << 8 | (unsigned char)*s;
+        if (*s) ++s;   // pad with NULs after the end
+    }
+    return p;
+}
+
+/* merges a[0,na) and b[0,nb) into out, a first on ties */
+static void text_merge(const TextRec *a, size_t na, const TextRec *b, size_t nb, TextRec *out) {
+    if (na > 0 && nb > 0 && a[na - 1].prefix <= b[0].prefix) {
+        memcpy(out, a, sizeof(TextRec) * na);
+        memcpy(out + na, b, sizeof(TextRec) * nb);
+        return;
+    }
+    size_t i = 0, j = 0, k = 0;
+    while (i < na && j < nb) out[k++] = b[j].prefix < a[i].prefix ? b[j++] : a[i++];
+    while (i < na) out[k++] = a[i++];
+    while (j < nb) out[k++] = b[j++];
+}
+
+/* how many of a's elements are among the first k of merge(a, b) */
+static size_t text_corank(size_t k, const TextRec *a, size_t na, const TextRec *b, size_t nb) {
+    size_t lo = k > nb ? k - nb : 0, hi = k < na ? k : na;
+    while (lo < hi) {
+        size_t i = lo + (hi - lo) / 2, j = k - i - 1;
+        // a[i] goes before b[j] iff a[i] <= b[j]
+        if (a[i].prefix <= b[j].prefix) lo = i + 1; else hi = i;
+    }
+    return lo;
+}
+
+/* stable bottom-up merge sort of r[0,n) by prefix, tmp as scratch; returns the buffer holding the result */
+static TextRec *text_sort_run(TextRec *r, TextRec *tmp, size_t n) {
+    size_t sorted = 1;
+    while (sorted < n && r[sorted - 1].prefix <= r[sorted].prefix) ++sorted;
+    if (sorted >= n) return r;   // common once a run's prefixes all tie
+    const size_t small = 16;
+    for (size_t lo = 0; lo < n; lo += small) {
+        size_t hi = lo + small < n ? lo + small : n;
+        for (size_t i = lo + 1; i < hi; ++i) {
+            TextRec x = r[i];
+            size_t j = i;
+            while (j > lo && r[j - 1].prefix > x.prefix) { r[j] = r[j - 1]; --j; }
+            r[j] = x;
+        }
+    }
+    TextRec *src = r, *dst = tmp;
+    for (size_t width = small; width < n; width *= 2) {
+        for (size_t lo = 0; lo < n; lo += 2 * width) {
+            size_t mid = lo + width < n ? lo + width : n;
+            size_t hi = lo + 2 * width < n ? lo + 2 * width : n;
+            text_merge(src + lo, mid - lo, src + mid, hi - mid, dst + lo);
+        }
+        TextRec *s = src; src = dst; dst = s;
+    }
+    return src;
+}
+
+static void text_sort(TextRec *r, TextRec *tmp, size_t n, const char *const *text, int threads);
+
+/* moves every record of a tied run on to the next 8 bytes */
+static void text_deepen(TextRec *r, size_t n, const char *const *text) {
+    for (size_t k = 0; k < n; ++k) {
+        r[k].depth += 8;
+        r[k].prefix = text_prefix(text[r[k].val], r[k].depth);
+    }
+}
+
+/* A run of equal prefixes is finished if they end in NUL: the strings ended
+   there, so they are equal and keep their (stable) order. */
+static int text_run_open(const TextRec *r, size_t len) {
+    return len > 1 && (r->prefix & 0xff) != 0;
+}
+
+/* Sorts every run of equal, unfinished prefixes in r[0,n) by the bytes that follow. */
+static void text_refine(TextRec *r, TextRec *tmp, size_t n, const char *const *text) {
+    size_t i = 0;
+    while (i < n) {
+        size_t j = i + 1;
+        while (j < n && r[j].prefix == r[i].prefix) ++j;
+        if (text_run_open(r + i, j - i)) {
+            text_deepen(r + i, j - i, text);
+            text_sort(r + i, tmp + i, j - i, text, 1);
+        }
+        i = j;
+    }
+}
+
+typedef struct TextJob {
+    TextRec *buf[2];
+    size_t n;
+    int threads;
+    int result;
+    const char *const *text;
+    const size_t (*runs)[2];   // phase 3: tied runs {start, length}, by start
+    size_t run_count;
+    pthread_barrier_t barrier;
+} TextJob;
+
+/* phases 1 and 2: sort chunks, then merge them pairwise */
+static void *text_worker(void *arg, int t) {
+    TextJob *job = arg;
+    const size_t n = job->n;
+    const int threads = job->threads;
+    const size_t lo = n * t / threads, hi = n * (t + 1) / threads;
+
+    TextRec *sorted = text_sort_run(job->buf[0] + lo, job->buf[1] + lo, hi - lo);
+    if (sorted != job->buf[0] + lo) memcpy(job->buf[0] + lo, sorted, sizeof(TextRec) * (hi - lo));
+    pthread_barrier_wait(&job->barrier);
+
+    // Runs start at chunk boundaries; every thread takes an equal slice of
+    // each round's output and finds its inputs by co-ranking.
+    int cur = 0;
+    for (int width = 1; width < threads; width *= 2) {
+        const TextRec *src = job->buf[cur];
+        TextRec *dst = job->buf[cur ^ 1];
+        for (int first = 0; first < threads; first += 2 * width) {
+            size_t a = n * first / threads;
+            size_t m = n * (first + width < threads ? first + width : threads) / threads;
+            size_t b = n * (first + 2 * width < threads ? first + 2 * width : threads) / threads;
+            size_t from = lo > a ? lo : a, to = hi < b ? hi : b;
+            if (from >= to) continue;
+            size_t i0 = text_corank(from - a, src + a, m - a, src + m, b - m);
+            size_t i1 = text_corank(to - a, src + a, m - a, src + m, b - m);
+            size_t j0 = from - a - i0, j1 = to - a - i1;
+            text_merge(src + a + i0, i1 - i0, src + m + j0, j1 - j0, dst + from);
+        }
+        cur ^= 1;
+        pthread_barrier_wait(&job->barrier);
+    }
+    if (t == 0) job->result = cur;
+    return NULL;
+}
+
+/* phase 3: each thread sorts the tied runs that start in its chunk */
+static void *text_tie_worker(void *arg, int t) {
+    TextJob *job = arg;
+    const size_t lo = job->n * t / job->threads, hi = job->n * (t + 1) / job->threads;
+    for (size_t k = 0; k < job->run_count; ++k) {
+        const size_t start = job->runs[k][0], len = job->runs[k][1];
+        if (start < lo || start >= hi) continue;
+        text_deepen(job->buf[0] + start, len, job->text);
+        text_sort(job->buf[0] + start, job->buf[1] + start, len, job->text, 1);
+    }
+    return NULL;
+}
+
+/* Sorts r[0,n) by the strings behind them, given prefixes at their depth. */
+static void text_sort(TextRec *r, TextRec *tmp, size_t n, const char *const *text, int threads) {
+    if (threads <= 1 || n < (size_t)threads * SORT_MIN_PER_THREAD) {
+        TextRec *sorted = text_sort_run(r, tmp, n);
+        if (sorted != r) memcpy(r, sorted, sizeof(TextRec) * n);
+        text_refine(r, tmp, n, text);
+        return;
+    }
+    TextJob job;
+    job.buf[0] = r;
+    job.buf[1] = tmp;
+    job.n = n;
+    job.threads = threads;
+    job.text = text;
+    pthread_barrier_init(&job.barrier, NULL, threads);
+    sort_run_threads(threads, text_worker, &job);
+    pthread_barrier_destroy(&job.barrier);
+    if (job.result == 1) memcpy(r, tmp, sizeof(TextRec) * n);
+
+    // Ties: big runs (a deck full of "What is ...") get all threads again;
+    // the rest are shared out by where they start.
+    size_t (*runs)[2] = NULL, count = 0, cap = 0;
+    for (size_t i = 0; i < n;) {
+        size_t j = i + 1;
+        while (j < n && r[j].prefix == r[i].prefix) ++j;
+        if (!text_run_open(r + i, j - i)) {
+            // finished or single
+        } else if (j - i >= (size_t)threads * SORT_MIN_PER_THREAD) {
+            text_deepen(r + i, j - i, text);
+            text_sort(r + i, tmp + i, j - i, text, threads);
+        } else {
+            if (count == cap) {
+                cap = cap ? cap * 2 : 1024;
+                runs = realloc(runs, sizeof(*runs) * cap);
+                if (!runs) { perror("realloc"); exit(1); }
+            }
+            runs[count][0] = i;
+            runs[count][1] = j - i;
+            count++;
+        }
+        i = j;
+    }
+    if (count > 0) {
+        job.runs = (const size_t (*)[2])runs;
+        job.run_count = count;
+        sort_run_threads(threads, text_tie_worker, &job);
+    }
+    free(runs);
+}
+
+/* Fills vals with 0..n-1 ordered by text[i] (bytewise, like strcmp); stable. */
+static void merge_sort_text(const char *const *text, uint32_t *vals, size_t n, int threads) {
+    TextRec *r = malloc(sizeof(TextRec) * (n ? n : 1));
+    TextRec *tmp = malloc(sizeof(TextRec) * (n ? n : 1));
+    if (!r || !tmp) { perror("malloc"); exit(1); }
+    for (size_t i = 0; i < n; ++i) r[i] = (TextRec){text_prefix(text[i], 0), (uint32_t)i, 0};
+    text_sort(r, tmp, n, text, threads);
+    for (size_t i = 0; i < n; ++i) vals[i] = r[i].val;
+    free(r);
+    free(tmp);
+}
+
+typedef enum { SORT_BY_ID, SORT_BY_DUE, SORT_BY_INTERVAL, SORT_BY_QUESTION } SortKey;
+
+/* maps signed ints onto unsigned so that unsigned order is signed order */
+static uint64_t sort_key_int(int x) { return (uint32_t)x ^ 0x80000000u; }
+
+static uint64_t card_sort_key(const Card *c, SortKey key) {
+    switch (key) {
+    case SORT_BY_DUE:      return sort_key_int(c->due_in);
+    case SORT_BY_INTERVAL: return sort_key_int(c->interval);
+    default:               return sort_key_int(c->id);
+    }
+}
+
+/* Returns the cards in key order (count in *out_n), or NULL if there are none. */
+static Card **cards_sorted(SortKey key, size_t *out_n) {
+    size_t n = 0;
+    for (Card *c = cards_head; c; c = c->next) n++;
+    *out_n = n;
+    if (n == 0) return NULL;
+    Card **col = malloc(sizeof(Card*) * n);
+    uint32_t *order = malloc(sizeof(uint32_t) * n);
+    Card **out = malloc(sizeof(Card*) * n);
+    if (!col || !order || !out) { perror("malloc"); exit(1); }
+    size_t i = 0;
+    for (Card *c = cards_head; c; c = c->next) col[i++] = c;
+    const int threads = sort_threads(n);
+    if (key == SORT_BY_QUESTION) {
+        const char **text = malloc(sizeof(char*) * n);
+        if (!text) { perror("malloc"); exit(1); }
+        for (i = 0; i < n; ++i) text[i] = col[i]->question;
+        merge_sort_text(text, order, n, threads);
+        free(text);
+    } else {
+        // Ties on due or interval go by id: sort by id first, then stably
+        // by the field (two narrow sorts beat one over a 64-bit composite).
+        uint64_t *keys = malloc(sizeof(uint64_t) * n);
+        if (!keys) { perror("malloc"); exit(1); }
+        for (i = 0; i < n; ++i) { keys[i] = card_sort_key(col[i], SORT_BY_ID); order[i] = (uint32_t)i; }
+        radix_sort_u64(keys, order, n, threads);
+        if (key != SORT_BY_ID) {
+            for (i = 0; i < n; ++i) keys[i] = card_sort_key(col[order[i]], key);
+            radix_sort_u64(keys, order, n, threads);
+        }
+        free(keys);
+    }
+    for (i = 0; i < n; ++i) out[i] = col[order[i]];
+    free(col);
+    free(order);
+    return out;
+}
+
 /* --- User interface helpers --- */
-static void list_all_cards(void) {
-    if (!cards_head) { printf("No cards.\n"); return; }
+static void list_all_cards(SortKey key, int descending) {
+    size_t n;
+    Card **sorted = cards_sorted(key, &n);
+    if (!sorted) { printf("No cards.\n"); return; }
     printf("All cards:\n");
-    for (Card *c = cards_head; c; c = c->next) {
+    for (size_t i = 0; i < n; ++i) {
+        Card *c = sorted[descending ? n - 1 - i : i];
         printf("ID %d: Q: %.60s", c->id, c->question);
         if (strlen(c->question) > 60) printf("...");
         printf(" | tags:");
@@ -494,6 +1733,20 @@ static void list_all_cards(void) {
         }
         printf(" | interval=%d due_in=%d\n", c->interval, c->due_in);
     }
+    free(sorted);
+}
+
+/* parses "id", "due", "interval" or "question", optionally prefixed by '-'
+   for descending order; empty means id */
+static int parse_sort_key(const char *s, SortKey *key, int *descending) {
+    *descending = *s == '-';
+    if (*descending) s++;
+    if (*s == 0 || strcmp(s, "id") == 0) *key = SORT_BY_ID;
+    else if (strcmp(s, "due") == 0) *key = SORT_BY_DUE;
+    else if (strcmp(s, "interval") == 0) *key = SORT_BY_INTERVAL;
+    else if (strcmp(s, "question") == 0) *key = SORT_BY_QUESTION;
+    else return 0;
+    return 1;
 }
 
 static void search_by_tag(const char *tag) {
@@ -506,6 +1759,9 @@ static void search_by_tag(const char *tag) {
         return;
     }
     printf("Cards with tag '%s':\n", nt);
+    if (e->think)
+        printf("Thinking time: p50 %.1f s, p90 %.1f s over %.0f reviews\n",
+               tdigest_quantile(e->think, 0.5), tdigest_quantile(e->think, 0.9), e->think->total);
     CardListNode *cn = e->cards;
     while (cn) {
         Card *c = cn->card;
@@ -542,6 +1798,7 @@ static void add_card_interactive(Queue *q) {
     Card *c = create_card(qtext, atext, tks, tcount);
     // new cards are due immediately
     c->due_in = 0;
+    live_append(live_deck, c);
     queue_enqueue(q, c);
     printf("Added card ID %d\n", c->id);
     free(qtext); free(atext);
@@ -573,6 +1830,7 @@ static void remove_card_interactive(Queue *q) {
     }
     q->head = new_head; q->tail = new_tail;
     // remove card from global lists and free
+    live_remove(c);
     delete_card(c);
     // recompute queue size
     int sz = 0; for (QueueNode *n = q->head; n; n = n->next) ++sz;
@@ -592,13 +1850,973 @@ static void load_sample_cards(Queue *q) {
     for (Card *c = cards_head; c; c = c->next) queue_enqueue(q, c);
 }
 
+/* --- Timing helper --- */
+double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* --- Arena: bump allocator over one mmap'd region --- */
+/* Shards allocate their cards, strings and scheduler ring out of a single arena.
+   The region is reserved with mmap but not touched, so the pages land on the NUMA
+   node of whichever thread first writes them (and mbind makes that explicit).
+   We ask for explicit huge pages first (MAP_HUGETLB, needs vm.nr_hugepages), then
+   fall back to transparent huge pages via madvise, then to normal pages. */
+#define ARENA_HUGE_PAGE (2UL << 20)
+#define ARENA_ALIGN 16
+
+typedef struct Arena {
+    char *base;
+    size_t size, used;
+    int huge;          // 2 = explicit hugetlb, 1 = THP advised, 0 = normal pages
+} Arena;
+
+static int arena_init(Arena *a, size_t size, int want_huge) {
+    size = (size + ARENA_HUGE_PAGE - 1) & ~(ARENA_HUGE_PAGE - 1);
+    a->base = MAP_FAILED;
+    a->huge = 0;
+#ifdef MAP_HUGETLB
+    if (want_huge) {
+        a->base = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (a->base != MAP_FAILED) a->huge = 2;
+    }
+#endif
+    if (a->base == MAP_FAILED) {
+        a->base = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (a->base == MAP_FAILED) { perror("mmap"); return -1; }
+#ifdef MADV_HUGEPAGE
+        if (want_huge && madvise(a->base, size, MADV_HUGEPAGE) == 0) a->huge = 1;
+#endif
+    }
+    a->size = size;
+    a->used = 0;
+    return 0;
+}
+
+static void *arena_alloc(Arena *a, size_t n) {
+    size_t off = (a->used + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if (off + n > a->size) {
+        fprintf(stderr, "arena exhausted (%zu of %zu bytes)\n", off + n, a->size);
+        exit(1);
+    }
+    a->used = off + n;
+    return a->base + off;
+}
+
+static char *arena_strdup(Arena *a, const char *s) {
+    size_t n = strlen(s) + 1;
+    char *p = arena_alloc(a, n);
+    memcpy(p, s, n);
+    return p;
+}
+
+static void arena_destroy(Arena *a) {
+    if (a->base && a->base != MAP_FAILED) munmap(a->base, a->size);
+    a->base = NULL;
+    a->size = a->used = 0;
+}
+
+/* --- NUMA topology (read from sysfs, no libnuma needed) --- */
+#define MAX_NUMA_NODES 64
+#define MAX_NODE_CPUS 256
+#define NUMA_MPOL_PREFERRED 1   // from <numaif.h>
+
+typedef struct NumaTopology {
+    int nodes;
+    int node_id[MAX_NUMA_NODES];
+    int cpu_count[MAX_NUMA_NODES];
+    int cpus[MAX_NUMA_NODES][MAX_NODE_CPUS];
+} NumaTopology;
+
+/* parse a sysfs cpulist such as "0-3,8-11" */
+static int parse_cpulist(const char *s, int *out, int cap) {
+    int n = 0;
+    while (*s && n < cap) {
+        char *end;
+        long lo = strtol(s, &end, 10), hi = lo;
+        if (end == s) break;
+        if (*end == '-') hi = strtol(end + 1, &end, 10);
+        for (long c = lo; c <= hi && n < cap; ++c) out[n++] = (int)c;
+        s = (*end == ',') ? end + 1 : end;
+        if (*s == '\n') break;
+    }
+    return n;
+}
+
+static void numa_discover(NumaTopology *t) {
+    memset(t, 0, sizeof(*t));
+    for (int node = 0; node < 1024 && t->nodes < MAX_NUMA_NODES; ++node) {
+        char path[128], buf[LINEBUF];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        FILE *f = fopen(path, "r");
+        if (!f) continue;
+        if (fgets(buf, sizeof(buf), f)) {
+            int cnt = parse_cpulist(buf, t->cpus[t->nodes], MAX_NODE_CPUS);
+            if (cnt > 0) {
+                t->node_id[t->nodes] = node;
+                t->cpu_count[t->nodes] = cnt;
+                t->nodes++;
+            }
+        }
+        fclose(f);
+    }
+    if (t->nodes == 0) {
+        // no sysfs node info: one node holding every CPU we may run on
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        sched_getaffinity(0, sizeof(set), &set);
+        for (int c = 0; c < CPU_SETSIZE && t->cpu_count[0] < MAX_NODE_CPUS; ++c)
+            if (CPU_ISSET(c, &set)) t->cpus[0][t->cpu_count[0]++] = c;
+        if (t->cpu_count[0] == 0) t->cpus[0][t->cpu_count[0]++] = 0;
+        t->nodes = 1;
+    }
+}
+
+/* prefer the given node for an arena's pages; failure just leaves first-touch */
+static void arena_bind_node(Arena *a, int node) {
+#ifdef SYS_mbind
+    unsigned long mask[MAX_NUMA_NODES / (8 * sizeof(unsigned long)) + 1] = {0};
+    if (node < 0 || node >= MAX_NUMA_NODES) return;
+    mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+    syscall(SYS_mbind, a->base, a->size, NUMA_MPOL_PREFERRED, mask,
+            (unsigned long)MAX_NUMA_NODES + 1, 0);
+#else
+    (void)a; (void)node;
+#endif
+}
+
+static int pin_current_thread(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+/* --- Sharded engine --- */
+/* Each shard owns a slice of the deck: its cards, their strings and a rotation
+   ring for the scheduler all live in the shard's arena. With placement on, the
+   shard thread pins itself to a core, binds its arena to that core's node and
+   builds its slice there, so scheduler rotations and tag scans never leave the
+   node and walk far fewer TLB entries thanks to the huge pages. */
+const char *shard_tag_vocab[SHARD_TAG_VOCAB] = {
+    "queue", "stack", "hashmap", "tree", "graph", "heap", "dp", "trie"
+};
+
+typedef struct Shard {
+    int index;
+    int node, cpu;             // placement (cpu < 0 => unpinned)
+    int placed;                // pin + node-local + huge pages
+    int first_id, count;
+    Arena arena;
+    Card **cards;              // arena array of count cards
+    Card **ring;               // scheduler rotation ring (capacity count)
+    int ring_head;
+    long sched_ops, search_hits;
+    double sched_secs, search_secs;
+    pthread_t thread;
+    pthread_barrier_t *start;
+} Shard;
+
+static void shard_populate(Shard *s) {
+    char buf[128];
+    s->cards = arena_alloc(&s->arena, sizeof(Card*) * s->count);
+    s->ring = arena_alloc(&s->arena, sizeof(Card*) * s->count);
+    for (int i = 0; i < s->count; ++i) {
+        int id = s->first_id + i;
+        Card *c = arena_alloc(&s->arena, sizeof(Card));
+        c->id = id;
+        snprintf(buf, sizeof(buf), "Synthetic question %d about %s?", id,
+                 shard_tag_vocab[id % SHARD_TAG_VOCAB]);
+        c->question = arena_strdup(&s->arena, buf);
+        snprintf(buf, sizeof(buf), "Synthetic answer %d", id);
+        c->answer = arena_strdup(&s->arena, buf);
+        c->tag_count = 2;
+        c->tags = arena_alloc(&s->arena, sizeof(char*) * 2);
+        c->tags[0] = arena_strdup(&s->arena, shard_tag_vocab[id % SHARD_TAG_VOCAB]);
+        c->tags[1] = arena_strdup(&s->arena, shard_tag_vocab[(id / 7) % SHARD_TAG_VOCAB]);
+        c->interval = 1;
+        c->due_in = id % 4;
+        c->slot = -1;
+        c->next = NULL;
+        s->cards[i] = c;
+        s->ring[i] = c;
+    }
+    s->ring_head = 0;
+}
+
+/* same rotation rule as practice_loop, answering with a fixed pseudo-random pattern */
+static void shard_run_scheduler(Shard *s, long ops) {
+    unsigned int rng = 2463534242u + s->index;
+    double t0 = now_seconds();
+    for (long op = 0; op < ops; ++op) {
+        Card *c = s->ring[s->ring_head];
+        if (c->due_in > 0) {
+            c->due_in -= 1;
+        } else {
+            rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+            if (rng % 4) {
+                c->interval = c->interval < (1 << 20) ? c->interval * 2 : c->interval;
+                c->due_in = c->interval;
+            } else {
+                c->interval = 1;
+                c->due_in = 1;
+            }
+        }
+        // dequeue + reenqueue on a full ring is just advancing the head
+        if (++s->ring_head == s->count) s->ring_head = 0;
+    }
+    s->sched_secs = now_seconds() - t0;
+    s->sched_ops = ops;
+}
+
+static void shard_run_search(Shard *s, int passes) {
+    long hits = 0;
+    double t0 = now_seconds();
+    for (int p = 0; p < passes; ++p) {
+        const char *tag = shard_tag_vocab[p % SHARD_TAG_VOCAB];
+        for (int i = 0; i < s->count; ++i) {
+            Card *c = s->cards[i];
+            for (int t = 0; t < c->tag_count; ++t)
+                if (strcmp(c->tags[t], tag) == 0) { hits++; break; }
+        }
+    }
+    s->search_secs = now_seconds() - t0;
+    s->search_hits = hits;
+}
+
+#define SHARD_SCHED_ROUNDS 20
+#define SHARD_SEARCH_PASSES 16
+
+static void *shard_main(void *arg) {
+    Shard *s = arg;
+    if (s->placed) {
+        if (pin_current_thread(s->cpu) != 0) s->cpu = -1;
+        arena_bind_node(&s->arena, s->node);
+        shard_populate(s);   // first touch from the pinned thread
+    }
+    pthread_barrier_wait(s->start);
+    shard_run_scheduler(s, (long)s->count * SHARD_SCHED_ROUNDS);
+    pthread_barrier_wait(s->start);
+    shard_run_search(s, SHARD_SEARCH_PASSES);
+    return NULL;
+}
+
+/* rough upper bound on arena bytes for one synthetic card */
+#define SHARD_BYTES_PER_CARD 256
+
+static int shard_bench_run(const NumaTopology *topo, int total_cards, int nshards,
+                           int placed) {
+    Shard *shards = calloc(nshards, sizeof(Shard));
+    pthread_barrier_t start;
+    pthread_barrier_init(&start, NULL, nshards);
+    int per = total_cards / nshards;
+    for (int i = 0; i < nshards; ++i) {
+        Shard *s = &shards[i];
+        int n = i % topo->nodes;
+        s->index = i;
+        s->node = topo->node_id[n];
+        s->cpu = topo->cpus[n][(i / topo->nodes) % topo->cpu_count[n]];
+        s->placed = placed;
+        s->first_id = i * per + 1;
+        s->count = (i == nshards - 1) ? total_cards - i * per : per;
+        s->start = &start;
+        if (arena_init(&s->arena, (size_t)s->count * SHARD_BYTES_PER_CARD, placed) != 0) {
+            free(shards);
+            return -1;
+        }
+        // baseline: the main thread touches every page, as a plain load would
+        if (!placed) shard_populate(s);
+    }
+    for (int i = 0; i < nshards; ++i)
+        pthread_create(&shards[i].thread, NULL, shard_main, &shards[i]);
+    for (int i = 0; i < nshards; ++i) pthread_join(shards[i].thread, NULL);
+
+    long ops = 0, scanned = 0, hits = 0;
+    double sched_secs = 0, search_secs = 0;
+    int huge = 0;
+    for (int i = 0; i < nshards; ++i) {
+        Shard *s = &shards[i];
+        ops += s->sched_ops;
+        scanned += (long)s->count * SHARD_SEARCH_PASSES;
+        hits += s->search_hits;
+        if (s->sched_secs > sched_secs) sched_secs = s->sched_secs;
+        if (s->search_secs > search_secs) search_secs = s->search_secs;
+        if (s->arena.huge > huge) huge = s->arena.huge;
+        arena_destroy(&s->arena);
+    }
+    printf("%-9s shards=%d pages=%-8s scheduler=%8.1f Mops/s  search=%8.1f Mcards/s (%ld hits)\n",
+           placed ? "placed" : "baseline", nshards,
+           huge == 2 ? "hugetlb" : huge == 1 ? "thp" : "4k",
+           ops / sched_secs / 1e6, scanned / search_secs / 1e6, hits);
+    pthread_barrier_destroy(&start);
+    free(shards);
+    return 0;
+}
+
+static int bench_shards(int argc, char **argv) {
+    NumaTopology topo;
+    numa_discover(&topo);
+    int total_cpus = 0;
+    for (int n = 0; n < topo.nodes; ++n) total_cpus += topo.cpu_count[n];
+    int cards = argc > 0 ? atoi(argv[0]) : 1000000;
+    int nshards = argc > 1 ? atoi(argv[1]) : total_cpus;
+    if (cards <= 0) cards = 1000000;
+    if (nshards <= 0) nshards = 1;
+    if (nshards > cards) nshards = cards;
+    printf("NUMA nodes: %d, cpus: %d, cards: %d\n", topo.nodes, total_cpus, cards);
+    if (shard_bench_run(&topo, cards, nshards, 0) != 0) return 1;
+    if (shard_bench_run(&topo, cards, nshards, 1) != 0) return 1;
+    return 0;
+}
+
+/* --- Top-k selection and practice catch-up ---
+   Shared with the class engine (FlashSprintClass.c), whose learner planner
+   ranks overdue cards with the same score and key. */
+/* Bounded top-k selection: key/val hold a min-heap of the best *n (at most
+   k) items offered so far, worst at the root; topk_sort then orders them
+   best first. O(log k) per offer, one pass over the candidates. */
+void topk_offer(int32_t *key, uint32_t *val, uint32_t *n, uint32_t k, int32_t v, uint32_t item) {
+    uint32_t at, c;
+    if (*n < k) {
+        for (at = (*n)++; at > 0 && key[(at - 1) / 2] > v; at = (at - 1) / 2) {
+            key[at] = key[(at - 1) / 2];
+            val[at] = val[(at - 1) / 2];
+        }
+    } else if (k > 0 && v > key[0]) {
+        for (at = 0; (c = 2 * at + 1) < *n; at = c) {
+            if (c + 1 < *n && key[c + 1] < key[c]) c++;
+            if (key[c] >= v) break;
+            key[at] = key[c];
+            val[at] = val[c];
+        }
+    } else {
+        return;
+    }
+    key[at] = v;
+    val[at] = item;
+}
+
+/* pops the minimum to the back until the heap is empty: best first */
+void topk_sort(int32_t *key, uint32_t *val, uint32_t n) {
+    for (uint32_t end = n; end-- > 1;) {
+        int32_t v = key[end];
+        uint32_t item = val[end], at, c;
+        key[end] = key[0];
+        val[end] = val[0];
+        for (at = 0; (c = 2 * at + 1) < end; at = c) {
+            if (c + 1 < end && key[c + 1] < key[c]) c++;
+            if (key[c] >= v) break;
+            key[at] = key[c];
+            val[at] = val[c];
+        }
+        key[at] = v;
+        val[at] = item;
+    }
+}
+
+/* Rank of an overdue card, higher first: overdue and interval in days (or
+   practice rounds), stability the interval as the scheduler would stretch
+   it for this learner. */
+double catch_up_score(int mode, double overdue, double interval, double stability) {
+    if (mode == CATCHUP_OVERDUE_RATIO) return -overdue / interval;
+    return 1 / (1 + (overdue + stability) / (9 * stability));
+}
+
+/* an int32 selection key in the same order as score: the bits of the float,
+   with negatives flipped so they sort below positives and each other in
+   reverse. Keeps ~7 significant digits wherever the score lies, so even
+   cards overdue for months still rank among themselves. */
+int32_t catch_up_key(double score) {
+    union { float f; int32_t i; } u = { (float)score };
+    return u.i < 0 ? u.i ^ INT32_MAX : u.i;
+}
+
+/* The practice loop's catch-up: keeps the per_round due cards of session
+   most likely still remembered, ranked by retrievability with the rounds
+   they have been held back as the time overdue. The rest go back to the
+   queue still due, one round further overdue. */
+static size_t practice_catch_up(Queue *q, Card **session, size_t n, size_t per_round) {
+    int32_t *key = malloc(sizeof(int32_t) * per_round);
+    uint32_t *pick = malloc(sizeof(uint32_t) * per_round), kept = 0;
+    uint8_t *keep = calloc(n, 1);
+    for (size_t i = 0; i < n; ++i) {
+        double interval = session[i]->interval > 0 ? session[i]->interval : 1;
+        double score = catch_up_score(CATCHUP_RETRIEVABILITY, session[i]->overdue, interval, interval);
+        topk_offer(key, pick, &kept, (uint32_t)per_round, catch_up_key(score), (uint32_t)i);
+    }
+    for (uint32_t r = 0; r < kept; ++r) keep[pick[r]] = 1;
+    size_t out = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (keep[i]) {
+            session[out++] = session[i];
+        } else {
+            session[i]->overdue++;
+            queue_enqueue(q, session[i]);
+        }
+    }
+    free(key); free(pick); free(keep);
+    return out;
+}
+
+/* --- Benchmarks of the console's own engines (digest, interleave, sort) ---
+   The class benchmarks live with the class engine in FlashSprintClass.c. */
+/* xorshift64: synthetic data for every benchmark */
+uint64_t bench_xorshift(uint64_t *s) {
+    *s ^= *s << 13; *s ^= *s >> 7; *s ^= *s << 17;
+    return *s;
+}
+
+static int bench_float_cmp(const void *a, const void *b) {
+    float x = *(const float *)a, y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+/* fraction of sorted[0, n) below x: the rank an estimate really has */
+static double bench_rank_of(const float *sorted, size_t n, float x) {
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (sorted[mid] < x) lo = mid + 1; else hi = mid;
+    }
+    return (double)lo / n;
+}
+
+static void bench_digest_report(const char *label, TDigest *d, const float *sorted, size_t n) {
+    static const double qs[] = {0.5, 0.9, 0.99};
+    printf("  %-16s", label);
+    for (int i = 0; i < 3; ++i) {
+        float est = tdigest_quantile(d, qs[i]);
+        printf("  p%-2.0f %6.2f s (rank %.4f)", qs[i] * 100, est, bench_rank_of(sorted, n, est));
+    }
+    printf("  %d centroids\n", d->count);
+}
+
+static int bench_digest(int argc, char **argv) {
+    long n = argc > 0 ? atol(argv[0]) : 1000000;
+    int shards = argc > 1 ? atoi(argv[1]) : 8;
+    if (n <= 0) n = 1000000;
+    if (shards <= 0 || shards > 64) shards = 8;
+
+    // Thinking times: mostly a few seconds, skewed right, plus a tail of
+    // distracted reviews.
+    float *v = malloc(sizeof(float) * n), *sorted = malloc(sizeof(float) * n);
+    if (!v || !sorted) { perror("malloc"); return 1; }
+    uint64_t rng = 0x9e3779b97f4a7c15ull;
+    for (long i = 0; i < n; ++i) {
+        double u[4];
+        for (int k = 0; k < 4; ++k) {
+            rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+            u[k] = (rng >> 11) * (1.0 / 9007199254740992.0);
+        }
+        v[i] = (float)(0.5 + 12 * u[0] * u[1] + (u[2] < 0.05 ? 60 * u[3] : 0));
+    }
+    memcpy(sorted, v, sizeof(float) * n);
+    qsort(sorted, n, sizeof(float), bench_float_cmp);
+    printf("digest bench: %ld response times, %d shards; exact p50 %.2f s, p90 %.2f s, p99 %.2f s\n",
+           n, shards, sorted[n / 2], sorted[(size_t)(n * 0.9)], sorted[(size_t)(n * 0.99)]);
+
+    TDigest *shard[64];
+    for (int s = 0; s < shards; ++s) shard[s] = tdigest_new(TDIGEST_WIDE);
+    double t0 = now_seconds();
+    for (long i = 0; i < n; ++i) tdigest_add(shard[i % shards], v[i]);
+    for (int s = 0; s < shards; ++s) tdigest_flush(shard[s]);
+    double add = now_seconds() - t0;
+    TDigest *all = tdigest_new(TDIGEST_WIDE);
+    t0 = now_seconds();
+    for (int s = 0; s < shards; ++s) tdigest_merge(all, shard[s]);
+    tdigest_flush(all);
+    double merge = now_seconds() - t0;
+    printf("  add %.1f ns/value; merging %d shards took %.1f us; %zu bytes per digest\n",
+           add / n * 1e9, shards, merge * 1e6, tdigest_bytes(all));
+    bench_digest_report("shard 0", shard[0], sorted, n);
+    bench_digest_report("merged", all, sorted, n);
+
+    // one digest fed in ascending order, the worst case for centroid count
+    TDigest *asc = tdigest_new(TDIGEST_WIDE);
+    for (long i = 0; i < n; ++i) tdigest_add(asc, sorted[i]);
+    bench_digest_report("ascending input", asc, sorted, n);
+
+    // a per-card digest sees a handful of reviews
+    TDigest *card = tdigest_new(TDIGEST_CARD);
+    for (long i = 0; i < n && i < 1000; ++i) tdigest_add(card, v[i]);
+    printf("  per-card digest: %zu bytes; after 1000 reviews p50 %.2f s, p90 %.2f s\n",
+           tdigest_bytes(card), tdigest_quantile(card, 0.5), tdigest_quantile(card, 0.9));
+
+    for (int s = 0; s < shards; ++s) free(shard[s]);
+    free(all);
+    free(asc);
+    free(card);
+    free(v);
+    free(sorted);
+    return 0;
+}
+
+static long bench_tag_clashes(Card *const *cards, size_t n) {
+    long clashes = 0;
+    for (size_t i = 1; i < n; ++i) clashes += cards_share_tag(cards[i - 1], cards[i]);
+    return clashes;
+}
+
+static int bench_interleave(int argc, char **argv) {
+    long n = argc > 0 ? atol(argv[0]) : 100000;
+    int tags = argc > 1 ? atoi(argv[1]) : 200;
+    if (n <= 0) n = 100000;
+    if (tags <= 0) tags = 200;
+
+    // cards added topic by topic, as a deck usually is: a skewed first tag
+    // and a second tag from anywhere
+    char (*names)[16] = malloc(sizeof(*names) * tags);
+    for (int t = 0; t < tags; ++t) snprintf(names[t], sizeof(names[t]), "tag%d", t);
+    Card *pool = calloc(n, sizeof(Card));
+    char **tag_ptrs = malloc(sizeof(char*) * 2 * n);
+    Card **session = malloc(sizeof(Card*) * n);
+    uint64_t rng = 0x9e3779b97f4a7c15ull;
+    uint64_t *keys = malloc(sizeof(uint64_t) * n);
+    uint32_t *order = malloc(sizeof(uint32_t) * n);
+    for (long i = 0; i < n; ++i) {
+        double u = (bench_xorshift(&rng) >> 11) * (1.0 / 9007199254740992.0);
+        int first = (int)(u * u * tags), second = (int)(bench_xorshift(&rng) % (uint64_t)tags);
+        pool[i].id = (int)i;
+        pool[i].tags = tag_ptrs + 2 * i;
+        pool[i].tags[0] = names[first];
+        pool[i].tags[1] = names[second];
+        pool[i].tag_count = first == second ? 1 : 2;
+        keys[i] = (uint64_t)first << 32 | (uint64_t)i;
+        order[i] = (uint32_t)i;
+    }
+    radix_sort_u64(keys, order, n, 1);
+    for (long i = 0; i < n; ++i) session[i] = &pool[order[i]];
+    long before = bench_tag_clashes(session, n);
+    double t0 = now_seconds();
+    session_interleave(session, n);
+    double plan = now_seconds() - t0;
+    long after = bench_tag_clashes(session, n);
+    int seen = 1;
+    for (long i = 0; i < n && seen; ++i) seen = session[i] >= pool && session[i] < pool + n;
+    printf("interleave bench: %ld due cards over %d tags\n", n, tags);
+    printf("  planned in %.1f ms (%.0f ns/card); neighbours sharing a tag: %ld in deck order, %ld after%s\n",
+           plan * 1e3, plan / n * 1e9, before, after, seen ? "" : " (BAD CARD)");
+    free(names); free(pool); free(tag_ptrs); free(session); free(keys); free(order);
+    return 0;
+}
+
+static int bench_sort_check(const uint64_t *keys, size_t n) {
+    for (size_t i = 1; i < n; ++i) if (keys[i - 1] > keys[i]) return 0;
+    return 1;
+}
+
+static int bench_sort(int argc, char **argv) {
+    size_t n = argc > 0 ? (size_t)atol(argv[0]) : 10000000;
+    if (n == 0 || n > UINT32_MAX) n = 10000000;
+    int threads = argc > 1 ? atoi(argv[1]) : sort_threads(n);
+    if (threads < 1) threads = 1;
+    if (threads > SORT_MAX_THREADS) threads = SORT_MAX_THREADS;
+
+    // Synthetic key columns: shuffled ids, due dates, and questions that
+    // share prefixes the way a real deck's do.
+    uint64_t *ids = malloc(sizeof(uint64_t) * n), *due = malloc(sizeof(uint64_t) * n);
+    uint64_t *keys = malloc(sizeof(uint64_t) * n);
+    uint32_t *vals = malloc(sizeof(uint32_t) * n);
+    const char **text = malloc(sizeof(char*) * n);
+    Arena heap;
+    if (!ids || !due || !keys || !vals || !text || arena_init(&heap, n * 48, 0) != 0) {
+        perror("bench sort");
+        return 1;
+    }
+    uint64_t rng = 0x9e3779b97f4a7c15ULL;
+    char buf[96];
+    for (size_t i = 0; i < n; ++i) ids[i] = sort_key_int((int)(i + 1));
+    for (size_t i = n - 1; i > 0; --i) {
+        rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+        size_t j = rng % (i + 1);
+        uint64_t x = ids[i]; ids[i] = ids[j]; ids[j] = x;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        rng ^= rng << 13; rng ^= rng >> 7; rng ^= rng << 17;
+        due[i] = sort_key_int((int)(rng % 1000));
+        snprintf(buf, sizeof(buf), "What is the cost of %s operation %u?",
+                 shard_tag_vocab[(rng >> 20) % SHARD_TAG_VOCAB], (unsigned)(rng >> 40) % 1000000);
+        text[i] = arena_strdup(&heap, buf);
+    }
+    printf("sort bench: %zu cards, %d thread(s)\n", n, threads);
+
+    // by id, then by (due, id) the way cards_sorted does it
+    memcpy(keys, ids, sizeof(uint64_t) * n);
+    for (size_t i = 0; i < n; ++i) vals[i] = (uint32_t)i;
+    double t0 = now_seconds();
+    radix_sort_u64(keys, vals, n, threads);
+    double secs = now_seconds() - t0;
+    printf("  %-8s radix  %8.1f ms  %6.1f Mkeys/s  %s\n", "id", secs * 1e3,
+           n / secs / 1e6, bench_sort_check(keys, n) ? "sorted" : "NOT SORTED");
+    t0 = now_seconds();
+    for (size_t i = 0; i < n; ++i) keys[i] = due[vals[i]];
+    radix_sort_u64(keys, vals, n, threads);
+    secs += now_seconds() - t0;
+    for (size_t i = 0; i < n; ++i) keys[i] = due[vals[i]] << 32 | ids[vals[i]];
+    printf("  %-8s radix  %8.1f ms  %6.1f Mkeys/s  %s\n", "due,id", secs * 1e3,
+           n / secs / 1e6, bench_sort_check(keys, n) ? "sorted" : "NOT SORTED");
+
+    t0 = now_seconds();
+    merge_sort_text(text, vals, n, threads);
+    secs = now_seconds() - t0;
+    int ok = 1;
+    for (size_t i = 1; i < n && ok; ++i) {
+        int c = strcmp(text[vals[i - 1]], text[vals[i]]);
+        ok = c < 0 || (c == 0 && vals[i - 1] < vals[i]);
+    }
+    printf("  %-8s merge  %8.1f ms  %6.1f Mkeys/s  %s\n", "question", secs * 1e3,
+           n / secs / 1e6, ok ? "sorted" : "NOT SORTED");
+
+    arena_destroy(&heap);
+    free(ids); free(due); free(keys); free(vals); free(text);
+    return ok ? 0 : 1;
+}
+
+/* --- Deck diff and three-way merge --- */
+/* Both tools stream their inputs as saved by save_cards_to_file (ascending id),
+   holding one record per input plus whatever is still unmatched, so time is
+   linear and memory is bounded by the size of the change, not the deck.
+
+   diff OLD NEW prints a change set of blocks in the file's KEY=value style:
+     +ID=n      card added (all fields follow)
+     -ID=n      card removed
+     ~ID=n      fields that changed follow (Q/A/T content, I/D scheduling)
+     >ID=a,b    card renumbered from a to b, matched by content hash
+   each ended by "---".
+
+   merge BASE OURS THEIRS OUT matches cards by id. A field changed on one side
+   takes that side; a content field changed differently on both sides keeps
+   OURS and counts a conflict. Scheduling (I, D) changed on both sides keeps
+   the more conservative schedule: the smaller interval, then the smaller
+   due_in. An edit beats a delete. Two different cards added under the same id
+   are both kept, THEIRS renumbered past the largest id seen. */
+static int card_reader_next_sorted(CardReader *rd, CardRec *r) {
+    if (!card_reader_next(rd, r)) return 0;
+    if (r->id <= rd->last_id) {
+        fprintf(stderr, "%s: card ID=%d after ID=%d; input must be saved in id order "
+                        "(load and save it once to fix)\n", rd->name, r->id, rd->last_id);
+        exit(1);
+    }
+    rd->last_id = r->id;
+    return 1;
+}
+
+static uint64_t card_rec_hash(const CardRec *r) {
+    uint64_t h = hash64_bytes(r->question, strlen(r->question) + 1, HASH64_SEED);
+    h = hash64_bytes(r->answer, strlen(r->answer) + 1, h);
+    return hash64_bytes(r->tags, strlen(r->tags) + 1, h);
+}
+
+static int card_rec_same_content(const CardRec *a, const CardRec *b) {
+    return strcmp(a->question, b->question) == 0 && strcmp(a->answer, b->answer) == 0 &&
+           strcmp(a->tags, b->tags) == 0;
+}
+
+/* unmatched cards waiting for a content-hash partner, in a chained table
+   that doubles its buckets whenever it holds more cards than buckets, so
+   chains stay O(1) however large the change set grows */
+typedef struct PendingCard {
+    uint64_t hash;
+    CardRec rec;
+    struct PendingCard *next;
+} PendingCard;
+
+#define PENDING_MIN_BUCKETS 64
+typedef struct PendingSet {
+    PendingCard **b;
+    size_t buckets;            // a power of two
+    long size;
+} PendingSet;
+
+static void pending_init(PendingSet *s) {
+    s->buckets = PENDING_MIN_BUCKETS;
+    s->b = calloc(s->buckets, sizeof(PendingCard*));
+    s->size = 0;
+    if (!s->b) { perror("calloc"); exit(1); }
+}
+
+static void pending_grow(PendingSet *s) {
+    size_t buckets = s->buckets * 2;
+    PendingCard **b = calloc(buckets, sizeof(PendingCard*));
+    if (!b) { perror("calloc"); exit(1); }
+    for (size_t k = 0; k < s->buckets; ++k) {
+        for (PendingCard *p = s->b[k], *nx; p; p = nx) {
+            nx = p->next;
+            p->next = b[p->hash & (buckets - 1)];
+            b[p->hash & (buckets - 1)] = p;
+        }
+    }
+    free(s->b);
+    s->b = b;
+    s->buckets = buckets;
+}
+
+static void pending_put(PendingSet *s, uint64_t h, CardRec *r) {
+    if ((size_t)s->size >= s->buckets) pending_grow(s);
+    PendingCard *p = malloc(sizeof(PendingCard));
+    p->hash = h;
+    p->rec = *r;               // takes ownership of the strings
+    p->next = s->b[h & (s->buckets - 1)];
+    s->b[h & (s->buckets - 1)] = p;
+    s->size++;
+}
+
+static int pending_take(PendingSet *s, uint64_t h, const CardRec *like, CardRec *out) {
+    for (PendingCard **pp = &s->b[h & (s->buckets - 1)]; *pp; pp = &(*pp)->next) {
+        PendingCard *p = *pp;
+        if (p->hash == h && card_rec_same_content(&p->rec, like)) {
+            *out = p->rec;
+            *pp = p->next;
+            free(p);
+            s->size--;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+typedef struct DiffStats { long added, removed, changed, renumbered; } DiffStats;
+
+static void diff_emit_fields(FILE *out, const CardRec *o, const CardRec *n) {
+    if (!o || strcmp(o->question, n->question) != 0) fprintf(out, "Q=%s\n", n->question);
+    if (!o || strcmp(o->answer, n->answer) != 0) fprintf(out, "A=%s\n", n->answer);
+    if (!o || strcmp(o->tags, n->tags) != 0) fprintf(out, "T=%s\n", n->tags);
+    if (!o || o->interval != n->interval) fprintf(out, "I=%d\n", n->interval);
+    if (!o || o->due_in != n->due_in) fprintf(out, "D=%d\n", n->due_in);
+    fprintf(out, "---\n");
+}
+
+static void diff_removed(FILE *out, PendingSet *adds, PendingSet *dels, CardRec *o, DiffStats *st) {
+    uint64_t h = card_rec_hash(o);
+    CardRec n;
+    if (pending_take(adds, h, o, &n)) {
+        fprintf(out, ">ID=%d,%d\n", o->id, n.id);
+        diff_emit_fields(out, o, &n);
+        st->renumbered++;
+        card_rec_free(&n);
+        card_rec_free(o);
+    } else {
+        pending_put(dels, h, o);
+    }
+}
+
+static void diff_added(FILE *out, PendingSet *adds, PendingSet *dels, CardRec *n, DiffStats *st) {
+    uint64_t h = card_rec_hash(n);
+    CardRec o;
+    if (pending_take(dels, h, n, &o)) {
+        fprintf(out, ">ID=%d,%d\n", o.id, n->id);
+        diff_emit_fields(out, &o, n);
+        st->renumbered++;
+        card_rec_free(&o);
+        card_rec_free(n);
+    } else {
+        pending_put(adds, h, n);
+    }
+}
+
+static int deck_diff(const char *old_path, const char *new_path, FILE *out) {
+    FILE *fo = fopen(old_path, "r"), *fn = fopen(new_path, "r");
+    if (!fo || !fn) { perror("fopen"); if (fo) fclose(fo); if (fn) fclose(fn); return 1; }
+    CardReader ro = { fo, old_path, 0 }, rn = { fn, new_path, 0 };
+    PendingSet adds_set, dels_set, *adds = &adds_set, *dels = &dels_set;
+    pending_init(adds);
+    pending_init(dels);
+    DiffStats st = {0};
+    CardRec o, n;
+    int ho = card_reader_next_sorted(&ro, &o), hn = card_reader_next_sorted(&rn, &n);
+    while (ho || hn) {
+        if (ho && hn && o.id == n.id) {
+            if (!card_rec_same_content(&o, &n) || o.interval != n.interval || o.due_in != n.due_in) {
+                fprintf(out, "~ID=%d\n", n.id);
+                diff_emit_fields(out, &o, &n);
+                st.changed++;
+            }
+            card_rec_free(&o); card_rec_free(&n);
+            ho = card_reader_next_sorted(&ro, &o);
+            hn = card_reader_next_sorted(&rn, &n);
+        } else if (ho && (!hn || o.id < n.id)) {
+            diff_removed(out, adds, dels, &o, &st);
+            ho = card_reader_next_sorted(&ro, &o);
+        } else {
+            diff_added(out, adds, dels, &n, &st);
+            hn = card_reader_next_sorted(&rn, &n);
+        }
+    }
+    for (size_t b = 0; b < dels->buckets; ++b) {
+        for (PendingCard *p = dels->b[b], *nx; p; p = nx) {
+            nx = p->next;
+            fprintf(out, "-ID=%d\n---\n", p->rec.id);
+            st.removed++;
+            card_rec_free(&p->rec);
+            free(p);
+        }
+    }
+    for (size_t b = 0; b < adds->buckets; ++b) {
+        for (PendingCard *p = adds->b[b], *nx; p; p = nx) {
+            nx = p->next;
+            fprintf(out, "+ID=%d\n", p->rec.id);
+            diff_emit_fields(out, NULL, &p->rec);
+            st.added++;
+            card_rec_free(&p->rec);
+            free(p);
+        }
+    }
+    fprintf(stderr, "%ld added, %ld removed, %ld changed, %ld renumbered\n",
+            st.added, st.removed, st.changed, st.renumbered);
+    free(adds->b); free(dels->b);
+    fclose(fo); fclose(fn);
+    return 0;
+}
+
+/* pick one string field: whichever side changed it, OURS when both did */
+static char *merge_field(char *base, char *ours, char *theirs, long *conflicts) {
+    if (strcmp(ours, base) == 0) return theirs;
+    if (strcmp(theirs, base) == 0 || strcmp(ours, theirs) == 0) return ours;
+    (*conflicts)++;
+    return ours;
+}
+
+static void merge_three(const CardRec *b, const CardRec *o, const CardRec *t, CardRec *out,
+                        long *conflicts) {
+    long before = *conflicts;
+    out->id = o->id;
+    out->question = merge_field(b->question, o->question, t->question, conflicts);
+    out->answer = merge_field(b->answer, o->answer, t->answer, conflicts);
+    out->tags = merge_field(b->tags, o->tags, t->tags, conflicts);
+    int o_sched = o->interval != b->interval || o->due_in != b->due_in;
+    int t_sched = t->interval != b->interval || t->due_in != b->due_in;
+    const CardRec *s = o;
+    if (!o_sched && t_sched) s = t;
+    else if (o_sched && t_sched &&
+             (t->interval < o->interval || (t->interval == o->interval && t->due_in < o->due_in)))
+        s = t;
+    out->interval = s->interval;
+    out->due_in = s->due_in;
+    if (*conflicts != before) fprintf(stderr, "conflict in ID=%d: kept ours\n", o->id);
+}
+
+static int deck_merge(const char *base_path, const char *ours_path, const char *theirs_path,
+                      const char *out_path) {
+    FILE *fb = fopen(base_path, "r"), *fo = fopen(ours_path, "r"), *ft = fopen(theirs_path, "r");
+    FILE *out = fopen(out_path, "w");
+    if (!fb || !fo || !ft || !out) {
+        perror("fopen");
+        if (fb) fclose(fb);
+        if (fo) fclose(fo);
+        if (ft) fclose(ft);
+        if (out) fclose(out);
+        return 1;
+    }
+    CardReader rb = { fb, base_path, 0 }, ro = { fo, ours_path, 0 }, rt = { ft, theirs_path, 0 };
+    CardRec b, o, t;
+    int hb = card_reader_next_sorted(&rb, &b);
+    int ho = card_reader_next_sorted(&ro, &o);
+    int ht = card_reader_next_sorted(&rt, &t);
+    long written = 0, conflicts = 0;
+    int max_id = 0;
+    PendingSet clash_set, *clashes = &clash_set;   // THEIRS cards needing a new id
+    pending_init(clashes);
+    while (hb || ho || ht) {
+        int id = INT32_MAX;
+        if (hb && b.id < id) id = b.id;
+        if (ho && o.id < id) id = o.id;
+        if (ht && t.id < id) id = t.id;
+        int in_b = hb && b.id == id, in_o = ho && o.id == id, in_t = ht && t.id == id;
+        CardRec m;
+        int keep = 1;
+        if (in_o && in_t && in_b) {
+            merge_three(&b, &o, &t, &m, &conflicts);
+        } else if (in_o && in_t) {
+            m = o;
+            if (!card_rec_same_content(&o, &t)) {
+                CardRec copy = { 0, t.interval, t.due_in, my_strdup(t.question),
+                                 my_strdup(t.answer), my_strdup(t.tags) };
+                pending_put(clashes, (uint64_t)id, &copy);
+            }
+        } else if (in_o || in_t) {
+            const CardRec *side = in_o ? &o : &t;
+            m = *side;
+            if (in_b) {
+                // other side deleted it: keep only if this side edited it
+                if (card_rec_same_content(&b, side) && b.interval == side->interval &&
+                    b.due_in == side->due_in) keep = 0;
+                else { conflicts++; fprintf(stderr, "conflict in ID=%d: edit kept over delete\n", id); }
+            }
+        } else {
+            keep = 0;   // deleted on both sides
+        }
+        if (keep) {
+            card_rec_write(out, &m);
+            written++;
+            if (m.id > max_id) max_id = m.id;
+        }
+        if (in_b) { card_rec_free(&b); hb = card_reader_next_sorted(&rb, &b); }
+        if (in_o) { card_rec_free(&o); ho = card_reader_next_sorted(&ro, &o); }
+        if (in_t) { card_rec_free(&t); ht = card_reader_next_sorted(&rt, &t); }
+    }
+    for (size_t k = 0; k < clashes->buckets; ++k) {
+        for (PendingCard *p = clashes->b[k], *nx; p; p = nx) {
+            nx = p->next;
+            p->rec.id = ++max_id;
+            fprintf(stderr, "ID=%llu added on both sides; theirs renumbered to ID=%d\n",
+                    (unsigned long long)p->hash, p->rec.id);
+            card_rec_write(out, &p->rec);
+            written++;
+            card_rec_free(&p->rec);
+            free(p);
+        }
+    }
+    free(clashes->b);
+    fclose(fb); fclose(fo); fclose(ft);
+    fclose(out);
+    fprintf(stderr, "merged %ld cards into %s, %ld conflict(s)\n", written, out_path, conflicts);
+    return 0;
+}
+
+/* --- Benchmarks (./flashcards --bench <name> ...) --- */
+static int run_benchmark(int argc, char **argv) {
+    if (argc > 0 && strcmp(argv[0], "shards") == 0) return bench_shards(argc - 1, argv + 1);
+    if (argc > 0 && strcmp(argv[0], "class") == 0) return bench_class(argc - 1, argv + 1);
+    if (argc > 0 && strcmp(argv[0], "sort") == 0) return bench_sort(argc - 1, argv + 1);
+    if (argc > 0 && strcmp(argv[0], "evict") == 0) return bench_evict(argc - 1, argv + 1);
+    if (argc > 0 && strcmp(argv[0], "digest") == 0) return bench_digest(argc - 1, argv + 1);
+    if (argc > 0 && strcmp(argv[0], "elo") == 0) return bench_elo(argc - 1, argv + 1);
+    if (argc > 0 && strcmp(argv[0], "irt") == 0) return bench_irt(argc - 1, argv + 1);
+    if (argc > 0 && strcmp(argv[0], "interleave") == 0) return bench_interleave(argc - 1, argv + 1);
+    if (argc > 0 && strcmp(argv[0], "catchup") == 0) return bench_catchup(argc - 1, argv + 1);
+    fprintf(stderr, "usage: flashcards --bench shards [cards] [shards]\n"
+                    "       flashcards --bench class [learners] [cards] [studied]\n"
+                    "       flashcards --bench evict [learners] [cards] [studied] [active%%]\n"
+                    "       flashcards --bench sort [cards] [threads]\n"
+                    "       flashcards --bench digest [values] [shards]\n"
+                    "       flashcards --bench elo [learners] [cards] [reviews] [threads]\n"
+                    "       flashcards --bench irt [learners] [cards] [reviews] [threads]\n"
+                    "       flashcards --bench interleave [cards] [tags]\n"
+                    "       flashcards --bench catchup [cards] [days away] [plan days] [per day]\n");
+    return 2;
+}
+
 /* --- Main interactive loop --- */
-int main(void) {
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+        return run_benchmark(argc - 2, argv + 2);
+    if (argc == 4 && strcmp(argv[1], "diff") == 0)
+        return deck_diff(argv[2], argv[3], stdout);
+    if (argc == 6 && strcmp(argv[1], "merge") == 0)
+        return deck_merge(argv[2], argv[3], argv[4], argv[5]);
+
     Queue *q = queue_create();
     char line[LINEBUF];
     printf("Flashcard App (C) — Queues + Hash Map demo\n");
-    printf("Loading sample cards...\n");
-    load_sample_cards(q);
+    if (argc > 2 && strcmp(argv[1], "--live") == 0) {
+        if (live_open(argv[2], q) != 0) return 1;
+    } else {
+        printf("Loading sample cards...\n");
+        load_sample_cards(q);
+    }
 
     for (;;) {
         printf("\nMenu:\n");
@@ -609,7 +2827,8 @@ int main(void) {
         printf(" 5) List all cards\n");
         printf(" 6) Save to file\n");
         printf(" 7) Load from file\n");
-        printf(" 8) Exit\n");
+        printf(" 8) Open live deck (memory-mapped)\n");
+        printf(" 9) Exit\n");
         printf("Choose option: ");
         if (!fgets(line, sizeof(line), stdin)) break;
         trim_newline(line);
@@ -625,7 +2844,14 @@ int main(void) {
             trim_newline(line);
             search_by_tag(line);
         } else if (strcmp(line, "5") == 0) {
-            list_all_cards();
+            SortKey key;
+            int descending;
+            printf("Sort by id, due, interval or question (prefix '-' to reverse) [id]: ");
+            if (!fgets(line, sizeof(line), stdin)) break;
+            trim_newline(line);
+            trim_whitespace(line);
+            if (!parse_sort_key(line, &key, &descending)) { printf("Unknown sort key.\n"); continue; }
+            list_all_cards(key, descending);
         } else if (strcmp(line, "6") == 0) {
             printf("Enter filename to save: ");
             if (!fgets(line, sizeof(line), stdin)) break;
@@ -637,6 +2863,11 @@ int main(void) {
             trim_newline(line);
             load_cards_from_file(line, q);
         } else if (strcmp(line, "8") == 0) {
+            printf("Enter live deck name (NAME.deck/.text/.redo): ");
+            if (!fgets(line, sizeof(line), stdin)) break;
+            trim_newline(line);
+            if (strlen(line) > 0) live_open(line, q);
+        } else if (strcmp(line, "9") == 0) {
             break;
         } else {
             printf("Unknown option.\n");
@@ -645,6 +2876,8 @@ int main(void) {
 
     // cleanup
     clear_all_data(q);
+    live_close();
+    free(learner_think);
     free(q);
     printf("Goodbye.\n");
     return 0;
@@ -0,0 +1,344 @@
+#include "FlashSprintDeck.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+namespace flashsprint {
+
+namespace {
+
+std::string_view Trim(std::string_view s) {
+  while (!s.empty() && std::isspace(static_cast<unsigned char>(s.front()))) s.remove_prefix(1);
+  while (!s.empty() && std::isspace(static_cast<unsigned char>(s.back()))) s.remove_suffix(1);
+  return s;
+}
+
+// Same normalization as the console's normalize_tag, in place.
+void NormalizeTag(std::string* tag) {
+  std::string_view trimmed = Trim(*tag);
+  if (trimmed.size() != tag->size()) {
+    size_t begin = static_cast<size_t>(trimmed.data() - tag->data());
+    tag->erase(0, begin);
+    tag->resize(trimmed.size());
+  }
+  for (char& c : *tag) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+}
+
+// Calls fn(tag) for each non-empty tag of a comma-separated list.
+template <typename Fn>
+void ForEachListedTag(std::string_view list, Fn fn) {
+  while (true) {
+    size_t comma = list.find(',');
+    std::string_view tag = Trim(list.substr(0, comma));
+    if (!tag.empty()) fn(tag);
+    if (comma == std::string_view::npos) return;
+    list.remove_prefix(comma + 1);
+  }
+}
+
+bool TagEquals(std::string_view name, std::string_view raw) {
+  if (name.size() != raw.size()) return false;
+  for (size_t i = 0; i < raw.size(); ++i) {
+    if (name[i] != std::tolower(static_cast<unsigned char>(raw[i]))) return false;
+  }
+  return true;
+}
+
+bool SetError(std::string* error, const std::string& path, const char* what) {
+  if (error) *error = path + ": " + what + ": " + std::strerror(errno);
+  return false;
+}
+
+}  // namespace
+
+bool CardView::HasTag(std::string_view tag) const {
+  std::string_view wanted = Trim(tag);
+  for (std::string_view name : tags()) {
+    if (TagEquals(name, wanted)) return true;
+  }
+  return false;
+}
+
+uint32_t Deck::InternTag(std::string tag) {
+  auto it = tag_ids_.find(tag);
+  if (it != tag_ids_.end()) return it->second;
+  uint32_t id = static_cast<uint32_t>(tag_names_.size());
+  tag_ids_.emplace(tag, id);
+  tag_names_.push_back(std::move(tag));
+  tag_cards_.emplace_back();
+  return id;
+}
+
+std::optional<uint32_t> Deck::FindTag(std::string_view tag) const {
+  tag = Trim(tag);
+  // tags are stored lowercased; only fold the query if it needs it
+  auto it = tag_ids_.end();
+  if (std::none_of(tag.begin(), tag.end(),
+                   [](char c) { return std::isupper(static_cast<unsigned char>(c)); })) {
+    it = tag_ids_.find(tag);
+  } else {
+    std::string folded(tag);
+    NormalizeTag(&folded);
+    it = tag_ids_.find(folded);
+  }
+  if (it == tag_ids_.end()) return std::nullopt;
+  return it->second;
+}
+
+uint32_t Deck::SlotOf(int id) const {
+  auto it = slot_of_.find(id);
+  return it == slot_of_.end() ? kNoSlot : it->second;
+}
+
+uint32_t Deck::Insert(Card card) {
+  uint32_t slot = static_cast<uint32_t>(cards_.size());
+  for (uint32_t tag : card.tags) tag_cards_[tag].push_back(slot);
+  slot_of_.emplace(card.id, slot);
+  queue_.push_back(card.id);
+  cards_.push_back(std::move(card));
+  return slot;
+}
+
+int Deck::Add(std::string question, std::string answer, std::vector<std::string> tags) {
+  Card card;
+  card.id = next_id_++;
+  card.question = std::move(question);
+  card.answer = std::move(answer);
+  card.tags.reserve(tags.size());
+  for (std::string& tag : tags) {
+    NormalizeTag(&tag);
+    if (tag.empty()) continue;
+    uint32_t id = InternTag(std::move(tag));
+    if (std::find(card.tags.begin(), card.tags.end(), id) == card.tags.end()) card.tags.push_back(id);
+  }
+  int id = card.id;
+  Insert(std::move(card));
+  return id;
+}
+
+bool Deck::Remove(int id) {
+  uint32_t slot = SlotOf(id);
+  if (slot == kNoSlot) return false;
+  auto drop = [this](uint32_t tag, uint32_t from, uint32_t to) {
+    std::vector<uint32_t>& slots = tag_cards_[tag];
+    auto it = std::find(slots.begin(), slots.end(), from);
+    if (to == kNoSlot) slots.erase(it);
+    else *it = to;
+  };
+  for (uint32_t tag : cards_[slot].tags) drop(tag, slot, kNoSlot);
+  slot_of_.erase(id);
+  uint32_t last = static_cast<uint32_t>(cards_.size() - 1);
+  if (slot != last) {
+    for (uint32_t tag : cards_[last].tags) drop(tag, last, slot);
+    slot_of_[cards_[last].id] = slot;
+    cards_[slot] = std::move(cards_[last]);
+  }
+  cards_.pop_back();
+  // Tags stay interned once seen; their lists just empty out. The queue
+  // entry is skipped lazily by NextDue.
+  return true;
+}
+
+void Deck::Clear() {
+  *this = Deck();
+}
+
+std::optional<CardView> Deck::Find(int id) const {
+  uint32_t slot = SlotOf(id);
+  if (slot == kNoSlot) return std::nullopt;
+  return CardView(this, slot);
+}
+
+CardRange Deck::WithTag(std::string_view tag) const {
+  std::optional<uint32_t> id = FindTag(tag);
+  if (!id) return CardRange();
+  const std::vector<uint32_t>& slots = tag_cards_[*id];
+  return CardRange(this, slots.data(), slots.size());
+}
+
+SearchResults Deck::Search(std::string_view tags) const {
+  SearchResults results;
+  results.deck_ = this;
+  std::vector<uint32_t> wanted;
+  bool missing = false;
+  ForEachListedTag(tags, [&](std::string_view tag) {
+    std::optional<uint32_t> id = FindTag(tag);
+    if (!id) missing = true;
+    else wanted.push_back(*id);
+  });
+  if (missing || wanted.empty()) return results;
+  // walk the rarest tag's cards and check the rest on each card's own
+  // (short) tag list
+  std::sort(wanted.begin(), wanted.end(), [this](uint32_t a, uint32_t b) {
+    return tag_cards_[a].size() < tag_cards_[b].size();
+  });
+  wanted.erase(std::unique(wanted.begin(), wanted.end()), wanted.end());
+  for (uint32_t slot : tag_cards_[wanted[0]]) {
+    const std::vector<uint32_t>& own = cards_[slot].tags;
+    bool all = std::all_of(wanted.begin() + 1, wanted.end(), [&own](uint32_t tag) {
+      return std::find(own.begin(), own.end(), tag) != own.end();
+    });
+    if (all) results.slots_.push_back(slot);
+  }
+  return results;
+}
+
+void Deck::CompactQueue() {
+  if (queue_head_ < 1024 || queue_head_ * 2 < queue_.size()) return;
+  queue_.erase(queue_.begin(), queue_.begin() + static_cast<std::ptrdiff_t>(queue_head_));
+  queue_head_ = 0;
+}
+
+std::optional<CardView> Deck::NextDue() {
+  while (queue_head_ < queue_.size()) {
+    int id = queue_[queue_head_];
+    uint32_t slot = SlotOf(id);
+    if (slot == kNoSlot) {
+      ++queue_head_;
+      CompactQueue();
+      continue;
+    }
+    Card& card = cards_[slot];
+    if (card.due_in == 0) return CardView(this, slot);
+    card.due_in--;
+    ++queue_head_;
+    queue_.push_back(id);
+    CompactQueue();
+  }
+  return std::nullopt;
+}
+
+bool Deck::Answer(int id, bool correct) {
+  uint32_t slot = SlotOf(id);
+  if (slot == kNoSlot) return false;
+  Card& card = cards_[slot];
+  if (correct) {
+    card.interval = std::max(card.interval * 2, 1);
+    card.due_in = card.interval;
+  } else {
+    card.interval = 1;
+    card.due_in = 1;
+  }
+  if (queue_head_ < queue_.size() && queue_[queue_head_] == id) {
+    ++queue_head_;
+    queue_.push_back(id);
+    CompactQueue();
+  }
+  return true;
+}
+
+bool Deck::Save(const std::string& path, std::string* error) const {
+  FILE* f = std::fopen(path.c_str(), "w");
+  if (!f) return SetError(error, path, "open");
+  // ascending ids, like the console, so saved decks diff and merge as streams
+  std::vector<uint32_t> order(cards_.size());
+  for (uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+  std::sort(order.begin(), order.end(),
+            [this](uint32_t a, uint32_t b) { return cards_[a].id < cards_[b].id; });
+  std::string block;
+  for (uint32_t slot : order) {
+    const Card& c = cards_[slot];
+    block.assign("ID=").append(std::to_string(c.id));
+    block.append("\nQ=").append(c.question);
+    block.append("\nA=").append(c.answer);
+    block.append("\nT=");
+    for (size_t i = 0; i < c.tags.size(); ++i) {
+      if (i) block.push_back(',');
+      block.append(tag_names_[c.tags[i]]);
+    }
+    block.append("\nI=").append(std::to_string(c.interval));
+    block.append("\nD=").append(std::to_string(c.due_in));
+    block.append("\n---\n");
+    if (std::fwrite(block.data(), 1, block.size(), f) != block.size()) {
+      SetError(error, path, "write");
+      std::fclose(f);
+      return false;
+    }
+  }
+  if (std::fclose(f) != 0) return SetError(error, path, "close");
+  return true;
+}
+
+bool Deck::Load(const std::string& path, std::string* error) {
+  FILE* f = std::fopen(path.c_str(), "r");
+  if (!f) return SetError(error, path, "open");
+  Deck loaded;
+  Card card;
+  std::vector<Card> unnumbered;
+  bool has_q = false, has_a = false;
+  std::string tag_line;
+  auto finish = [&] {
+    if (has_q && has_a) {
+      ForEachListedTag(tag_line, [&](std::string_view raw) {
+        std::string tag(raw);
+        NormalizeTag(&tag);
+        uint32_t id = loaded.InternTag(std::move(tag));
+        if (std::find(card.tags.begin(), card.tags.end(), id) == card.tags.end())
+          card.tags.push_back(id);
+      });
+      if (card.interval <= 0) card.interval = 1;
+      if (card.due_in < 0) card.due_in = 0;
+      // the file's ids are kept so saved decks stay comparable; cards
+      // without one are numbered after the rest, and a repeated id keeps
+      // the first card
+      if (card.id <= 0) {
+        unnumbered.push_back(std::move(card));
+      } else if (loaded.SlotOf(card.id) == kNoSlot) {
+        loaded.next_id_ = std::max(loaded.next_id_, card.id + 1);
+        loaded.Insert(std::move(card));
+      }
+    }
+    card = Card();
+    has_q = has_a = false;
+    tag_line.clear();
+  };
+  std::string line;
+  char buf[4096];
+  while (std::fgets(buf, sizeof(buf), f)) {
+    line.append(buf);
+    if (line.empty() || line.back() != '\n') {
+      if (!std::feof(f)) continue;  // longer than buf: keep reading
+    }
+    while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) line.pop_back();
+    std::string_view l = line;
+    if (l.compare(0, 3, "ID=") == 0) {
+      card.id = std::atoi(line.c_str() + 3);
+    } else if (l.compare(0, 2, "Q=") == 0) {
+      card.question.assign(l.substr(2));
+      has_q = true;
+    } else if (l.compare(0, 2, "A=") == 0) {
+      card.answer.assign(l.substr(2));
+      has_a = true;
+    } else if (l.compare(0, 2, "T=") == 0) {
+      tag_line.assign(l.substr(2));
+    } else if (l.compare(0, 2, "I=") == 0) {
+      card.interval = std::atoi(line.c_str() + 2);
+    } else if (l.compare(0, 2, "D=") == 0) {
+      card.due_in = std::atoi(line.c_str() + 2);
+    } else if (l == "---") {
+      finish();
+    }
+    line.clear();
+  }
+  bool failed = std::ferror(f) != 0;
+  std::fclose(f);
+  if (failed) return SetError(error, path, "read");
+  finish();  // a last block without trailing --- still counts
+  for (Card& c : unnumbered) {
+    c.id = loaded.next_id_++;
+    loaded.Insert(std::move(c));
+  }
+  // soonest due first, ties in file order, as the console builds its queue
+  std::stable_sort(loaded.queue_.begin(), loaded.queue_.end(), [&loaded](int a, int b) {
+    return loaded.cards_[loaded.SlotOf(a)].due_in < loaded.cards_[loaded.SlotOf(b)].due_in;
+  });
+  *this = std::move(loaded);
+  return true;
+}
+
+}  // namespace flashsprint
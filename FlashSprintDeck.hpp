@@ -0,0 +1,279 @@
+/*
+ FlashSprint deck library (C++17)
+
+ The console app (FlashSprintConcole.c) keeps its deck in globals, so there
+ is exactly one per process. This is the same engine as a value type: a
+ Deck owns its cards, tag index and practice queue, so any number of decks
+ can live side by side and be moved or copied like any other value.
+
+  - Cards are read through CardView, which hands out std::string_view into
+    the deck's own strings rather than copies.
+  - Searches return ranges of CardView for range-based for loops; a single
+    tag search is a view straight over the tag's index.
+  - Add takes its strings by value and moves them into place, so callers
+    that pass temporaries (or std::move) copy no text at all.
+  - Scheduling follows the console's rotation model (interval doubles on a
+    correct answer, resets to 1 on a miss) and Save/Load use its file
+    format, so decks move freely between the two.
+
+ Views and ranges borrow from the deck: they stay valid until the deck is
+ next modified, moved from or destroyed. Like the standard containers, a
+ Deck may be read from several threads at once, but writes need the
+ caller's synchronisation; separate decks share nothing.
+
+ Compile:
+   g++ -std=c++17 -O2 -c FlashSprintDeck.cpp
+
+ FlashSprintDeckBench.cpp is a driver that checks and times the library.
+*/
+
+#ifndef FLASHSPRINT_DECK_HPP_
+#define FLASHSPRINT_DECK_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace flashsprint {
+
+class Deck;
+
+namespace detail {
+// Turns an index stored in a deck into the view handed to callers.
+template <typename View>
+View Resolve(const Deck& deck, uint32_t index);
+}  // namespace detail
+
+// A read-only range of views over indices into a deck, either a stored
+// index array or (indices == nullptr) the positions themselves.
+template <typename View>
+class IndexRange {
+ public:
+  class iterator {
+   public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = View;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = View;
+
+    iterator() = default;
+    View operator*() const { return detail::Resolve<View>(*deck_, index()); }
+    View operator[](difference_type n) const { return *(*this + n); }
+    iterator& operator++() { ++pos_; return *this; }
+    iterator operator++(int) { iterator old = *this; ++pos_; return old; }
+    iterator& operator--() { --pos_; return *this; }
+    iterator operator--(int) { iterator old = *this; --pos_; return old; }
+    iterator& operator+=(difference_type n) { pos_ += n; return *this; }
+    iterator& operator-=(difference_type n) { pos_ -= n; return *this; }
+    friend iterator operator+(iterator it, difference_type n) { return it += n; }
+    friend iterator operator+(difference_type n, iterator it) { return it += n; }
+    friend iterator operator-(iterator it, difference_type n) { return it -= n; }
+    friend difference_type operator-(const iterator& a, const iterator& b) {
+      return static_cast<difference_type>(a.pos_) - static_cast<difference_type>(b.pos_);
+    }
+    friend bool operator==(const iterator& a, const iterator& b) { return a.pos_ == b.pos_; }
+    friend bool operator!=(const iterator& a, const iterator& b) { return a.pos_ != b.pos_; }
+    friend bool operator<(const iterator& a, const iterator& b) { return a.pos_ < b.pos_; }
+    friend bool operator>(const iterator& a, const iterator& b) { return a.pos_ > b.pos_; }
+    friend bool operator<=(const iterator& a, const iterator& b) { return a.pos_ <= b.pos_; }
+    friend bool operator>=(const iterator& a, const iterator& b) { return a.pos_ >= b.pos_; }
+
+   private:
+    friend class IndexRange;
+    iterator(const Deck* deck, const uint32_t* indices, size_t pos)
+        : deck_(deck), indices_(indices), pos_(pos) {}
+    uint32_t index() const {
+      return indices_ ? indices_[pos_] : static_cast<uint32_t>(pos_);
+    }
+
+    const Deck* deck_ = nullptr;
+    const uint32_t* indices_ = nullptr;
+    size_t pos_ = 0;
+  };
+
+  IndexRange() = default;
+  IndexRange(const Deck* deck, const uint32_t* indices, size_t size)
+      : deck_(deck), indices_(indices), size_(size) {}
+
+  iterator begin() const { return iterator(deck_, indices_, 0); }
+  iterator end() const { return iterator(deck_, indices_, size_); }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  View operator[](size_t i) const { return begin()[static_cast<std::ptrdiff_t>(i)]; }
+
+ private:
+  const Deck* deck_ = nullptr;
+  const uint32_t* indices_ = nullptr;
+  size_t size_ = 0;
+};
+
+class CardView;
+using TagRange = IndexRange<std::string_view>;
+using CardRange = IndexRange<CardView>;
+
+// One card of a deck, by reference.
+class CardView {
+ public:
+  int id() const;
+  std::string_view question() const;
+  std::string_view answer() const;
+  TagRange tags() const;
+  bool HasTag(std::string_view tag) const;
+  // rotations to skip after a correct answer, and rotations until due
+  int interval() const;
+  int due_in() const;
+
+ private:
+  friend class Deck;
+  template <typename View>
+  friend View detail::Resolve(const Deck& deck, uint32_t index);
+  CardView(const Deck* deck, uint32_t slot) : deck_(deck), slot_(slot) {}
+
+  const Deck* deck_;
+  uint32_t slot_;
+};
+
+// Cards found by a search that combines several tags. Owns its matches, so
+// it may be kept while the deck is read, but not across modifications.
+class SearchResults {
+ public:
+  SearchResults() = default;
+  CardRange::iterator begin() const { return range().begin(); }
+  CardRange::iterator end() const { return range().end(); }
+  size_t size() const { return slots_.size(); }
+  bool empty() const { return slots_.empty(); }
+  CardView operator[](size_t i) const;
+
+ private:
+  friend class Deck;
+  CardRange range() const { return CardRange(deck_, slots_.data(), slots_.size()); }
+
+  const Deck* deck_ = nullptr;
+  std::vector<uint32_t> slots_;
+};
+
+class Deck {
+ public:
+  Deck() = default;
+  Deck(const Deck&) = default;
+  Deck& operator=(const Deck&) = default;
+  Deck(Deck&&) noexcept = default;
+  Deck& operator=(Deck&&) noexcept = default;
+  ~Deck() = default;
+
+  // Adds a card, due now, and returns its id. Tags are trimmed and
+  // lowercased like the console's; empty ones are dropped.
+  int Add(std::string question, std::string answer, std::vector<std::string> tags = {});
+
+  // Removes the card with id; false if there is none.
+  bool Remove(int id);
+
+  void Clear();
+
+  size_t size() const { return cards_.size(); }
+  bool empty() const { return cards_.empty(); }
+
+  std::optional<CardView> Find(int id) const;
+
+  // Every card, in no particular order.
+  CardRange cards() const { return CardRange(this, nullptr, cards_.size()); }
+
+  // Cards with tag (normalized like Add), in no particular order. No
+  // copying: the range reads the tag's index directly.
+  CardRange WithTag(std::string_view tag) const;
+
+  // Cards carrying every tag of a comma-separated list, e.g. "queue,bfs".
+  SearchResults Search(std::string_view tags) const;
+
+  // Number of distinct tags in use.
+  size_t tag_count() const { return tag_ids_.size(); }
+
+  // Rotates the practice queue to the next due card, as the console does:
+  // cards passed over on the way have due_in counted down. Empty only when
+  // the deck is.
+  std::optional<CardView> NextDue();
+
+  // Records an answer for id: a correct one doubles the interval and makes
+  // the card due after that many rotations, a miss resets it to 1. The card
+  // goes to the back of the queue. False if there is no such card.
+  bool Answer(int id, bool correct);
+
+  // The console's text format: a block of ID=, Q=, A=, T=, I= and D= lines
+  // per card, ended by "---". Load replaces the deck's contents.
+  bool Save(const std::string& path, std::string* error) const;
+  bool Load(const std::string& path, std::string* error);
+
+ private:
+  template <typename View>
+  friend View detail::Resolve(const Deck& deck, uint32_t index);
+  friend class CardView;
+
+  struct Card {
+    int id = 0;
+    int interval = 1;
+    int due_in = 0;
+    std::string question;
+    std::string answer;
+    std::vector<uint32_t> tags;  // tag ids
+  };
+
+  // Cards live in slots_; removing one moves the last card into its slot.
+  uint32_t Insert(Card card);
+  uint32_t InternTag(std::string tag);
+  std::optional<uint32_t> FindTag(std::string_view tag) const;
+  uint32_t SlotOf(int id) const;  // kNoSlot if absent
+  void CompactQueue();
+
+  static constexpr uint32_t kNoSlot = UINT32_MAX;
+
+  std::vector<Card> cards_;
+  std::unordered_map<int, uint32_t> slot_of_;
+  int next_id_ = 1;
+  // Tag names by id; the map looks them up by string_view without building
+  // a std::string.
+  std::vector<std::string> tag_names_;
+  std::map<std::string, uint32_t, std::less<>> tag_ids_;
+  // Slots of the cards carrying each tag, in no particular order.
+  std::vector<std::vector<uint32_t>> tag_cards_;
+  // Practice queue of card ids from queue_head_ on; ids of removed cards are
+  // skipped when they reach the front.
+  std::vector<int> queue_;
+  size_t queue_head_ = 0;
+};
+
+namespace detail {
+template <>
+inline CardView Resolve<CardView>(const Deck& deck, uint32_t slot) {
+  return CardView(&deck, slot);
+}
+
+template <>
+inline std::string_view Resolve<std::string_view>(const Deck& deck, uint32_t tag) {
+  return deck.tag_names_[tag];
+}
+}  // namespace detail
+
+inline int CardView::id() const { return deck_->cards_[slot_].id; }
+inline std::string_view CardView::question() const { return deck_->cards_[slot_].question; }
+inline std::string_view CardView::answer() const { return deck_->cards_[slot_].answer; }
+inline int CardView::interval() const { return deck_->cards_[slot_].interval; }
+inline int CardView::due_in() const { return deck_->cards_[slot_].due_in; }
+
+inline TagRange CardView::tags() const {
+  const std::vector<uint32_t>& tags = deck_->cards_[slot_].tags;
+  return TagRange(deck_, tags.data(), tags.size());
+}
+
+inline CardView SearchResults::operator[](size_t i) const { return range()[i]; }
+
+}  // namespace flashsprint
+
+#endif  // FLASHSPRINT_DECK_HPP_
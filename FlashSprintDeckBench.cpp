@@ -0,0 +1,239 @@
+/*
+ FlashSprint deck library check and benchmark
+
+ A small driver for FlashSprintDeck.hpp, alongside the console's --bench
+ modes. It builds a synthetic deck, then checks and times:
+
+  - tag lookups: WithTag and Search against a plain scan of every card
+  - Save/Load: a reloaded deck matches card for card and saves to the same
+    bytes
+  - threads: four threads searching one shared deck, and four building,
+    saving and reloading decks of their own
+
+ Given a deck file saved by the console, it also loads it and saves it
+ back, which must reproduce the file byte for byte. Exits non-zero on the
+ first mismatch.
+
+ Compile and run:
+   g++ -std=c++17 -O2 -pthread -o deckbench FlashSprintDeck.cpp FlashSprintDeckBench.cpp
+   ./deckbench [cards] [console deck file]
+*/
+
+#include "FlashSprintDeck.hpp"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using flashsprint::CardView;
+using flashsprint::Deck;
+
+namespace {
+
+const char* const kTags[] = {"array", "queue", "stack", "graph", "tree",
+                             "heap", "hash", "sort", "dp", "string"};
+constexpr size_t kTagCount = sizeof(kTags) / sizeof(kTags[0]);
+constexpr int kThreads = 4;
+
+double Seconds(std::chrono::steady_clock::time_point since) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+}
+
+bool Fail(const std::string& what) {
+  std::fprintf(stderr, "FAIL: %s\n", what.c_str());
+  return false;
+}
+
+// A temporary file path, removed by the destructor.
+class TempPath {
+ public:
+  TempPath() {
+    char name[] = "/tmp/deckbench-XXXXXX";
+    int fd = mkstemp(name);
+    if (fd >= 0) {
+      close(fd);
+      path_ = name;
+    }
+  }
+  ~TempPath() {
+    if (!path_.empty()) std::remove(path_.c_str());
+  }
+  TempPath(const TempPath&) = delete;
+  TempPath& operator=(const TempPath&) = delete;
+  const std::string& path() const { return path_; }
+
+ private:
+  std::string path_;
+};
+
+bool ReadFile(const std::string& path, std::string* out) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) return false;
+  out->assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  return true;
+}
+
+// Synthetic deck of n cards with two tags each, some removed and some
+// answered so intervals, due counts and the queue are not all fresh.
+Deck BuildDeck(int n, unsigned salt) {
+  Deck deck;
+  for (int i = 0; i < n; ++i) {
+    unsigned k = static_cast<unsigned>(i) + salt;
+    deck.Add("Synthetic question " + std::to_string(i) + " about " + kTags[k % kTagCount] + "?",
+             "Synthetic answer " + std::to_string(i),
+             {kTags[k % kTagCount], kTags[(k / 7) % kTagCount]});
+  }
+  for (int id = 5; id <= n; id += 5) deck.Remove(id);
+  for (int i = 0; i < n / 2; ++i) {
+    std::optional<CardView> card = deck.NextDue();
+    if (!card) break;
+    deck.Answer(card->id(), (i + static_cast<int>(salt)) % 3 != 0);
+  }
+  return deck;
+}
+
+std::set<int> Ids(const flashsprint::CardRange& range) {
+  std::set<int> ids;
+  for (CardView card : range) ids.insert(card.id());
+  return ids;
+}
+
+std::set<int> ScanIds(const Deck& deck, const char* a, const char* b) {
+  std::set<int> ids;
+  for (CardView card : deck.cards()) {
+    if (card.HasTag(a) && (!b || card.HasTag(b))) ids.insert(card.id());
+  }
+  return ids;
+}
+
+bool CheckTags(const Deck& deck) {
+  for (const char* a : kTags) {
+    if (Ids(deck.WithTag(a)) != ScanIds(deck, a, nullptr))
+      return Fail(std::string("WithTag(") + a + ") differs from a scan");
+    for (const char* b : kTags) {
+      std::set<int> found;
+      for (CardView card : deck.Search(std::string(a) + "," + b)) found.insert(card.id());
+      if (found != ScanIds(deck, a, b))
+        return Fail(std::string("Search(") + a + "," + b + ") differs from a scan");
+    }
+  }
+  return true;
+}
+
+bool SameCards(const Deck& a, const Deck& b) {
+  if (a.size() != b.size()) return Fail("reloaded deck has a different card count");
+  for (CardView x : a.cards()) {
+    std::optional<CardView> y = b.Find(x.id());
+    if (!y) return Fail("card " + std::to_string(x.id()) + " lost on reload");
+    if (x.question() != y->question() || x.answer() != y->answer() ||
+        x.interval() != y->interval() || x.due_in() != y->due_in() ||
+        !std::equal(x.tags().begin(), x.tags().end(), y->tags().begin(), y->tags().end()))
+      return Fail("card " + std::to_string(x.id()) + " changed on reload");
+  }
+  return true;
+}
+
+// Saves deck, loads it into a fresh one, and saves that again; both files
+// must match byte for byte.
+bool RoundTrip(const Deck& deck, Deck* reloaded) {
+  TempPath first, second;
+  std::string error, a, b;
+  if (first.path().empty() || second.path().empty()) return Fail("no temporary file");
+  if (!deck.Save(first.path(), &error)) return Fail(error);
+  if (!reloaded->Load(first.path(), &error)) return Fail(error);
+  if (!SameCards(deck, *reloaded)) return false;
+  if (!reloaded->Save(second.path(), &error)) return Fail(error);
+  if (!ReadFile(first.path(), &a) || !ReadFile(second.path(), &b)) return Fail("read back");
+  if (a != b) return Fail("saved files differ after a round trip");
+  return true;
+}
+
+bool CheckConsoleFile(const std::string& path) {
+  Deck deck;
+  TempPath out;
+  std::string error, original, saved;
+  if (!deck.Load(path, &error)) return Fail(error);
+  if (!deck.Save(out.path(), &error)) return Fail(error);
+  if (!ReadFile(path, &original) || !ReadFile(out.path(), &saved)) return Fail("read back");
+  if (original != saved) return Fail(path + ": saved copy differs from the console's file");
+  std::printf("console file: %zu cards, %zu tags, saved back byte-identical\n", deck.size(),
+              deck.tag_count());
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int cards = argc > 1 ? std::atoi(argv[1]) : 200000;
+  if (cards <= 0) cards = 200000;
+
+  auto start = std::chrono::steady_clock::now();
+  Deck deck = BuildDeck(cards, 0);
+  std::printf("built %zu cards (%zu tags) in %.3f s\n", deck.size(), deck.tag_count(),
+              Seconds(start));
+
+  start = std::chrono::steady_clock::now();
+  if (!CheckTags(deck)) return 1;
+  std::printf("tag lookups match a full scan (%.3f s)\n", Seconds(start));
+
+  start = std::chrono::steady_clock::now();
+  Deck reloaded;
+  if (!RoundTrip(deck, &reloaded)) return 1;
+  if (!CheckTags(reloaded)) return 1;
+  std::printf("save/load round trip identical (%.3f s)\n", Seconds(start));
+
+  // Readers share one deck; the library allows concurrent reads.
+  std::vector<size_t> expected;
+  for (const char* a : kTags) {
+    for (const char* b : kTags) expected.push_back(deck.Search(std::string(a) + "," + b).size());
+  }
+  std::atomic<int> failures{0};
+  std::vector<std::thread> threads;
+  start = std::chrono::steady_clock::now();
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&deck, &expected, &failures, t] {
+      for (int pass = 0; pass < 20; ++pass) {
+        size_t i = 0;
+        for (const char* a : kTags) {
+          for (const char* b : kTags) {
+            const char* first = (pass + t) % 2 ? a : b;
+            const char* second = first == a ? b : a;
+            if (deck.Search(std::string(first) + "," + second).size() != expected[i]) ++failures;
+            ++i;
+          }
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  threads.clear();
+  if (failures) return Fail("concurrent searches disagreed"), 1;
+  std::printf("%d threads searching one deck agree (%.3f s)\n", kThreads, Seconds(start));
+
+  // Writers each own a deck; separate decks share nothing.
+  start = std::chrono::steady_clock::now();
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([cards, &failures, t] {
+      Deck own = BuildDeck(cards / kThreads, static_cast<unsigned>(t + 1));
+      Deck back;
+      if (!CheckTags(own) || !RoundTrip(own, &back)) ++failures;
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  if (failures) return 1;
+  std::printf("%d threads with their own decks round-trip (%.3f s)\n", kThreads,
+              Seconds(start));
+
+  if (argc > 2 && !CheckConsoleFile(argv[2])) return 1;
+  return 0;
+}
@@ -1,16 +1,22 @@
 // lib/main.dart
+import 'dart:async';
 import 'dart:convert';
+import 'dart:io';
 import 'dart:math';
+import 'dart:typed_data';
 
 import 'package:fl_chart/fl_chart.dart';
 import 'package:flip_card/flip_card.dart';
 import 'package:flutter/material.dart';
+import 'package:flutter/services.dart';
 import 'package:flutter_slidable/flutter_slidable.dart';
 import 'package:hive_flutter/hive_flutter.dart';
 import 'package:flutter_local_notifications/flutter_local_notifications.dart';
 import 'package:timezone/data/latest.dart' as tz;
 import 'package:timezone/timezone.dart' as tz;
 
+import 'native_engine.dart';
+
 /// Flashcard model
 class Flashcard {
   int id;
@@ -62,9 +68,21 @@ class LeitnerSystem {
   late Box _box;
   int _nextId = 1;
 
+  /// Whether cards are persisted by the runner's native deck file rather
+  /// than as JSON in the Hive box. Set once the deck has been opened.
+  bool _native = false;
+
+  /// Native card engine in the Linux runner (linux/runner/engine_channel.cc).
+  static const MethodChannel _engine = MethodChannel('flashsprint/engine');
+
+  /// Direct dart:ffi access to the same engine, bound once the deck is open.
+  NativeEngine? _ffi;
+
   Future<void> init() async {
     _box = await Hive.openBox('flashcards_box_v1');
 
+    if (Platform.isLinux && await _loadNative()) return;
+
     final stored = _box.get('cards') as String?;
     if (stored != null) {
       final Map<String, dynamic> decoded =
@@ -81,6 +99,63 @@ class LeitnerSystem {
     }
   }
 
+  /// Opens the runner's native deck, which on first use migrates the cards
+  /// out of the Hive box (the box is left as it was), and rebuilds the cards
+  /// from the columns it returns. Returns false when the runner has no
+  /// engine, neither store has cards yet or the native load failed, in which
+  /// case init falls back to the Hive box.
+  Future<bool> _loadNative() async {
+    final path = _box.path;
+    if (path == null) return false;
+    final deckPath = '${File(path).parent.path}/flashcards_v1.fsdeck';
+    Map<Object?, Object?>? columns;
+    try {
+      columns = await _engine.invokeMapMethod<Object?, Object?>(
+          'openDeck', {'hivePath': path, 'deckPath': deckPath});
+    } on MissingPluginException {
+      return false;
+    } on PlatformException catch (e) {
+      debugPrint('Native deck unavailable: ${e.code} ${e.message}');
+      return false;
+    }
+    if (columns == null) return false;
+    _native = true;
+    _ffi = NativeEngine.bind();
+
+    final count = columns['count'] as int;
+    final ids = columns['ids'] as Int64List;
+    final epochs = columns['epochs'] as Int64List;
+    final reviewCounts = columns['reviewCounts'] as Int32List;
+    final boxNumbers = columns['boxNumbers'] as Int32List;
+    final text = columns['text'] as Uint8List;
+    final spans = columns['spans'] as Int32List;
+    final tagStarts = columns['tagStarts'] as Int32List;
+    final tagRefs = columns['tagRefs'] as Int32List;
+    final tagNames = (columns['tagNames'] as List<Object?>).cast<String>();
+
+    String slice(int offset, int length) =>
+        utf8.decode(Uint8List.sublistView(text, offset, offset + length));
+
+    for (int i = 0; i < count; i++) {
+      final card = Flashcard(
+        id: ids[i],
+        question: slice(spans[i * 4], spans[i * 4 + 1]),
+        answer: slice(spans[i * 4 + 2], spans[i * 4 + 3]),
+        tags: [
+          for (int t = tagStarts[i]; t < tagStarts[i + 1]; t++)
+            tagNames[tagRefs[t]]
+        ],
+        reviewCount: reviewCounts[i],
+        boxNumber: boxNumbers[i],
+        lastReviewedEpoch: epochs[i],
+      );
+      _cards[card.id] = card;
+      _boxes[card.boxNumber].add(card.id);
+      _nextId = max(_nextId, card.id + 1);
+    }
+    return true;
+  }
+
   /// 50 prebuilt DSA flashcards
   Future<void> _populateInitial() async {
     final initial = [
@@ -333,7 +408,18 @@ class LeitnerSystem {
     }
   }
 
-  Future<void> _persist() async {
+  /// Saves the cards. The native engine is told about the one card that was
+  /// [put] (added or changed) or [removed] and its autosave thread writes it
+  /// out; the Hive box is rewritten whole.
+  Future<void> _persist({Flashcard? put, int? removed}) async {
+    if (_native) {
+      if (put != null) {
+        await _engine.invokeMethod('putCard', put.toMap());
+      } else if (removed != null) {
+        await _engine.invokeMethod('removeCard', {'id': removed});
+      }
+      return;
+    }
     final out = <String, dynamic>{};
     _cards.forEach((k, v) => out['$k'] = v.toMap());
     await _box.put('cards', jsonEncode(out));
@@ -341,8 +427,18 @@ class LeitnerSystem {
 
   List<Flashcard> get allCards => _cards.values.toList();
 
+  /// Live updates from the native engine (box counts, saves), or null when
+  /// the cards are not native.
+  Stream<List<EngineEvent>>? get engineEvents => _ffi?.events;
+
   Map<String, int> getBoxStats() {
     final Map<String, int> stats = {};
+    final ffi = _ffi;
+    if (ffi != null) {
+      final native = ffi.stats();
+      for (int i = 0; i < boxesCount; i++) stats['Box ${i + 1}'] = native.boxCounts[i];
+      return stats;
+    }
     for (int i = 0; i < boxesCount; i++) stats['Box ${i + 1}'] = _boxes[i].length;
     return stats;
   }
@@ -364,7 +460,7 @@ class LeitnerSystem {
     final card = Flashcard(id: id, question: q, answer: a, tags: tags, boxNumber: 0);
     _cards[id] = card;
     _boxes[0].add(id);
-    await _persist();
+    await _persist(put: card);
     return card;
   }
 
@@ -374,7 +470,7 @@ class LeitnerSystem {
     c.question = q;
     c.answer = a;
     c.tags = tags;
-    await _persist();
+    await _persist(put: c);
   }
 
   Future<void> deleteCard(int id) async {
@@ -382,10 +478,24 @@ class LeitnerSystem {
     final c = _cards[id]!;
     _boxes[c.boxNumber].remove(id);
     _cards.remove(id);
-    await _persist();
+    await _persist(removed: id);
   }
 
   Future<void> reviewResult(Flashcard card, bool correct) async {
+    final ffi = _ffi;
+    if (ffi != null) {
+      // The engine applies the same Leitner rule; take its result.
+      final epoch = DateTime.now().toUtc().millisecondsSinceEpoch ~/ 1000;
+      final result = ffi.review([(card.id, correct, epoch)]).single;
+      if (result != null) {
+        final (box, reviews) = result;
+        card.boxNumber = box;
+        card.reviewCount = reviews;
+        card.lastReviewedEpoch = epoch;
+        _boxes[card.boxNumber].add(card.id);
+        return;
+      }
+    }
     card.reviewCount++;
     if (correct) {
       if (card.boxNumber < boxesCount - 1) card.boxNumber++;
@@ -394,13 +504,73 @@ class LeitnerSystem {
     }
     card.lastReviewedEpoch = DateTime.now().toUtc().millisecondsSinceEpoch ~/ 1000;
     _boxes[card.boxNumber].add(card.id);
-    await _persist();
+    await _persist(put: card);
   }
 
   List<Flashcard> searchByTag(String tag) {
+    final ffi = _ffi;
+    if (ffi != null) {
+      final found = <Flashcard>[];
+      for (int skip = 0;;) {
+        final batch = ffi.searchTag(tag.trim(), skip: skip);
+        for (int i = 0; i < batch.length; i++) {
+          final c = _cards[batch.id(i)];
+          if (c != null) found.add(c);
+        }
+        skip += batch.length;
+        if (batch.length == 0 || skip >= batch.total) return found;
+      }
+    }
     final t = tag.trim().toLowerCase();
     return _cards.values.where((c) => c.tags.map((e) => e.toLowerCase()).contains(t)).toList();
   }
+
+  /// Full-text search with snippets and match positions cut by the native
+  /// engine. Without it, falls back to [searchByTag] and whole, unmarked
+  /// questions and answers.
+  List<SearchHit> search(String query) {
+    final ffi = _ffi;
+    if (ffi != null) return ffi.search(query).$1;
+    return searchByTag(query)
+        .map((c) => SearchHit(c.id, Snippet(c.question), Snippet(c.answer)))
+        .toList();
+  }
+
+  /// Number of cards whose [field] lies in [lo, hi], from the native range
+  /// indexes when available.
+  int countInRange(RangeField field, int lo, int hi) {
+    final ffi = _ffi;
+    if (ffi != null) return ffi.findRange(field, lo, hi).total;
+    int key(Flashcard c) {
+      final interval = c.boxNumber == 0 ? 1 : (1 << (c.boxNumber - 1));
+      return switch (field) {
+        RangeField.reviewCount => c.reviewCount,
+        RangeField.lastReviewed => c.lastReviewedEpoch,
+        RangeField.due => c.lastReviewedEpoch + interval * 86400,
+        RangeField.interval => interval,
+      };
+    }
+    return _cards.values
+        .where((c) => field != RangeField.due || c.lastReviewedEpoch != 0)
+        .where((c) => key(c) >= lo && key(c) <= hi)
+        .length;
+  }
+
+  /// The tags most common among [search]'s matches, with their counts,
+  /// counted by the native engine over the whole result set.
+  List<(String, int)> facets(String query, {int limit = 8}) {
+    final ffi = _ffi;
+    if (ffi != null) return ffi.facets(query, limit: limit);
+    final counts = <String, int>{};
+    for (final c in searchByTag(query)) {
+      for (final t in c.tags.map((e) => e.toLowerCase()).toSet()) {
+        counts[t] = (counts[t] ?? 0) + 1;
+      }
+    }
+    final sorted = counts.entries.toList()
+      ..sort((a, b) => b.value != a.value ? b.value - a.value : a.key.compareTo(b.key));
+    return [for (final e in sorted.take(limit)) (e.key, e.value)];
+  }
 }
 
 /// Notifications
@@ -413,7 +583,14 @@ Future<void> initNotifications() async {
   await flutterLocalNotificationsPlugin.initialize(initializationSettings);
 }
 
+Future<void>? _notificationsReady;
+
+/// Initializes notifications once, on first use or after the first frame,
+/// whichever comes first; nothing before the first frame needs them.
+Future<void> ensureNotifications() => _notificationsReady ??= initNotifications();
+
 Future<void> scheduleReminderForCard(int cardId, String title, String body, int daysFromNow) async {
+  await ensureNotifications();
   final scheduledDate = tz.TZDateTime.now(tz.local).add(Duration(days: daysFromNow));
   await flutterLocalNotificationsPlugin.zonedSchedule(
     cardId,
@@ -437,11 +614,11 @@ Future<void> scheduleReminderForCard(int cardId, String title, String body, int
 void main() async {
   WidgetsFlutterBinding.ensureInitialized();
   await Hive.initFlutter();
-  await initNotifications();
   final system = LeitnerSystem();
   await system.init();
   await Hive.openBox('settings'); // for dark mode
   runApp(FlashcardApp(system: system));
+  WidgetsBinding.instance.addPostFrameCallback((_) => ensureNotifications());
 }
 
 class FlashcardApp extends StatefulWidget {
@@ -499,12 +676,25 @@ class _HomePageState extends State<HomePage> {
   final qCtrl = TextEditingController();
   final aCtrl = TextEditingController();
   final tagCtrl = TextEditingController();
-  List<Flashcard> searchResults = [];
+  List<SearchHit> searchResults = [];
+  List<(String, int)> searchFacets = [];
+  StreamSubscription<List<EngineEvent>>? _engineEvents;
 
   @override
   void initState() {
     super.initState();
     _loadNext();
+    // Redraw the box stats whenever the engine reports new counts, not only
+    // after this page's own actions.
+    _engineEvents = widget.system.engineEvents?.listen((batch) {
+      if (mounted && batch.any((e) => e.kind == EngineEvent.boxCount)) setState(() {});
+    });
+  }
+
+  @override
+  void dispose() {
+    _engineEvents?.cancel();
+    super.dispose();
   }
 
   void _loadNext() {
@@ -603,6 +793,12 @@ class _HomePageState extends State<HomePage> {
 
    Widget _buildDashboard() {
      final stats = widget.system.getBoxStats();
+     final now = DateTime.now().toUtc().millisecondsSinceEpoch ~/ 1000;
+     final rows = {
+       ...stats,
+       'Overdue by over a week': widget.system.countInRange(RangeField.due, 0, now - 7 * 86400),
+       'Reviewed over 20 times': widget.system.countInRange(RangeField.reviewCount, 21, 1 << 31),
+     };
      final total = widget.system.totalCards.clamp(1, 999999);
      final sections = <PieChartSectionData>[];
      final colors = [Colors.deepPurple, Colors.indigo, Colors.teal, Colors.orange, Colors.red];
@@ -628,7 +824,7 @@ class _HomePageState extends State<HomePage> {
          Padding(
            padding: const EdgeInsets.symmetric(horizontal: 16),
            child: Column(
-             children: stats.entries.map((e){
+             children: rows.entries.map((e){
                return Row(
                  mainAxisAlignment: MainAxisAlignment.spaceBetween,
                  children: [
@@ -668,10 +864,34 @@ class _HomePageState extends State<HomePage> {
      );
    }
 
+   /// Renders a snippet with its highlights; the ranges come from the engine,
+   /// so nothing here searches the text again.
+   Widget _snippetText(Snippet s, {TextStyle? style}) {
+     final mark = TextStyle(
+       fontWeight: FontWeight.bold,
+       backgroundColor: Theme.of(context).colorScheme.primaryContainer,
+     );
+     final spans = <TextSpan>[if (s.clippedHead) const TextSpan(text: '… ')];
+     int at = 0;
+     for (final (start, length) in s.highlights) {
+       if (start > at) spans.add(TextSpan(text: s.text.substring(at, start)));
+       spans.add(TextSpan(text: s.text.substring(start, start + length), style: mark));
+       at = start + length;
+     }
+     if (at < s.text.length) spans.add(TextSpan(text: s.text.substring(at)));
+     if (s.clippedTail) spans.add(const TextSpan(text: ' …'));
+     return Text.rich(TextSpan(style: style, children: spans));
+   }
+
    void _onSearch(String q) {
      setState(() {
-       if (q.trim().isEmpty) searchResults = [];
-       else searchResults = widget.system.searchByTag(q);
+       if (q.trim().isEmpty) {
+         searchResults = [];
+         searchFacets = [];
+       } else {
+         searchResults = widget.system.search(q);
+         searchFacets = widget.system.facets(q);
+       }
      });
    }
 
@@ -727,14 +947,25 @@ class _HomePageState extends State<HomePage> {
             Padding(
               padding: const EdgeInsets.symmetric(horizontal: 16),
               child: TextField(
-                decoration: const InputDecoration(labelText: 'Search by tag (e.g., queue)'),
+                decoration: const InputDecoration(labelText: 'Search cards and tags (e.g., queue)'),
                 onChanged: _onSearch,
               ),
             ),
+            if (searchFacets.isNotEmpty)
+              Padding(
+                padding: const EdgeInsets.fromLTRB(16, 8, 16, 0),
+                child: Wrap(
+                  spacing: 6,
+                  runSpacing: 4,
+                  children: searchFacets
+                      .map((f) => Chip(label: Text('${f.$1} (${f.$2})'), visualDensity: VisualDensity.compact))
+                      .toList(),
+                ),
+              ),
             if (searchResults.isNotEmpty)
               Column(
                 children: searchResults
-                    .map((c) => ListTile(title: Text(c.question), subtitle: Text(c.answer)))
+                    .map((h) => ListTile(title: _snippetText(h.question), subtitle: _snippetText(h.answer)))
                     .toList(),
               ),
             const Divider(),
@@ -0,0 +1,484 @@
+import 'dart:async';
+import 'dart:convert';
+import 'dart:ffi';
+import 'dart:isolate';
+import 'dart:math';
+import 'dart:typed_data';
+
+import 'package:ffi/ffi.dart';
+
+/// dart:ffi bindings for the Linux runner's card engine
+/// (linux/runner/engine_ffi.h). The struct layouts below must match it.
+
+/// FsTextBuffer: memory owned here that a call copies card text into.
+final class FsTextBuffer extends Struct {
+  external Pointer<Uint8> data;
+  @Uint32()
+  external int capacity;
+  @Uint32()
+  external int used;
+  @Int32()
+  external int written;
+  @Int32()
+  external int full;
+}
+
+/// FsCardView: one card, with text pointing into an [FsTextBuffer].
+final class FsCardView extends Struct {
+  @Int64()
+  external int id;
+  @Int64()
+  external int lastReviewedEpoch;
+  external Pointer<Uint8> question;
+  external Pointer<Uint8> answer;
+  external Pointer<Uint32> tagIds;
+  @Uint32()
+  external int questionLength;
+  @Uint32()
+  external int answerLength;
+  @Uint32()
+  external int tagCount;
+  @Int32()
+  external int reviewCount;
+  @Int32()
+  external int boxNumber;
+  @Int32()
+  external int reserved;
+}
+
+final class FsReview extends Struct {
+  @Int64()
+  external int id;
+  @Int64()
+  external int reviewedEpoch;
+  @Int32()
+  external int correct;
+  @Int32()
+  external int reserved;
+}
+
+final class FsReviewResult extends Struct {
+  @Int64()
+  external int id;
+  @Int32()
+  external int boxNumber;
+  @Int32()
+  external int reviewCount;
+}
+
+final class FsStats extends Struct {
+  @Int64()
+  external int cardCount;
+  @Int64()
+  external int tagCount;
+  @Int64()
+  external int stringBytes;
+  @Array(5)
+  external Array<Int64> boxCounts;
+}
+
+final class FsHighlight extends Struct {
+  @Uint32()
+  external int offset;
+  @Uint32()
+  external int length;
+}
+
+final class FsSearchHit extends Struct {
+  @Int64()
+  external int id;
+  external Pointer<Uint8> question;
+  external Pointer<Uint8> answer;
+  @Uint32()
+  external int questionLength;
+  @Uint32()
+  external int answerLength;
+  @Uint32()
+  external int highlightBegin;
+  @Uint16()
+  external int questionHighlights;
+  @Uint16()
+  external int answerHighlights;
+  @Uint32()
+  external int flags;
+  @Uint32()
+  external int reserved;
+  @Uint64()
+  external int tagMask;
+}
+
+final class FsFacet extends Struct {
+  @Uint32()
+  external int tag;
+  @Uint32()
+  external int count;
+}
+
+final class FsEvent extends Struct {
+  @Int64()
+  external int seq;
+  @Int32()
+  external int kind;
+  @Int32()
+  external int arg0;
+  @Int64()
+  external int arg1;
+  @Int64()
+  external int arg2;
+}
+
+/// A live update from the engine's event ring (FS_EVENT_* in engine_ffi.h).
+class EngineEvent {
+  /// A box's card count changed: [arg0] is the box, [arg1] its count.
+  static const int boxCount = 1;
+
+  /// Deck save progress: [arg0] is 0 started, 1 done, -1 failed; [arg1] is
+  /// the number of cards.
+  static const int deckSave = 2;
+
+  final int kind;
+  final int arg0;
+  final int arg1;
+  final int arg2;
+
+  const EngineEvent(this.kind, this.arg0, this.arg1, this.arg2);
+}
+
+/// Card fields with a native range index, in FS_RANGE_* order
+/// (engine_ffi.h). Epochs are seconds since the Unix epoch; [due] is the last
+/// review plus the box's interval, and [interval] is that interval in days.
+/// Cards never reviewed have no [due] and match no range over it.
+enum RangeField { reviewCount, lastReviewed, due, interval }
+
+/// A batch of cards returned by [NativeEngine]. The engine copies the cards
+/// into [NativeEngine]'s own buffers, so changes to the deck made meanwhile
+/// on the platform thread cannot touch it, but the next call on the engine
+/// reuses them: read the batch before making another.
+class CardBatch {
+  final Pointer<FsCardView> _views;
+
+  /// Number of cards in this batch.
+  final int length;
+
+  /// Number of cards that matched, which may be more than [length].
+  final int total;
+
+  CardBatch._(this._views, this.length, this.total);
+
+  FsCardView operator [](int i) => _views[i];
+
+  int id(int i) => _views[i].id;
+  String question(int i) => _text(_views[i].question, _views[i].questionLength);
+  String answer(int i) => _text(_views[i].answer, _views[i].answerLength);
+  Uint32List tagIds(int i) => _views[i].tagIds.asTypedList(_views[i].tagCount);
+
+  static String _text(Pointer<Uint8> p, int length) =>
+      length == 0 ? '' : utf8.decode(p.asTypedList(length));
+}
+
+/// An excerpt of a card's question or answer cut by the engine around the
+/// first match, with every match inside it located. Highlights are
+/// (start, length) in UTF-16 units of [text], ready for substring.
+class Snippet {
+  final String text;
+  final List<(int, int)> highlights;
+
+  /// Whether text was left out before / after the excerpt.
+  final bool clippedHead;
+  final bool clippedTail;
+
+  const Snippet(this.text,
+      {this.highlights = const [], this.clippedHead = false, this.clippedTail = false});
+}
+
+/// One full-text search result (fs_engine_search). Unlike [CardBatch] it
+/// owns copies of everything, so it can be kept across frames.
+class SearchHit {
+  final int id;
+  final Snippet question;
+  final Snippet answer;
+
+  /// Bit i is set if the card's i-th tag matched.
+  final int tagMask;
+
+  const SearchHit(this.id, this.question, this.answer, {this.tagMask = 0});
+}
+
+/// Synchronous access to the runner's engine without the method channel's
+/// codec and thread hop. Only available once the deck is open (see
+/// LeitnerSystem._loadNative).
+class NativeEngine {
+  static const int abiVersion = 6;
+  static const int highlightCapacity = 4096;
+  static const int batchCapacity = 256;
+  static const int textBytes = 64 * 1024;
+
+  final int Function(int, Pointer<FsCardView>, int, Pointer<FsTextBuffer>)
+      _nextCards;
+  final int Function(Pointer<FsReview>, Pointer<FsReviewResult>, int) _review;
+  final int Function(Pointer<Uint8>, int, int, Pointer<FsCardView>, int,
+      Pointer<FsTextBuffer>) _searchTag;
+  final int Function(Pointer<Uint8>, int, int, int, Pointer<FsSearchHit>, int,
+      Pointer<FsHighlight>, int, Pointer<FsTextBuffer>) _search;
+  final int Function(Pointer<Uint8>, int, Pointer<FsFacet>, int) _searchFacets;
+  final int Function(
+      int, int, int, int, Pointer<FsCardView>, int, Pointer<FsTextBuffer>) _findRange;
+  final void Function(Pointer<FsStats>) _stats;
+  final int Function(int, Pointer<Uint8>, int) _tagName;
+  final int Function(Pointer<FsEvent>, int) _pollEvents;
+
+  final Pointer<FsCardView> _views = calloc<FsCardView>(batchCapacity);
+  final Pointer<FsReview> _reviews = calloc<FsReview>(batchCapacity);
+  final Pointer<FsReviewResult> _results = calloc<FsReviewResult>(batchCapacity);
+  final Pointer<FsSearchHit> _hits = calloc<FsSearchHit>(batchCapacity);
+  final Pointer<FsHighlight> _highlights = calloc<FsHighlight>(highlightCapacity);
+  final Pointer<FsFacet> _facets = calloc<FsFacet>(batchCapacity);
+  final Pointer<FsStats> _statsOut = calloc<FsStats>();
+  final Pointer<FsEvent> _events = calloc<FsEvent>(batchCapacity);
+  final Pointer<FsTextBuffer> _text = calloc<FsTextBuffer>();
+
+  NativeEngine._(DynamicLibrary lib)
+      : _nextCards = lib.lookupFunction<
+            Int32 Function(Int32, Pointer<FsCardView>, Int32, Pointer<FsTextBuffer>),
+            int Function(int, Pointer<FsCardView>, int,
+                Pointer<FsTextBuffer>)>('fs_engine_next_cards'),
+        _review = lib.lookupFunction<
+            Int32 Function(Pointer<FsReview>, Pointer<FsReviewResult>, Int32),
+            int Function(Pointer<FsReview>, Pointer<FsReviewResult>,
+                int)>('fs_engine_review'),
+        _searchTag = lib.lookupFunction<
+            Int32 Function(Pointer<Uint8>, Int32, Int32, Pointer<FsCardView>,
+                Int32, Pointer<FsTextBuffer>),
+            int Function(Pointer<Uint8>, int, int, Pointer<FsCardView>, int,
+                Pointer<FsTextBuffer>)>('fs_engine_search_tag'),
+        _search = lib.lookupFunction<
+            Int32 Function(Pointer<Uint8>, Int32, Int32, Int32,
+                Pointer<FsSearchHit>, Int32, Pointer<FsHighlight>, Int32,
+                Pointer<FsTextBuffer>),
+            int Function(Pointer<Uint8>, int, int, int, Pointer<FsSearchHit>,
+                int, Pointer<FsHighlight>, int,
+                Pointer<FsTextBuffer>)>('fs_engine_search'),
+        _searchFacets = lib.lookupFunction<
+            Int32 Function(Pointer<Uint8>, Int32, Pointer<FsFacet>, Int32),
+            int Function(Pointer<Uint8>, int, Pointer<FsFacet>,
+                int)>('fs_engine_search_facets'),
+        _findRange = lib.lookupFunction<
+            Int32 Function(Int32, Int64, Int64, Int32, Pointer<FsCardView>, Int32,
+                Pointer<FsTextBuffer>),
+            int Function(int, int, int, int, Pointer<FsCardView>, int,
+                Pointer<FsTextBuffer>)>('fs_engine_find_range'),
+        _stats = lib.lookupFunction<Void Function(Pointer<FsStats>),
+            void Function(Pointer<FsStats>)>('fs_engine_stats'),
+        _tagName = lib.lookupFunction<Int32 Function(Uint32, Pointer<Uint8>, Int32),
+            int Function(int, Pointer<Uint8>, int)>('fs_engine_tag_name'),
+        _pollEvents = lib.lookupFunction<Int32 Function(Pointer<FsEvent>, Int32),
+            int Function(Pointer<FsEvent>, int)>('fs_events_poll') {
+    _text.ref
+      ..data = calloc<Uint8>(textBytes)
+      ..capacity = textBytes;
+  }
+
+  /// Binds the engine exported by the running executable, or returns null if
+  /// it does not export one with this ABI version.
+  static NativeEngine? bind() {
+    try {
+      final lib = DynamicLibrary.executable();
+      final version = lib.lookupFunction<Int32 Function(), int Function()>(
+          'fs_engine_abi_version');
+      if (version() != abiVersion) return null;
+      return NativeEngine._(lib);
+    } on ArgumentError {
+      return null;
+    }
+  }
+
+  /// Runs [call] against the text buffer, doubling the buffer while it cannot
+  /// hold even the first result. Returns what [call] returned.
+  int _withText(int Function() call) {
+    for (;;) {
+      final result = call();
+      final text = _text.ref;
+      if (text.full == 0 || text.written > 0) return result;
+      final capacity = text.capacity * 2;
+      calloc.free(text.data);
+      text
+        ..data = calloc<Uint8>(capacity)
+        ..capacity = capacity;
+    }
+  }
+
+  /// Up to [batchCapacity] cards in review order after the first [skip].
+  CardBatch nextCards({int skip = 0}) {
+    final n = max(_withText(() => _nextCards(skip, _views, batchCapacity, _text)), 0);
+    return CardBatch._(_views, n, n);
+  }
+
+  /// Up to [batchCapacity] cards tagged [tag], ignoring ASCII case, after
+  /// the first [skip]; [CardBatch.total] counts every match.
+  CardBatch searchTag(String tag, {int skip = 0}) {
+    final bytes = utf8.encode(tag);
+    final p = calloc<Uint8>(bytes.isEmpty ? 1 : bytes.length);
+    try {
+      p.asTypedList(bytes.length).setAll(0, bytes);
+      final total = max(
+          _withText(() => _searchTag(p, bytes.length, skip, _views, batchCapacity, _text)),
+          0);
+      return CardBatch._(_views, _text.ref.written, total);
+    } finally {
+      calloc.free(p);
+    }
+  }
+
+  /// Up to [batchCapacity] cards whose [field] lies in [lo, hi], in field
+  /// order, after the first [skip]; [CardBatch.total] counts every match.
+  CardBatch findRange(RangeField field, int lo, int hi, {int skip = 0}) {
+    final total = max(
+        _withText(
+            () => _findRange(field.index, lo, hi, skip, _views, batchCapacity, _text)),
+        0);
+    return CardBatch._(_views, _text.ref.written, total);
+  }
+
+  /// Full-text search over questions, answers and tags: up to
+  /// [batchCapacity] hits after the first [skip], with snippets of at most
+  /// [snippetBytes] UTF-8 bytes, and the total number of matching cards.
+  (List<SearchHit>, int) search(String query, {int skip = 0, int snippetBytes = 96}) {
+    final bytes = utf8.encode(query);
+    final p = calloc<Uint8>(bytes.isEmpty ? 1 : bytes.length);
+    try {
+      p.asTypedList(bytes.length).setAll(0, bytes);
+      final total = max(
+          _withText(() => _search(p, bytes.length, skip, snippetBytes, _hits,
+              batchCapacity, _highlights, highlightCapacity, _text)),
+          0);
+      final n = _text.ref.written;
+      final hits = <SearchHit>[];
+      for (int i = 0; i < n; i++) {
+        final h = _hits[i];
+        final answerBegin = h.highlightBegin + h.questionHighlights;
+        hits.add(SearchHit(
+          h.id,
+          Snippet(CardBatch._text(h.question, h.questionLength),
+              highlights: _ranges(h.highlightBegin, h.questionHighlights),
+              clippedHead: h.flags & 1 != 0,
+              clippedTail: h.flags & 2 != 0),
+          Snippet(CardBatch._text(h.answer, h.answerLength),
+              highlights: _ranges(answerBegin, h.answerHighlights),
+              clippedHead: h.flags & 4 != 0,
+              clippedTail: h.flags & 8 != 0),
+          tagMask: h.tagMask,
+        ));
+      }
+      return (hits, total);
+    } finally {
+      calloc.free(p);
+    }
+  }
+
+  /// The [limit] (at most [batchCapacity]) tags carried by most of the
+  /// cards matching [query], with how many carry each, most common first.
+  List<(String, int)> facets(String query, {int limit = 8}) {
+    final bytes = utf8.encode(query);
+    final p = calloc<Uint8>(bytes.isEmpty ? 1 : bytes.length);
+    try {
+      p.asTypedList(bytes.length).setAll(0, bytes);
+      final n = max(
+          _searchFacets(p, bytes.length, _facets, min(limit, batchCapacity)), 0);
+      return [
+        for (int i = 0; i < n; i++) (tagName(_facets[i].tag), _facets[i].count)
+      ];
+    } finally {
+      calloc.free(p);
+    }
+  }
+
+  List<(int, int)> _ranges(int begin, int count) => [
+        for (int i = begin; i < begin + count; i++)
+          (_highlights[i].offset, _highlights[i].length)
+      ];
+
+  /// Applies reviews in order, [batchCapacity] per native call. Returns the
+  /// new (box, reviewCount) per review, or null for unknown ids.
+  List<(int, int)?> review(List<(int id, bool correct, int epoch)> reviews) {
+    final out = <(int, int)?>[];
+    for (int start = 0; start < reviews.length; start += batchCapacity) {
+      final n = min(batchCapacity, reviews.length - start);
+      for (int i = 0; i < n; i++) {
+        final (id, correct, epoch) = reviews[start + i];
+        _reviews[i]
+          ..id = id
+          ..reviewedEpoch = epoch
+          ..correct = correct ? 1 : 0;
+      }
+      _review(_reviews, _results, n);
+      for (int i = 0; i < n; i++) {
+        final r = _results[i];
+        out.add(r.boxNumber < 0 ? null : (r.boxNumber, r.reviewCount));
+      }
+    }
+    return out;
+  }
+
+  FsStats stats() {
+    _stats(_statsOut);
+    return _statsOut.ref;
+  }
+
+  StreamController<List<EngineEvent>>? _eventStream;
+
+  /// Events from the engine's ring, delivered in batches. A helper isolate
+  /// blocks in fs_events_wait and pings this isolate, which then drains
+  /// everything published so far with fs_events_poll; there is no message
+  /// per event.
+  Stream<List<EngineEvent>> get events {
+    final existing = _eventStream;
+    if (existing != null) return existing.stream;
+    final controller = StreamController<List<EngineEvent>>.broadcast();
+    _eventStream = controller;
+    final wakeups = ReceivePort();
+    wakeups.listen((_) => _drainEvents(controller));
+    Isolate.spawn(_waitForEvents, wakeups.sendPort);
+    return controller.stream;
+  }
+
+  void _drainEvents(StreamController<List<EngineEvent>> controller) {
+    for (;;) {
+      final n = _pollEvents(_events, batchCapacity);
+      if (n <= 0) return;
+      final batch = <EngineEvent>[];
+      for (int i = 0; i < n; i++) {
+        final e = _events[i];
+        batch.add(EngineEvent(e.kind, e.arg0, e.arg1, e.arg2));
+      }
+      controller.add(batch);
+      if (n < batchCapacity) return;
+    }
+  }
+
+  /// Helper isolate: wakes [port] whenever new events have been published.
+  static void _waitForEvents(SendPort port) {
+    final wait = DynamicLibrary.executable().lookupFunction<
+        Int64 Function(Int64, Int32), int Function(int, int)>('fs_events_wait');
+    int seen = 0;
+    for (;;) {
+      final published = wait(seen, 1000);
+      if (published != seen) {
+        seen = published;
+        port.send(null);
+      }
+    }
+  }
+
+  String tagName(int tag) {
+    final text = _text.ref;
+    final length = _tagName(tag, text.data, text.capacity);
+    if (length <= 0) return '';
+    if (length <= text.capacity) return CardBatch._text(text.data, length);
+    final p = calloc<Uint8>(length);
+    try {
+      return CardBatch._text(p, min(_tagName(tag, p, length), length));
+    } finally {
+      calloc.free(p);
+    }
+  }
+}
@@ -0,0 +1,382 @@
+#include "card_store.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Out-of-line definition for C++14: the vector calls below bind kNoSlot to a
+// const reference.
+constexpr uint32_t CardStore::kNoSlot;
+
+void CardStore::Clear() {
+  cards_.clear();
+  strings_.clear();
+  pending_string_ = 0;
+  tag_refs_.clear();
+  tag_offsets_.clear();
+  tag_lengths_.clear();
+  tag_table_.clear();
+  tag_postings_.clear();
+  tag_ref_pos_.clear();
+  id_table_.clear();
+  for (auto& box : boxes_) box = BoxList();
+  queue_prev_.clear();
+  queue_next_.clear();
+  for (auto& index : ranges_) index.Clear();
+  ranges_built_ = false;
+  ++text_version_;
+}
+
+void CardStore::Reserve(size_t cards, size_t string_bytes) {
+  cards_.reserve(cards);
+  strings_.reserve(string_bytes);
+  tag_refs_.reserve(cards * 2);
+  tag_ref_pos_.reserve(cards * 2);
+  queue_prev_.reserve(cards);
+  queue_next_.reserve(cards);
+  IdGrow(cards);
+}
+
+char* CardStore::BeginString(size_t max_size) {
+  pending_string_ = strings_.size();
+  strings_.resize(pending_string_ + max_size);
+  return strings_.data() + pending_string_;
+}
+
+uint32_t CardStore::EndString(size_t size) {
+  strings_.resize(pending_string_ + size);
+  return static_cast<uint32_t>(pending_string_);
+}
+
+uint32_t CardStore::AppendString(const char* data, size_t size) {
+  uint32_t offset = static_cast<uint32_t>(strings_.size());
+  strings_.insert(strings_.end(), data, data + size);
+  return offset;
+}
+
+namespace {
+
+uint32_t HashBytes(const char* data, size_t size) {
+  uint32_t h = 2166136261u;  // FNV-1a
+  for (size_t i = 0; i < size; ++i) h = (h ^ static_cast<uint8_t>(data[i])) * 16777619u;
+  return h;
+}
+
+}  // namespace
+
+uint32_t CardStore::InternTag(const char* data, size_t size) {
+  if (tag_table_.size() < (tag_offsets_.size() + 1) * 2) {
+    // Grow to keep the load factor under one half.
+    std::vector<uint32_t> table(std::max<size_t>(64, tag_table_.size() * 2), 0);
+    size_t mask = table.size() - 1;
+    for (uint32_t tag = 0; tag < tag_offsets_.size(); ++tag) {
+      size_t i = HashBytes(strings_.data() + tag_offsets_[tag], tag_lengths_[tag]) & mask;
+      while (table[i] != 0) i = (i + 1) & mask;
+      table[i] = tag + 1;
+    }
+    tag_table_.swap(table);
+  }
+  size_t mask = tag_table_.size() - 1;
+  size_t i = HashBytes(data, size) & mask;
+  for (; tag_table_[i] != 0; i = (i + 1) & mask) {
+    uint32_t tag = tag_table_[i] - 1;
+    if (tag_lengths_[tag] == size &&
+        memcmp(strings_.data() + tag_offsets_[tag], data, size) == 0)
+      return tag;
+  }
+  uint32_t tag = static_cast<uint32_t>(tag_offsets_.size());
+  tag_offsets_.push_back(AppendString(data, size));
+  tag_lengths_.push_back(static_cast<uint32_t>(size));
+  tag_postings_.emplace_back();
+  tag_table_[i] = tag + 1;
+  return tag;
+}
+
+uint32_t CardStore::AddCard(const CardRecord& record, const uint32_t* tag_ids,
+                            size_t tag_count) {
+  CardRecord card = record;
+  card.box_number = std::min(std::max(card.box_number, 0), kBoxCount - 1);
+  card.tags_begin = static_cast<uint32_t>(tag_refs_.size());
+  card.tag_count = static_cast<uint32_t>(tag_count);
+  tag_refs_.insert(tag_refs_.end(), tag_ids, tag_ids + tag_count);
+  tag_ref_pos_.resize(tag_refs_.size(), kNoSlot);
+
+  ++text_version_;
+  uint32_t slot = static_cast<uint32_t>(cards_.size());
+  uint32_t existing = FindSlot(card.id);
+  if (existing != kNoSlot) {
+    // Same id seen again: the later entry wins, in place.
+    slot = existing;
+    Unlink(slot);
+    cards_[slot] = card;
+  } else {
+    cards_.push_back(card);
+    queue_prev_.push_back(kNoSlot);
+    queue_next_.push_back(kNoSlot);
+    IdInsert(card.id, slot);
+  }
+  IndexRanges(slot);
+  PostingsAdd(slot);
+  QueuePush(slot);
+  return slot;
+}
+
+bool CardStore::RemoveCard(int64_t id) {
+  uint32_t slot = FindSlot(id);
+  if (slot == kNoSlot) return false;
+  Unlink(slot);
+  IdErase(id);
+  ++text_version_;
+
+  uint32_t last = static_cast<uint32_t>(cards_.size() - 1);
+  if (slot != last) {
+    // Move the last card into the hole, keeping its queue positions.
+    UnindexRanges(last);
+    const CardRecord& moved = cards_[last];
+    for (uint32_t r = moved.tags_begin; r < moved.tags_begin + moved.tag_count; ++r) {
+      tag_postings_[tag_refs_[r]][tag_ref_pos_[r]] = slot;
+    }
+    BoxList& box = boxes_[moved.box_number];
+    const uint32_t prev = queue_prev_[last], next = queue_next_[last];
+    queue_prev_[slot] = prev;
+    queue_next_[slot] = next;
+    (prev == kNoSlot ? box.head : queue_next_[prev]) = slot;
+    (next == kNoSlot ? box.tail : queue_prev_[next]) = slot;
+    id_table_[IdBucket(moved.id)] = slot + 1;
+    cards_[slot] = moved;
+    IndexRanges(slot);
+  }
+  cards_.pop_back();
+  queue_prev_.pop_back();
+  queue_next_.pop_back();
+  return true;
+}
+
+void CardStore::SetReviewState(uint32_t slot, int32_t review_count,
+                               int32_t box_number,
+                               int64_t last_reviewed_epoch) {
+  CardRecord& card = cards_[slot];
+  QueueErase(slot);
+  UnindexRanges(slot);
+  card.review_count = review_count;
+  card.box_number = std::min(std::max(box_number, 0), kBoxCount - 1);
+  card.last_reviewed_epoch = last_reviewed_epoch;
+  QueuePush(slot);
+  IndexRanges(slot);
+}
+
+int64_t CardStore::RangeKey(const CardRecord& card, RangeField field) {
+  switch (field) {
+    case kReviewCount:
+      return card.review_count;
+    case kLastReviewed:
+      return card.last_reviewed_epoch;
+    default:
+      return card.last_reviewed_epoch +
+             int64_t{IntervalDays(card.box_number)} * 86400;
+  }
+}
+
+const RangeIndex& CardStore::range_index(RangeField field) {
+  if (!ranges_built_) {
+    std::vector<RangeIndex::Entry> entries;
+    entries.reserve(cards_.size());
+    for (int f = 0; f < kRangeFieldCount; ++f) {
+      const RangeField field = static_cast<RangeField>(f);
+      entries.clear();
+      for (uint32_t slot = 0; slot < cards_.size(); ++slot) {
+        if (!HasRangeKey(cards_[slot], field)) continue;
+        entries.push_back({RangeKey(cards_[slot], field), slot});
+      }
+      ranges_[f].Build(entries);
+    }
+    ranges_built_ = true;
+  }
+  return ranges_[field];
+}
+
+void CardStore::IndexRanges(uint32_t slot) {
+  if (!ranges_built_) return;
+  for (int f = 0; f < kRangeFieldCount; ++f) {
+    const RangeField field = static_cast<RangeField>(f);
+    if (!HasRangeKey(cards_[slot], field)) continue;
+    ranges_[f].Insert(RangeKey(cards_[slot], field), slot);
+  }
+}
+
+void CardStore::UnindexRanges(uint32_t slot) {
+  if (!ranges_built_) return;
+  for (int f = 0; f < kRangeFieldCount; ++f) {
+    const RangeField field = static_cast<RangeField>(f);
+    if (!HasRangeKey(cards_[slot], field)) continue;
+    ranges_[f].Erase(RangeKey(cards_[slot], field), slot);
+  }
+}
+
+void CardStore::Unlink(uint32_t slot) {
+  PostingsErase(slot);
+  QueueErase(slot);
+  UnindexRanges(slot);
+}
+
+void CardStore::QueuePush(uint32_t slot) {
+  BoxList& box = boxes_[cards_[slot].box_number];
+  queue_prev_[slot] = box.tail;
+  queue_next_[slot] = kNoSlot;
+  (box.tail == kNoSlot ? box.head : queue_next_[box.tail]) = slot;
+  box.tail = slot;
+  ++box.size;
+}
+
+void CardStore::QueueErase(uint32_t slot) {
+  BoxList& box = boxes_[cards_[slot].box_number];
+  const uint32_t prev = queue_prev_[slot], next = queue_next_[slot];
+  (prev == kNoSlot ? box.head : queue_next_[prev]) = next;
+  (next == kNoSlot ? box.tail : queue_prev_[next]) = prev;
+  --box.size;
+}
+
+void CardStore::PostingsAdd(uint32_t slot) {
+  const CardRecord& card = cards_[slot];
+  for (uint32_t r = card.tags_begin; r < card.tags_begin + card.tag_count; ++r) {
+    auto& postings = tag_postings_[tag_refs_[r]];
+    tag_ref_pos_[r] = static_cast<uint32_t>(postings.size());
+    postings.push_back(slot);
+  }
+}
+
+void CardStore::PostingsErase(uint32_t slot) {
+  const CardRecord& card = cards_[slot];
+  for (uint32_t r = card.tags_begin; r < card.tags_begin + card.tag_count; ++r) {
+    const uint32_t tag = tag_refs_[r];
+    auto& postings = tag_postings_[tag];
+    const uint32_t last = static_cast<uint32_t>(postings.size() - 1);
+    const uint32_t pos = tag_ref_pos_[r];
+    if (pos != last) {
+      // Fill the hole with the last posting and repoint that card's ref.
+      const uint32_t moved = postings[last];
+      postings[pos] = moved;
+      const CardRecord& other = cards_[moved];
+      for (uint32_t o = other.tags_begin; o < other.tags_begin + other.tag_count; ++o) {
+        if (tag_refs_[o] == tag && tag_ref_pos_[o] == last) {
+          tag_ref_pos_[o] = pos;
+          break;
+        }
+      }
+    }
+    postings.pop_back();
+    tag_ref_pos_[r] = kNoSlot;
+  }
+}
+
+bool CardStore::RestoreLinks(const std::vector<uint32_t>* boxes) {
+  const uint32_t cards = static_cast<uint32_t>(cards_.size());
+  queue_prev_.assign(cards, kNoSlot);
+  queue_next_.assign(cards, kNoSlot);
+  size_t queued = 0;
+  for (int b = 0; b < kBoxCount; ++b) {
+    boxes_[b] = BoxList();
+    for (uint32_t slot : boxes[b]) {
+      if (slot >= cards || cards_[slot].box_number != b ||
+          queue_prev_[slot] != kNoSlot || boxes_[b].head == slot) {
+        return false;
+      }
+      QueuePush(slot);
+    }
+    queued += boxes_[b].size;
+  }
+  if (queued != cards) return false;
+
+  tag_ref_pos_.assign(tag_refs_.size(), kNoSlot);
+  size_t refs = 0, postings_total = 0;
+  for (const CardRecord& card : cards_) refs += card.tag_count;
+  for (const auto& postings : tag_postings_) postings_total += postings.size();
+  if (refs != postings_total) return false;
+  for (uint32_t tag = 0; tag < tag_postings_.size(); ++tag) {
+    const auto& postings = tag_postings_[tag];
+    for (uint32_t pos = 0; pos < postings.size(); ++pos) {
+      if (postings[pos] >= cards) return false;
+      const CardRecord& card = cards_[postings[pos]];
+      uint32_t r = card.tags_begin, end = card.tags_begin + card.tag_count;
+      if (end > tag_refs_.size()) return false;
+      while (r < end && (tag_refs_[r] != tag || tag_ref_pos_[r] != kNoSlot)) ++r;
+      if (r == end) return false;
+      tag_ref_pos_[r] = pos;
+    }
+  }
+  return true;
+}
+
+uint32_t CardStore::FindSlot(int64_t id) const {
+  if (id_table_.empty()) return kNoSlot;
+  uint32_t entry = id_table_[IdBucket(id)];
+  return entry == 0 ? kNoSlot : entry - 1;
+}
+
+namespace {
+
+size_t MixId(int64_t id) {
+  uint64_t x = static_cast<uint64_t>(id);
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdull;
+  x ^= x >> 33;
+  return static_cast<size_t>(x);
+}
+
+}  // namespace
+
+size_t CardStore::IdBucket(int64_t id) const {
+  const size_t mask = id_table_.size() - 1;
+  size_t i = MixId(id) & mask;
+  while (id_table_[i] != 0 && cards_[id_table_[i] - 1].id != id) {
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+void CardStore::IdInsert(int64_t id, uint32_t slot) {
+  IdGrow(cards_.size());
+  id_table_[IdBucket(id)] = slot + 1;
+}
+
+void CardStore::IdErase(int64_t id) {
+  // Backward-shift deletion keeps every probe chain unbroken.
+  const size_t mask = id_table_.size() - 1;
+  size_t hole = IdBucket(id);
+  id_table_[hole] = 0;
+  for (size_t i = (hole + 1) & mask; id_table_[i] != 0; i = (i + 1) & mask) {
+    size_t home = MixId(cards_[id_table_[i] - 1].id) & mask;
+    // Move the entry back if its home is not in (hole, i].
+    if (((i - home) & mask) >= ((i - hole) & mask)) {
+      id_table_[hole] = id_table_[i];
+      id_table_[i] = 0;
+      hole = i;
+    }
+  }
+}
+
+void CardStore::IdGrow(size_t cards) {
+  // Keep the load factor at or under one half.
+  if (cards * 2 <= id_table_.size()) return;
+  size_t size = std::max<size_t>(64, id_table_.size());
+  while (size < cards * 2) size *= 2;
+  std::vector<uint32_t> old;
+  old.swap(id_table_);
+  id_table_.assign(size, 0);
+  for (uint32_t entry : old) {
+    if (entry != 0) id_table_[IdBucket(cards_[entry - 1].id)] = entry;
+  }
+}
+
+StrRef CardStore::question(uint32_t slot) const {
+  const CardRecord& c = cards_[slot];
+  return StrRef{strings_.data() + c.question_offset, c.question_length};
+}
+
+StrRef CardStore::answer(uint32_t slot) const {
+  const CardRecord& c = cards_[slot];
+  return StrRef{strings_.data() + c.answer_offset, c.answer_length};
+}
+
+StrRef CardStore::tag_name(uint32_t tag) const {
+  return StrRef{strings_.data() + tag_offsets_[tag], tag_lengths_[tag]};
+}
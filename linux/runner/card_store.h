@@ -0,0 +1,216 @@
+#ifndef FLUTTER_CARD_STORE_H_
+#define FLUTTER_CARD_STORE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include "range_index.h"
+
+// A slice of UTF-8 text owned by a CardStore (or by an input buffer).
+struct StrRef {
+  const char* data;
+  size_t size;
+};
+
+// One flashcard as the Flutter app models it (see Flashcard in lib/main.dart).
+// Text lives in the store's string heap; tags are ids into its tag table.
+struct CardRecord {
+  int64_t id;
+  int64_t last_reviewed_epoch;
+  int32_t review_count;
+  int32_t box_number;
+  uint32_t question_offset;
+  uint32_t question_length;
+  uint32_t answer_offset;
+  uint32_t answer_length;
+  uint32_t tags_begin;  // index into CardStore::tag_refs()
+  uint32_t tag_count;
+};
+
+// One Leitner box in review order, read through its store: a list threaded
+// through the store's slots. Valid until the store is next modified.
+class BoxQueue {
+ public:
+  class iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = uint32_t;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const uint32_t*;
+    using reference = uint32_t;
+
+    iterator() = default;
+    uint32_t operator*() const { return slot_; }
+    iterator& operator++() {
+      slot_ = next_[slot_];
+      return *this;
+    }
+    iterator operator++(int) {
+      iterator old = *this;
+      ++*this;
+      return old;
+    }
+    bool operator==(const iterator& other) const { return slot_ == other.slot_; }
+    bool operator!=(const iterator& other) const { return slot_ != other.slot_; }
+
+   private:
+    friend class BoxQueue;
+    iterator(const uint32_t* next, uint32_t slot) : next_(next), slot_(slot) {}
+
+    const uint32_t* next_ = nullptr;
+    uint32_t slot_ = 0xffffffffu;
+  };
+
+  iterator begin() const { return iterator(next_, head_); }
+  iterator end() const { return iterator(next_, 0xffffffffu); }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+ private:
+  friend class CardStore;
+  BoxQueue(const uint32_t* next, uint32_t head, size_t size)
+      : next_(next), head_(head), size_(size) {}
+
+  const uint32_t* next_;
+  uint32_t head_;
+  size_t size_;
+};
+
+// Native card store for the Linux runner. Cards occupy dense slots in load
+// order; an id index, per-tag postings and the Leitner box queues are kept up
+// to date as cards are added, so a load leaves every index ready to use.
+class CardStore {
+ public:
+  static constexpr int kBoxCount = 5;
+  static constexpr uint32_t kNoSlot = 0xffffffffu;
+
+  void Clear();
+  void Reserve(size_t cards, size_t string_bytes);
+
+  // Writes a string straight into the heap: BeginString reserves room for up
+  // to max_size bytes, EndString commits the first size bytes and returns the
+  // heap offset of the string.
+  char* BeginString(size_t max_size);
+  uint32_t EndString(size_t size);
+  uint32_t AppendString(const char* data, size_t size);
+
+  // Returns the id of tag text, adding it to the tag table if new.
+  uint32_t InternTag(const char* data, size_t size);
+
+  // Adds a card whose question/answer are already in the heap. Replaces any
+  // card with the same id. Returns the slot.
+  uint32_t AddCard(const CardRecord& record, const uint32_t* tag_ids,
+                   size_t tag_count);
+
+  // Removes the card with this id, moving the last card into its slot.
+  // Returns false if there is no such card. Its strings stay in the heap
+  // until the store is rebuilt (e.g. written out and read back).
+  bool RemoveCard(int64_t id);
+
+  // Records a review of the card in slot and moves it to the back of its
+  // (possibly new) box queue, as LeitnerSystem.reviewResult does.
+  void SetReviewState(uint32_t slot, int32_t review_count, int32_t box_number,
+                      int64_t last_reviewed_epoch);
+
+  uint32_t FindSlot(int64_t id) const;
+  size_t size() const { return cards_.size(); }
+  const CardRecord& card(uint32_t slot) const { return cards_[slot]; }
+  StrRef question(uint32_t slot) const;
+  StrRef answer(uint32_t slot) const;
+  StrRef tag_name(uint32_t tag) const;
+  size_t tag_count() const { return tag_offsets_.size(); }
+  const std::vector<uint32_t>& tag_refs() const { return tag_refs_; }
+  const std::vector<uint32_t>& tag_postings(uint32_t tag) const {
+    return tag_postings_[tag];
+  }
+  BoxQueue box(int box_number) const {
+    const BoxList& box = boxes_[box_number];
+    return BoxQueue(queue_next_.data(), box.head, box.size);
+  }
+  const char* string_data() const { return strings_.data(); }
+  size_t string_bytes() const { return strings_.size(); }
+
+  // Changes whenever a card is added, replaced or removed (but not when one
+  // is reviewed), so indexes over the text can tell they are out of date.
+  uint64_t text_version() const { return text_version_; }
+
+  // Review-state fields with a range index.
+  enum RangeField { kReviewCount, kLastReviewed, kDueEpoch, kRangeFieldCount };
+
+  // Days until a card in this box is due again, as in the Flutter app.
+  static int32_t IntervalDays(int32_t box_number) {
+    return box_number <= 0 ? 1 : 1 << (box_number - 1);
+  }
+
+  // The card's value of field; kDueEpoch is its last review plus the
+  // interval of its box, in seconds since the Unix epoch.
+  static int64_t RangeKey(const CardRecord& card, RangeField field);
+
+  // Whether card has a value of field at all: a card never reviewed
+  // (last_reviewed_epoch 0) is new rather than due, so the kDueEpoch index
+  // leaves it out instead of dating it to 1970.
+  static bool HasRangeKey(const CardRecord& card, RangeField field) {
+    return field != kDueEpoch || card.last_reviewed_epoch != 0;
+  }
+
+  // Index over field, built from the cards on first use. From then on every
+  // added, removed or reviewed card updates it in place.
+  const RangeIndex& range_index(RangeField field);
+
+ private:
+  // Drops slot from its tag postings, its box queue and the range indexes.
+  void Unlink(uint32_t slot);
+
+  // Box queue and posting list upkeep, each O(1) per entry.
+  void QueuePush(uint32_t slot);
+  void QueueErase(uint32_t slot);
+  void PostingsAdd(uint32_t slot);
+  void PostingsErase(uint32_t slot);
+
+  // Rebuilds the queue links and posting positions from box contents in
+  // order and the postings, after an image restore. False if they do not
+  // describe the cards.
+  bool RestoreLinks(const std::vector<uint32_t>* boxes);
+
+  // Adds / drops slot's entries in the range indexes, once they are built.
+  void IndexRanges(uint32_t slot);
+  void UnindexRanges(uint32_t slot);
+
+  // Id index: linear probing over id_table_, entries are slot + 1.
+  size_t IdBucket(int64_t id) const;  // bucket holding id, or the empty one
+  void IdInsert(int64_t id, uint32_t slot);
+  void IdErase(int64_t id);
+  void IdGrow(size_t cards);
+
+  friend class EngineImage;  // saves and restores the members verbatim
+
+  std::vector<CardRecord> cards_;
+  std::vector<char> strings_;
+  size_t pending_string_ = 0;  // start of the string being written
+  std::vector<uint32_t> tag_refs_;
+  std::vector<uint32_t> tag_offsets_;  // tag id -> heap offset
+  std::vector<uint32_t> tag_lengths_;
+  std::vector<uint32_t> tag_table_;  // open addressing: tag id + 1, 0 = empty
+  std::vector<std::vector<uint32_t>> tag_postings_;
+  // Where each tag_refs_ entry sits in its tag's postings, so a card leaves
+  // a posting list by swapping in the list's last entry.
+  std::vector<uint32_t> tag_ref_pos_;
+  std::vector<uint32_t> id_table_;  // open addressing: slot + 1, 0 = empty
+  // Box queues: doubly linked through the slots, so a review or removal
+  // moves a card between boxes in O(1).
+  struct BoxList {
+    uint32_t head = kNoSlot;
+    uint32_t tail = kNoSlot;
+    size_t size = 0;
+  };
+  BoxList boxes_[kBoxCount];
+  std::vector<uint32_t> queue_prev_;  // by slot
+  std::vector<uint32_t> queue_next_;
+  uint64_t text_version_ = 0;
+  RangeIndex ranges_[kRangeFieldCount];
+  bool ranges_built_ = false;
+};
+
+#endif  // FLUTTER_CARD_STORE_H_
@@ -0,0 +1,517 @@
+#include "cards_json_parser.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CARDS_JSON_X86 1
+#endif
+
+namespace {
+
+// Per-64-byte-block character classes, one bit per byte.
+struct BlockMasks {
+  uint64_t quote;
+  uint64_t backslash;
+  uint64_t op;  // { } [ ] : ,
+  uint64_t whitespace;
+};
+
+// Stage-1 state carried from one block to the next.
+struct Stage1State {
+  uint64_t prev_escaped = 0;
+  uint64_t prev_in_string = 0;  // all ones while inside a string
+  uint64_t prev_scalar = 0;
+};
+
+// Bits of characters escaped by an odd-length backslash run.
+inline uint64_t FindEscaped(uint64_t backslash, uint64_t* prev_escaped) {
+  backslash &= ~*prev_escaped;
+  uint64_t follows_escape = backslash << 1 | *prev_escaped;
+  const uint64_t even_bits = 0x5555555555555555ULL;
+  uint64_t odd_sequence_starts = backslash & ~even_bits & ~follows_escape;
+  unsigned long long sequences_starting_on_even_bits;
+  *prev_escaped = __builtin_uaddll_overflow(odd_sequence_starts, backslash,
+                                            &sequences_starting_on_even_bits);
+  uint64_t invert_mask = sequences_starting_on_even_bits << 1;
+  return (even_bits ^ invert_mask) & follows_escape;
+}
+
+inline uint64_t PrefixXor(uint64_t x) {
+  x ^= x << 1;
+  x ^= x << 2;
+  x ^= x << 4;
+  x ^= x << 8;
+  x ^= x << 16;
+  x ^= x << 32;
+  return x;
+}
+
+// Growable output for stage 1. Every block may add up to 64 entries, so room
+// is ensured once per block and entries are then written eight at a time
+// without per-entry bounds checks (extra slots past the count are ignored).
+// Storage is left uninitialized; only the first count entries are ever read.
+struct IndexBuffer {
+  std::unique_ptr<uint32_t[]> entries;
+  size_t capacity = 0;
+  size_t count = 0;
+  uint32_t* Reserve64() {
+    if (capacity < count + 72) {
+      size_t grown = (count + 72) * 2;
+      std::unique_ptr<uint32_t[]> bigger(new uint32_t[grown]);
+      memcpy(bigger.get(), entries.get(), count * sizeof(uint32_t));
+      entries.swap(bigger);
+      capacity = grown;
+    }
+    return entries.get() + count;
+  }
+};
+
+// Turns one block's classes into index entries: structural characters outside
+// strings, every unescaped quote (so a string is always a quote pair), and the
+// first byte of each number or literal.
+inline void IndexBlock(const BlockMasks& m, uint32_t base, Stage1State* s,
+                       IndexBuffer* out) {
+  uint64_t escaped = FindEscaped(m.backslash, &s->prev_escaped);
+  uint64_t quote = m.quote & ~escaped;
+  uint64_t in_string = PrefixXor(quote) ^ s->prev_in_string;
+  s->prev_in_string = static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+  uint64_t outside = ~in_string;
+  uint64_t scalar = ~(m.op | m.whitespace | quote) & outside;
+  uint64_t scalar_starts = scalar & ~(scalar << 1 | s->prev_scalar);
+  s->prev_scalar = scalar >> 63;
+  uint64_t bits = (m.op & outside) | quote | scalar_starts;
+  if (bits == 0) return;
+  uint32_t* dst = out->Reserve64();
+  int count = __builtin_popcountll(bits);
+  for (int i = 0; i < count; i += 8) {
+    for (int k = 0; k < 8; ++k) {
+      dst[i + k] = base + (bits ? static_cast<uint32_t>(__builtin_ctzll(bits)) : 0);
+      bits &= bits - 1;
+    }
+  }
+  out->count += count;
+}
+
+#ifndef CARDS_JSON_X86
+BlockMasks ClassifyScalar(const char* p) {
+  BlockMasks m = {0, 0, 0, 0};
+  for (int i = 0; i < 64; ++i) {
+    uint64_t bit = 1ULL << i;
+    switch (p[i]) {
+      case '"': m.quote |= bit; break;
+      case '\\': m.backslash |= bit; break;
+      case '{': case '}': case '[': case ']': case ':': case ',':
+        m.op |= bit;
+        break;
+      case ' ': case '\t': case '\n': case '\r': m.whitespace |= bit; break;
+      default: break;
+    }
+  }
+  return m;
+}
+#endif
+
+#ifdef CARDS_JSON_X86
+inline __m128i Eq16(__m128i v, char c) { return _mm_cmpeq_epi8(v, _mm_set1_epi8(c)); }
+
+inline uint64_t Mask16(__m128i m) {
+  return static_cast<uint16_t>(_mm_movemask_epi8(m));
+}
+
+inline BlockMasks ClassifySse2(const char* p) {
+  BlockMasks m = {0, 0, 0, 0};
+  for (int k = 0; k < 4; ++k) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * k));
+    __m128i op = _mm_or_si128(
+        _mm_or_si128(_mm_or_si128(Eq16(v, '{'), Eq16(v, '}')),
+                     _mm_or_si128(Eq16(v, '['), Eq16(v, ']'))),
+        _mm_or_si128(Eq16(v, ':'), Eq16(v, ',')));
+    __m128i ws = _mm_or_si128(_mm_or_si128(Eq16(v, ' '), Eq16(v, '\t')),
+                              _mm_or_si128(Eq16(v, '\n'), Eq16(v, '\r')));
+    int shift = 16 * k;
+    m.quote |= Mask16(Eq16(v, '"')) << shift;
+    m.backslash |= Mask16(Eq16(v, '\\')) << shift;
+    m.op |= Mask16(op) << shift;
+    m.whitespace |= Mask16(ws) << shift;
+  }
+  return m;
+}
+
+__attribute__((target("avx2"))) inline __m256i Eq32(__m256i v, char c) {
+  return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c));
+}
+
+__attribute__((target("avx2"))) inline uint64_t Mask32(__m256i m) {
+  return static_cast<uint32_t>(_mm256_movemask_epi8(m));
+}
+
+__attribute__((target("avx2"))) inline BlockMasks ClassifyAvx2(const char* p) {
+  BlockMasks m = {0, 0, 0, 0};
+  for (int k = 0; k < 2; ++k) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32 * k));
+    __m256i op = _mm256_or_si256(
+        _mm256_or_si256(_mm256_or_si256(Eq32(v, '{'), Eq32(v, '}')),
+                        _mm256_or_si256(Eq32(v, '['), Eq32(v, ']'))),
+        _mm256_or_si256(Eq32(v, ':'), Eq32(v, ',')));
+    __m256i ws = _mm256_or_si256(_mm256_or_si256(Eq32(v, ' '), Eq32(v, '\t')),
+                                 _mm256_or_si256(Eq32(v, '\n'), Eq32(v, '\r')));
+    int shift = 32 * k;
+    m.quote |= Mask32(Eq32(v, '"')) << shift;
+    m.backslash |= Mask32(Eq32(v, '\\')) << shift;
+    m.op |= Mask32(op) << shift;
+    m.whitespace |= Mask32(ws) << shift;
+  }
+  return m;
+}
+#endif
+
+// Runs stage 1 over the whole input. The tail is copied into a block padded
+// with spaces so the classifiers can always read 64 bytes.
+template <BlockMasks (*Classify)(const char*)>
+void BuildIndex(const char* json, size_t size, IndexBuffer* index) {
+  Stage1State state;
+  size_t full = size & ~static_cast<size_t>(63);
+  for (size_t i = 0; i < full; i += 64)
+    IndexBlock(Classify(json + i), static_cast<uint32_t>(i), &state, index);
+  if (full < size) {
+    char tail[64];
+    memset(tail, ' ', sizeof(tail));
+    memcpy(tail, json + full, size - full);
+    IndexBlock(Classify(tail), static_cast<uint32_t>(full), &state, index);
+  }
+}
+
+#ifdef CARDS_JSON_X86
+__attribute__((target("avx2"))) void BuildIndexAvx2(const char* json, size_t size,
+                                                    IndexBuffer* index) {
+  BuildIndex<ClassifyAvx2>(json, size, index);
+}
+#endif
+
+void BuildStructuralIndex(const char* json, size_t size, std::vector<uint32_t>* index) {
+  IndexBuffer buffer;
+  buffer.capacity = size / 3 + 72;  // the cards layout runs ~1 entry per 4 bytes
+  buffer.entries.reset(new uint32_t[buffer.capacity]);
+#ifdef CARDS_JSON_X86
+  if (__builtin_cpu_supports("avx2"))
+    BuildIndexAvx2(json, size, &buffer);
+  else
+    BuildIndex<ClassifySse2>(json, size, &buffer);
+#else
+  BuildIndex<ClassifyScalar>(json, size, &buffer);
+#endif
+  index->assign(buffer.entries.get(), buffer.entries.get() + buffer.count);
+}
+
+// Stage 2: a cursor over the structural index for the fixed card layout.
+class Walker {
+ public:
+  Walker(const char* json, size_t size, const std::vector<uint32_t>& index,
+         CardStore* store)
+      : json_(json), size_(size), index_(index), store_(store) {}
+
+  bool Parse(std::string* error);
+
+ private:
+  char Peek() const { return pos_ < index_.size() ? json_[index_[pos_]] : '\0'; }
+  bool Expect(char c) {
+    if (Peek() != c) return Fail(std::string("expected '") + c + "'");
+    ++pos_;
+    return true;
+  }
+  bool Fail(const std::string& what) {
+    if (error_.empty()) {
+      size_t at = pos_ < index_.size() ? index_[pos_] : size_;
+      error_ = what + " at byte " + std::to_string(at);
+    }
+    return false;
+  }
+
+  // Current token must be a string; returns its raw (still escaped) bytes.
+  bool RawString(const char** data, size_t* length);
+  bool StringToHeap(uint32_t* offset, uint32_t* length);
+  bool Integer(int64_t* value);
+  bool TagList(std::vector<uint32_t>* tags);
+  bool SkipValue();
+  bool Card();
+
+  const char* json_;
+  size_t size_;
+  const std::vector<uint32_t>& index_;
+  CardStore* store_;
+  size_t pos_ = 0;
+  std::string error_;
+  std::vector<uint32_t> tag_scratch_;
+};
+
+bool Walker::RawString(const char** data, size_t* length) {
+  if (Peek() != '"' || pos_ + 1 >= index_.size()) return Fail("expected string");
+  uint32_t open = index_[pos_], close = index_[pos_ + 1];
+  if (json_[close] != '"') return Fail("unterminated string");
+  *data = json_ + open + 1;
+  *length = close - open - 1;
+  pos_ += 2;
+  return true;
+}
+
+void AppendUtf8(uint32_t cp, char** out) {
+  char* o = *out;
+  if (cp < 0x80) {
+    *o++ = static_cast<char>(cp);
+  } else if (cp < 0x800) {
+    *o++ = static_cast<char>(0xC0 | (cp >> 6));
+    *o++ = static_cast<char>(0x80 | (cp & 0x3F));
+  } else if (cp < 0x10000) {
+    *o++ = static_cast<char>(0xE0 | (cp >> 12));
+    *o++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    *o++ = static_cast<char>(0x80 | (cp & 0x3F));
+  } else {
+    *o++ = static_cast<char>(0xF0 | (cp >> 18));
+    *o++ = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+    *o++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    *o++ = static_cast<char>(0x80 | (cp & 0x3F));
+  }
+  *out = o;
+}
+
+bool ParseHex4(const char* p, const char* end, uint32_t* value) {
+  if (end - p < 4) return false;
+  uint32_t v = 0;
+  for (int i = 0; i < 4; ++i) {
+    char c = p[i];
+    v <<= 4;
+    if (c >= '0' && c <= '9') v |= c - '0';
+    else if (c >= 'a' && c <= 'f') v |= c - 'a' + 10;
+    else if (c >= 'A' && c <= 'F') v |= c - 'A' + 10;
+    else return false;
+  }
+  *value = v;
+  return true;
+}
+
+// Unescapes raw string bytes into out, which must have room for raw_length
+// bytes: unescaped text is never longer than the escaped form (\uXXXX is 6
+// bytes for at most 3 of UTF-8, a surrogate pair 12 for 4). Returns the
+// number of bytes written, or -1 on a malformed escape.
+long UnescapeJson(const char* raw, size_t raw_length, char* out) {
+  char* start = out;
+  const char* end = raw + raw_length;
+  for (const char* p = raw; p < end;) {
+    if (*p != '\\') {
+      *out++ = *p++;
+      continue;
+    }
+    if (++p >= end) return -1;
+    char e = *p++;
+    switch (e) {
+      case '"': *out++ = '"'; break;
+      case '\\': *out++ = '\\'; break;
+      case '/': *out++ = '/'; break;
+      case 'b': *out++ = '\b'; break;
+      case 'f': *out++ = '\f'; break;
+      case 'n': *out++ = '\n'; break;
+      case 'r': *out++ = '\r'; break;
+      case 't': *out++ = '\t'; break;
+      case 'u': {
+        uint32_t cp;
+        if (!ParseHex4(p, end, &cp)) return -1;
+        p += 4;
+        uint32_t low;
+        if (cp >= 0xD800 && cp < 0xDC00 && end - p >= 6 && p[0] == '\\' &&
+            p[1] == 'u' && ParseHex4(p + 2, end, &low) && low >= 0xDC00 &&
+            low < 0xE000) {
+          cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+          p += 6;
+        } else if (cp >= 0xD800 && cp < 0xE000) {
+          cp = 0xFFFD;  // lone surrogate
+        }
+        AppendUtf8(cp, &out);
+        break;
+      }
+      default:
+        return -1;
+    }
+  }
+  return out - start;
+}
+
+// Strings without escapes are copied as-is; others are unescaped in place at
+// the end of the heap.
+bool Walker::StringToHeap(uint32_t* offset, uint32_t* length) {
+  const char* raw;
+  size_t raw_length;
+  if (!RawString(&raw, &raw_length)) return false;
+  if (memchr(raw, '\\', raw_length) == nullptr) {
+    *offset = store_->AppendString(raw, raw_length);
+    *length = static_cast<uint32_t>(raw_length);
+    return true;
+  }
+  long written = UnescapeJson(raw, raw_length, store_->BeginString(raw_length));
+  if (written < 0) {
+    store_->EndString(0);
+    return Fail("bad escape");
+  }
+  *length = static_cast<uint32_t>(written);
+  *offset = store_->EndString(*length);
+  return true;
+}
+
+bool Walker::Integer(int64_t* value) {
+  if (pos_ >= index_.size()) return Fail("expected number");
+  const char* p = json_ + index_[pos_];
+  const char* end = json_ + size_;
+  if (end - p >= 4 && memcmp(p, "null", 4) == 0) {
+    ++pos_;
+    return true;  // fromMap treats null as the default
+  }
+  bool negative = *p == '-';
+  if (negative) ++p;
+  if (p >= end || *p < '0' || *p > '9') return Fail("expected integer");
+  uint64_t v = 0;
+  while (p < end && *p >= '0' && *p <= '9') v = v * 10 + static_cast<uint64_t>(*p++ - '0');
+  if (p < end && (*p == '.' || *p == 'e' || *p == 'E')) return Fail("expected integer");
+  *value = negative ? -static_cast<int64_t>(v) : static_cast<int64_t>(v);
+  ++pos_;
+  return true;
+}
+
+bool Walker::TagList(std::vector<uint32_t>* tags) {
+  tags->clear();
+  if (!Expect('[')) return false;
+  if (Peek() == ']') {
+    ++pos_;
+    return true;
+  }
+  for (;;) {
+    const char* raw;
+    size_t raw_length;
+    if (!RawString(&raw, &raw_length)) return false;
+    if (memchr(raw, '\\', raw_length) == nullptr) {
+      tags->push_back(store_->InternTag(raw, raw_length));
+    } else {
+      std::string tag(raw_length, '\0');
+      long written = UnescapeJson(raw, raw_length, &tag[0]);
+      if (written < 0) return Fail("bad escape in tag");
+      tags->push_back(store_->InternTag(tag.data(), static_cast<size_t>(written)));
+    }
+    char c = Peek();
+    ++pos_;
+    if (c == ']') return true;
+    if (c != ',') return Fail("expected ',' or ']' in tags");
+  }
+}
+
+bool Walker::SkipValue() {
+  char c = Peek();
+  if (c == '"') {
+    pos_ += 2;
+    return pos_ <= index_.size() || Fail("unterminated string");
+  }
+  if (c != '{' && c != '[') {
+    ++pos_;
+    return true;
+  }
+  int depth = 0;
+  do {
+    c = Peek();
+    if (c == '\0') return Fail("unterminated value");
+    if (c == '{' || c == '[') ++depth;
+    else if (c == '}' || c == ']') --depth;
+    pos_ += c == '"' ? 2 : 1;
+  } while (depth > 0);
+  return true;
+}
+
+bool Walker::Card() {
+  CardRecord card = {};
+  bool has_id = false, has_question = false, has_answer = false;
+  tag_scratch_.clear();
+  if (!Expect('{')) return false;
+  if (Peek() == '}') return Fail("empty card");
+  for (;;) {
+    const char* key;
+    size_t key_length;
+    if (!RawString(&key, &key_length) || !Expect(':')) return false;
+    auto is = [key, key_length](const char* name) {
+      return key_length == strlen(name) && memcmp(key, name, key_length) == 0;
+    };
+    int64_t v = 0;
+    if (is("id")) {
+      if (!Integer(&v)) return false;
+      card.id = v;
+      has_id = true;
+    } else if (is("question")) {
+      if (!StringToHeap(&card.question_offset, &card.question_length)) return false;
+      has_question = true;
+    } else if (is("answer")) {
+      if (!StringToHeap(&card.answer_offset, &card.answer_length)) return false;
+      has_answer = true;
+    } else if (is("tags")) {
+      if (!TagList(&tag_scratch_)) return false;
+    } else if (is("reviewCount")) {
+      if (!Integer(&v)) return false;
+      card.review_count = static_cast<int32_t>(v);
+    } else if (is("boxNumber")) {
+      if (!Integer(&v)) return false;
+      card.box_number = static_cast<int32_t>(v);
+    } else if (is("lastReviewedEpoch")) {
+      if (!Integer(&v)) return false;
+      card.last_reviewed_epoch = v;
+    } else if (!SkipValue()) {
+      return false;
+    }
+    char c = Peek();
+    ++pos_;
+    if (c == '}') break;
+    if (c != ',') return Fail("expected ',' or '}' in card");
+  }
+  if (!has_id || !has_question || !has_answer) return Fail("card without id/question/answer");
+  store_->AddCard(card, tag_scratch_.data(), tag_scratch_.size());
+  return true;
+}
+
+bool Walker::Parse(std::string* error) {
+  bool ok = Expect('{');
+  if (ok && Peek() == '}') {
+    ++pos_;
+  } else {
+    while (ok) {
+      const char* key;
+      size_t key_length;
+      ok = RawString(&key, &key_length) && Expect(':') && Card();
+      if (!ok) break;
+      char c = Peek();
+      ++pos_;
+      if (c == '}') break;
+      if (c != ',') ok = Fail("expected ',' or '}'");
+    }
+  }
+  if (ok && pos_ != index_.size()) ok = Fail("trailing data");
+  if (!ok) *error = error_;
+  return ok;
+}
+
+}  // namespace
+
+bool ParseCardsJson(const char* json, size_t size, CardStore* store,
+                    std::string* error) {
+  store->Clear();
+  if (size >= UINT32_MAX) {
+    *error = "cards JSON larger than 4 GiB";
+    return false;
+  }
+  std::vector<uint32_t> index;
+  BuildStructuralIndex(json, size, &index);
+  // Rough guess: ~150 bytes of JSON per card, nearly all of it text.
+  store->Reserve(size / 150 + 1, size);
+  Walker walker(json, size, index, store);
+  if (!walker.Parse(error)) {
+    store->Clear();
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,26 @@
+#ifndef FLUTTER_CARDS_JSON_PARSER_H_
+#define FLUTTER_CARDS_JSON_PARSER_H_
+
+#include <cstddef>
+#include <string>
+
+#include "card_store.h"
+
+// Parses the JSON that LeitnerSystem._persist stores under the Hive key
+// 'cards' and adds every card to store (which is cleared first):
+//
+//   {"<id>": {"id": 1, "question": "...", "answer": "...", "tags": ["..."],
+//             "reviewCount": 0, "boxNumber": 0, "lastReviewedEpoch": 0}, ...}
+//
+// Stage 1 builds a structural index 64 bytes at a time with SIMD compares
+// (AVX2 when the CPU has it, SSE2 otherwise, scalar off x86): quotes are
+// matched against backslash runs, a prefix XOR masks out string contents,
+// and the positions of structural characters, quotes and scalar starts are
+// collected. Stage 2 walks that index and unescapes strings directly into the
+// store's string heap, so no intermediate DOM is built.
+//
+// Returns false and sets error if the text is not in this layout.
+bool ParseCardsJson(const char* json, size_t size, CardStore* store,
+                    std::string* error);
+
+#endif  // FLUTTER_CARDS_JSON_PARSER_H_
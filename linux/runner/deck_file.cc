@@ -0,0 +1,378 @@
+#include "deck_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "hive_box_reader.h"
+
+namespace {
+
+constexpr char kMagic[8] = "FSDECK1";
+constexpr uint32_t kVersion = 1;
+constexpr size_t kWriteBuffer = 1 << 20;
+
+static_assert(sizeof(DeckFileHeader) == 64, "deck header layout");
+static_assert(sizeof(CardRecord) == 48, "deck card record layout");
+
+std::string ErrnoMessage(const std::string& path) {
+  return path + ": " + strerror(errno);
+}
+
+// Buffered sequential writer that keeps a running CRC of what it writes.
+class DeckWriter {
+ public:
+  explicit DeckWriter(int fd) : fd_(fd), buffer_(new char[kWriteBuffer]) {}
+
+  bool Write(const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    crc_ = HiveCrc32(reinterpret_cast<const uint8_t*>(p), size, crc_);
+    while (size > 0) {
+      if (used_ == kWriteBuffer && !Flush()) return false;
+      size_t n = std::min(size, kWriteBuffer - used_);
+      memcpy(buffer_.get() + used_, p, n);
+      used_ += n;
+      p += n;
+      size -= n;
+    }
+    return true;
+  }
+
+  bool Flush() {
+    size_t done = 0;
+    while (done < used_) {
+      ssize_t n = write(fd_, buffer_.get() + done, used_ - done);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) return false;
+      done += static_cast<size_t>(n);
+    }
+    used_ = 0;
+    return true;
+  }
+
+  uint32_t crc() const { return crc_; }
+
+ private:
+  int fd_;
+  std::unique_ptr<char[]> buffer_;
+  size_t used_ = 0;
+  uint32_t crc_ = 0;
+};
+
+bool WritePayload(const CardStore& store, DeckWriter* out,
+                  DeckFileHeader* header) {
+  // Tag table; tag names open the string section.
+  uint32_t string_offset = 0;
+  for (uint32_t tag = 0; tag < store.tag_count(); ++tag) {
+    uint32_t entry[2] = {string_offset,
+                         static_cast<uint32_t>(store.tag_name(tag).size)};
+    if (!out->Write(entry, sizeof(entry))) return false;
+    string_offset += entry[1];
+  }
+
+  // Cards, with offsets rewritten for the compacted string section.
+  uint32_t tag_ref = 0;
+  for (uint32_t slot = 0; slot < store.size(); ++slot) {
+    CardRecord card = store.card(slot);
+    card.question_offset = string_offset;
+    string_offset += card.question_length;
+    card.answer_offset = string_offset;
+    string_offset += card.answer_length;
+    card.tags_begin = tag_ref;
+    tag_ref += card.tag_count;
+    if (!out->Write(&card, sizeof(card))) return false;
+  }
+
+  for (uint32_t slot = 0; slot < store.size(); ++slot) {
+    const CardRecord& card = store.card(slot);
+    if (!out->Write(store.tag_refs().data() + card.tags_begin,
+                    card.tag_count * sizeof(uint32_t)))
+      return false;
+  }
+
+  for (uint32_t tag = 0; tag < store.tag_count(); ++tag) {
+    StrRef name = store.tag_name(tag);
+    if (!out->Write(name.data, name.size)) return false;
+  }
+  for (uint32_t slot = 0; slot < store.size(); ++slot) {
+    StrRef question = store.question(slot);
+    StrRef answer = store.answer(slot);
+    if (!out->Write(question.data, question.size) ||
+        !out->Write(answer.data, answer.size))
+      return false;
+  }
+
+  header->tag_ref_count = tag_ref;
+  header->string_bytes = string_offset;
+  return true;
+}
+
+bool CheckHeader(const std::string& path, const DeckFileHeader& h,
+                 std::string* error) {
+  if (memcmp(h.magic, kMagic, sizeof(h.magic)) != 0 ||
+      h.header_size != sizeof(h)) {
+    *error = path + ": not a deck file";
+    return false;
+  }
+  if (h.version != kVersion) {
+    *error = path + ": unsupported deck version " + std::to_string(h.version);
+    return false;
+  }
+  return true;
+}
+
+// Read-only mapping of a whole file, unmapped on destruction.
+struct MappedFile {
+  const uint8_t* data = nullptr;
+  size_t size = 0;
+  ~MappedFile() {
+    if (data != nullptr) munmap(const_cast<uint8_t*>(data), size);
+  }
+};
+
+bool MapFile(const std::string& path, MappedFile* file, std::string* error) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    *error = ErrnoMessage(path);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    *error = ErrnoMessage(path);
+    close(fd);
+    return false;
+  }
+  file->size = static_cast<size_t>(st.st_size);
+  if (file->size > 0) {
+    void* map = mmap(nullptr, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+      *error = ErrnoMessage(path);
+      close(fd);
+      return false;
+    }
+    madvise(map, file->size, MADV_SEQUENTIAL);
+    file->data = static_cast<const uint8_t*>(map);
+  }
+  close(fd);
+  return true;
+}
+
+bool SyncDirectoryOf(const std::string& path) {
+  size_t slash = path.rfind('/');
+  std::string dir = slash == std::string::npos ? "." : path.substr(0, slash);
+  if (dir.empty()) dir = "/";
+  int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) return false;
+  bool ok = fsync(fd) == 0;
+  close(fd);
+  return ok;
+}
+
+}  // namespace
+
+uint32_t DeckDigest(const CardStore& store) {
+  uint32_t crc = 0;
+  for (uint32_t slot = 0; slot < store.size(); ++slot) {
+    const CardRecord& card = store.card(slot);
+    int64_t fields[4] = {card.id, card.last_reviewed_epoch, card.review_count,
+                         card.box_number};
+    crc = HiveCrc32(reinterpret_cast<const uint8_t*>(fields), sizeof(fields),
+                    crc);
+    StrRef texts[2] = {store.question(slot), store.answer(slot)};
+    for (const StrRef& text : texts) {
+      uint32_t length = static_cast<uint32_t>(text.size);
+      crc = HiveCrc32(reinterpret_cast<const uint8_t*>(&length),
+                      sizeof(length), crc);
+      crc = HiveCrc32(reinterpret_cast<const uint8_t*>(text.data), text.size,
+                      crc);
+    }
+    for (uint32_t i = 0; i < card.tag_count; ++i) {
+      StrRef name = store.tag_name(store.tag_refs()[card.tags_begin + i]);
+      uint32_t length = static_cast<uint32_t>(name.size);
+      crc = HiveCrc32(reinterpret_cast<const uint8_t*>(&length),
+                      sizeof(length), crc);
+      crc = HiveCrc32(reinterpret_cast<const uint8_t*>(name.data), name.size,
+                      crc);
+    }
+  }
+  return crc;
+}
+
+bool WriteDeckFile(const CardStore& store, uint64_t generation,
+                   const std::string& path, DeckFileHeader* header,
+                   std::string* error) {
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    *error = ErrnoMessage(path);
+    return false;
+  }
+
+  // The header is written last, once the payload sizes and CRC are known.
+  DeckFileHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, kMagic, sizeof(h.magic));
+  h.version = kVersion;
+  h.header_size = sizeof(DeckFileHeader);
+  h.card_count = store.size();
+  h.tag_count = store.tag_count();
+  h.digest = DeckDigest(store);
+  h.generation = generation;
+
+  DeckWriter out(fd);
+  bool ok = lseek(fd, sizeof(h), SEEK_SET) == sizeof(h) &&
+            WritePayload(store, &out, &h) && out.Flush();
+  h.payload_crc = out.crc();
+  ok = ok && pwrite(fd, &h, sizeof(h), 0) == sizeof(h) && fsync(fd) == 0;
+  if (!ok) *error = ErrnoMessage(path);
+  if (close(fd) != 0 && ok) {
+    *error = ErrnoMessage(path);
+    ok = false;
+  }
+  if (ok && header != nullptr) *header = h;
+  return ok;
+}
+
+bool ReadDeckFile(const std::string& path, CardStore* store,
+                  DeckFileHeader* header, std::string* error) {
+  store->Clear();
+  MappedFile file;
+  if (!MapFile(path, &file, error)) return false;
+
+  DeckFileHeader h;
+  if (file.size < sizeof(h)) {
+    *error = path + ": not a deck file";
+    return false;
+  }
+  memcpy(&h, file.data, sizeof(h));
+  if (!CheckHeader(path, h, error)) return false;
+  const size_t payload = file.size - sizeof(h);
+  if (h.tag_count > payload / 8 || h.card_count > payload / sizeof(CardRecord) ||
+      h.tag_ref_count > payload / 4 || h.string_bytes > payload ||
+      h.tag_count * 8 + h.card_count * sizeof(CardRecord) +
+              h.tag_ref_count * 4 + h.string_bytes != payload) {
+    *error = path + ": truncated or oversized deck";
+    return false;
+  }
+  if (HiveCrc32(file.data + sizeof(h), payload) != h.payload_crc) {
+    *error = path + ": checksum mismatch";
+    return false;
+  }
+
+  const uint8_t* p = file.data + sizeof(h);
+  const uint8_t* tags = p;
+  const uint8_t* cards = tags + h.tag_count * 8;
+  const uint8_t* refs = cards + h.card_count * sizeof(CardRecord);
+  const char* strings =
+      reinterpret_cast<const char*>(refs + h.tag_ref_count * 4);
+
+  store->Reserve(h.card_count, h.string_bytes);
+  std::vector<uint32_t> tag_ids(h.tag_count);
+  for (size_t tag = 0; tag < h.tag_count; ++tag) {
+    uint32_t entry[2];
+    memcpy(entry, tags + tag * 8, sizeof(entry));
+    if (entry[0] > h.string_bytes || entry[1] > h.string_bytes - entry[0]) {
+      *error = path + ": tag out of range";
+      store->Clear();
+      return false;
+    }
+    tag_ids[tag] = store->InternTag(strings + entry[0], entry[1]);
+  }
+
+  std::vector<uint32_t> card_tags;
+  for (size_t i = 0; i < h.card_count; ++i) {
+    CardRecord card;
+    memcpy(&card, cards + i * sizeof(CardRecord), sizeof(card));
+    if (card.question_offset > h.string_bytes ||
+        card.question_length > h.string_bytes - card.question_offset ||
+        card.answer_offset > h.string_bytes ||
+        card.answer_length > h.string_bytes - card.answer_offset ||
+        card.tags_begin > h.tag_ref_count ||
+        card.tag_count > h.tag_ref_count - card.tags_begin) {
+      *error = path + ": card out of range";
+      store->Clear();
+      return false;
+    }
+    card_tags.resize(card.tag_count);
+    for (uint32_t t = 0; t < card.tag_count; ++t) {
+      uint32_t ref;
+      memcpy(&ref, refs + (card.tags_begin + t) * 4, sizeof(ref));
+      if (ref >= h.tag_count) {
+        *error = path + ": tag id out of range";
+        store->Clear();
+        return false;
+      }
+      card_tags[t] = tag_ids[ref];
+    }
+    card.question_offset =
+        store->AppendString(strings + card.question_offset, card.question_length);
+    card.answer_offset =
+        store->AppendString(strings + card.answer_offset, card.answer_length);
+    store->AddCard(card, card_tags.data(), card_tags.size());
+  }
+
+  if (DeckDigest(*store) != h.digest) {
+    *error = path + ": contents do not match the recorded digest";
+    store->Clear();
+    return false;
+  }
+  if (header != nullptr) *header = h;
+  return true;
+}
+
+bool ReadDeckHeader(const std::string& path, DeckFileHeader* header,
+                    std::string* error) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    *error = ErrnoMessage(path);
+    return false;
+  }
+  const bool read = pread(fd, header, sizeof(*header), 0) == sizeof(*header);
+  close(fd);
+  if (!read) {
+    *error = path + ": not a deck file";
+    return false;
+  }
+  return CheckHeader(path, *header, error);
+}
+
+bool ReplaceDeckFile(const CardStore& store, uint64_t generation,
+                     const std::string& path, std::string* error) {
+  const std::string temp = path + ".tmp";
+  DeckFileHeader written;
+  if (!WriteDeckFile(store, generation, temp, &written, error)) {
+    unlink(temp.c_str());
+    return false;
+  }
+
+  // Read the file back before it can replace anything: it must hold every
+  // card, byte-for-byte and in the same order.
+  CardStore check;
+  DeckFileHeader read;
+  if (!ReadDeckFile(temp, &check, &read, error)) {
+    unlink(temp.c_str());
+    return false;
+  }
+  if (check.size() != store.size() || read.digest != written.digest ||
+      read.generation != generation) {
+    *error = temp + ": read back " + std::to_string(check.size()) + " of " +
+             std::to_string(store.size()) + " cards";
+    unlink(temp.c_str());
+    return false;
+  }
+
+  if (rename(temp.c_str(), path.c_str()) != 0) {
+    *error = ErrnoMessage(path);
+    unlink(temp.c_str());
+    return false;
+  }
+  SyncDirectoryOf(path);
+  return true;
+}
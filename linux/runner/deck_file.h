@@ -0,0 +1,64 @@
+#ifndef FLUTTER_DECK_FILE_H_
+#define FLUTTER_DECK_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "card_store.h"
+
+// Native deck file (.fsdeck): the runner's own on-disk copy of a CardStore,
+// replacing the JSON string the Dart side used to keep in the Hive box.
+//
+//   header     64 bytes, see DeckFileHeader
+//   tags       tag_count x {u32 offset, u32 length} into the string section
+//   cards      card_count x CardRecord (48 bytes), offsets into strings
+//   tag refs   tag_ref_count x u32 tag ids
+//   strings    string_bytes of UTF-8: tag names, then question and answer
+//              text card by card
+//
+// Everything after the header is covered by payload_crc (CRC-32), and
+// digest is DeckDigest() of the cards, so a reader can check both that the
+// bytes are intact and that they decode to the deck that was written.
+// generation numbers the deck's journal (deck_journal.h): each compaction
+// writes the next one, and journal records stamped with an older one are
+// already part of the deck. All integers are in host (little-endian) order.
+struct DeckFileHeader {
+  char magic[8];  // "FSDECK1"
+  uint32_t version;
+  uint32_t header_size;
+  uint64_t card_count;
+  uint64_t tag_count;
+  uint64_t tag_ref_count;
+  uint64_t string_bytes;
+  uint32_t payload_crc;
+  uint32_t digest;
+  uint64_t generation;  // zero in decks from before the field was used
+};
+
+// Writes store to path through a fixed-size buffer, one section at a time,
+// compacting the string heap as it goes, and fsyncs the file. header, if not
+// null, receives what was written.
+bool WriteDeckFile(const CardStore& store, uint64_t generation,
+                   const std::string& path, DeckFileHeader* header,
+                   std::string* error);
+
+// Reads and fully validates a deck file into store (which is cleared first).
+bool ReadDeckFile(const std::string& path, CardStore* store,
+                  DeckFileHeader* header, std::string* error);
+
+// Reads just the header of the deck file at path, checking its magic and
+// version but not the payload.
+bool ReadDeckHeader(const std::string& path, DeckFileHeader* header,
+                    std::string* error);
+
+// Writes store to path atomically: a temporary file next to it is written,
+// read back and checked against store, then renamed over path.
+bool ReplaceDeckFile(const CardStore& store, uint64_t generation,
+                     const std::string& path, std::string* error);
+
+// Order-sensitive checksum of the cards' contents (ids, text, tag names,
+// review state), independent of how the store laid them out in memory.
+uint32_t DeckDigest(const CardStore& store);
+
+#endif  // FLUTTER_DECK_FILE_H_
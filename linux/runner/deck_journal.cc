@@ -0,0 +1,227 @@
+#include "deck_journal.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#include "hive_box_reader.h"
+
+namespace {
+
+// Ops 1 and 2 are the unstamped records of earlier builds, read as
+// generation 0.
+constexpr uint8_t kOpPutUnstamped = 1;
+constexpr uint8_t kOpRemoveUnstamped = 2;
+constexpr uint8_t kOpPut = 3;
+constexpr uint8_t kOpRemove = 4;
+constexpr size_t kRecordHeader = 8;
+
+void PutBytes(std::string* out, const void* data, size_t size) {
+  out->append(static_cast<const char*>(data), size);
+}
+
+template <typename T>
+void Put(std::string* out, T value) {
+  PutBytes(out, &value, sizeof(value));
+}
+
+// Reads fields from one record payload, failing on overrun.
+class Reader {
+ public:
+  Reader(const char* data, size_t size) : p_(data), end_(data + size) {}
+
+  template <typename T>
+  bool Get(T* value) {
+    if (static_cast<size_t>(end_ - p_) < sizeof(T)) return false;
+    memcpy(value, p_, sizeof(T));
+    p_ += sizeof(T);
+    return true;
+  }
+
+  bool Bytes(size_t size, const char** data) {
+    if (static_cast<size_t>(end_ - p_) < size) return false;
+    *data = p_;
+    p_ += size;
+    return true;
+  }
+
+  bool done() const { return p_ == end_; }
+
+ private:
+  const char* p_;
+  const char* end_;
+};
+
+// Finishes a record started at offset start: fills in length and CRC.
+void SealRecord(std::string* out, size_t start) {
+  uint32_t length = static_cast<uint32_t>(out->size() - start - kRecordHeader);
+  uint32_t crc = HiveCrc32(
+      reinterpret_cast<const uint8_t*>(out->data() + start + kRecordHeader),
+      length);
+  memcpy(&(*out)[start], &length, sizeof(length));
+  memcpy(&(*out)[start + 4], &crc, sizeof(crc));
+}
+
+// Applies one record unless it is older than generation, counting it in
+// applied. False if the payload is malformed.
+bool ApplyRecord(const char* payload, size_t size, uint64_t generation,
+                 CardStore* store, std::vector<uint32_t>* tag_ids,
+                 size_t* applied) {
+  Reader in(payload, size);
+  uint8_t op;
+  uint64_t stamp = 0;
+  int64_t id;
+  if (!in.Get(&op)) return false;
+  if (op == kOpPut || op == kOpRemove) {
+    if (!in.Get(&stamp)) return false;
+  } else if (op == kOpPutUnstamped) {
+    op = kOpPut;
+  } else if (op == kOpRemoveUnstamped) {
+    op = kOpRemove;
+  } else {
+    return false;
+  }
+  if (!in.Get(&id)) return false;
+  // Already folded into the deck by a compaction.
+  if (stamp < generation) return true;
+  if (op == kOpRemove) {
+    store->RemoveCard(id);
+    ++*applied;
+    return in.done();
+  }
+
+  CardRecord card = {};
+  card.id = id;
+  uint32_t tag_count;
+  const char* question;
+  const char* answer;
+  if (!in.Get(&card.last_reviewed_epoch) || !in.Get(&card.review_count) ||
+      !in.Get(&card.box_number) || !in.Get(&card.question_length) ||
+      !in.Get(&card.answer_length) || !in.Get(&tag_count) ||
+      !in.Bytes(card.question_length, &question) ||
+      !in.Bytes(card.answer_length, &answer))
+    return false;
+  tag_ids->clear();
+  for (uint32_t i = 0; i < tag_count; ++i) {
+    uint32_t length;
+    const char* name;
+    if (!in.Get(&length) || !in.Bytes(length, &name)) return false;
+    tag_ids->push_back(store->InternTag(name, length));
+  }
+  if (!in.done()) return false;
+  card.question_offset = store->AppendString(question, card.question_length);
+  card.answer_offset = store->AppendString(answer, card.answer_length);
+  store->AddCard(card, tag_ids->data(), tag_ids->size());
+  ++*applied;
+  return true;
+}
+
+}  // namespace
+
+void EncodeJournalPut(const CardStore& store, uint32_t slot,
+                      uint64_t generation, std::string* out) {
+  const CardRecord& card = store.card(slot);
+  const size_t start = out->size();
+  out->append(kRecordHeader, '\0');
+  Put(out, kOpPut);
+  Put(out, generation);
+  Put(out, card.id);
+  Put(out, card.last_reviewed_epoch);
+  Put(out, card.review_count);
+  Put(out, card.box_number);
+  Put(out, card.question_length);
+  Put(out, card.answer_length);
+  Put(out, card.tag_count);
+  StrRef question = store.question(slot);
+  StrRef answer = store.answer(slot);
+  PutBytes(out, question.data, question.size);
+  PutBytes(out, answer.data, answer.size);
+  for (uint32_t i = 0; i < card.tag_count; ++i) {
+    StrRef name = store.tag_name(store.tag_refs()[card.tags_begin + i]);
+    Put(out, static_cast<uint32_t>(name.size));
+    PutBytes(out, name.data, name.size);
+  }
+  SealRecord(out, start);
+}
+
+void EncodeJournalRemove(int64_t id, uint64_t generation, std::string* out) {
+  const size_t start = out->size();
+  out->append(kRecordHeader, '\0');
+  Put(out, kOpRemove);
+  Put(out, generation);
+  Put(out, id);
+  SealRecord(out, start);
+}
+
+bool AppendJournal(const std::string& path, const std::string& records,
+                   std::string* error) {
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    *error = path + ": " + strerror(errno);
+    return false;
+  }
+  size_t done = 0;
+  while (done < records.size()) {
+    ssize_t n = write(fd, records.data() + done, records.size() - done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) break;
+    done += static_cast<size_t>(n);
+  }
+  bool ok = done == records.size() && fdatasync(fd) == 0;
+  if (!ok) *error = path + ": " + strerror(errno);
+  close(fd);
+  return ok;
+}
+
+bool ReplayJournal(const std::string& path, uint64_t generation,
+                   CardStore* store, size_t* applied, std::string* error) {
+  if (applied != nullptr) *applied = 0;
+  int fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+  if (fd < 0) {
+    if (errno == ENOENT) return true;
+    *error = path + ": " + strerror(errno);
+    return false;
+  }
+  struct stat st;
+  std::string data;
+  if (fstat(fd, &st) == 0) {
+    data.resize(static_cast<size_t>(st.st_size));
+    size_t done = 0;
+    while (done < data.size()) {
+      ssize_t n = pread(fd, &data[done], data.size() - done,
+                        static_cast<off_t>(done));
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) break;
+      done += static_cast<size_t>(n);
+    }
+    data.resize(done);
+  }
+
+  size_t offset = 0;
+  size_t count = 0;
+  std::vector<uint32_t> tag_ids;
+  while (data.size() - offset >= kRecordHeader) {
+    uint32_t length, crc;
+    memcpy(&length, data.data() + offset, sizeof(length));
+    memcpy(&crc, data.data() + offset + 4, sizeof(crc));
+    if (length > data.size() - offset - kRecordHeader) break;
+    const char* payload = data.data() + offset + kRecordHeader;
+    if (HiveCrc32(reinterpret_cast<const uint8_t*>(payload), length) != crc ||
+        !ApplyRecord(payload, length, generation, store, &tag_ids, &count))
+      break;
+    offset += kRecordHeader + length;
+  }
+  if (offset != data.size() &&
+      ftruncate(fd, static_cast<off_t>(offset)) != 0) {
+    *error = path + ": " + strerror(errno);
+    close(fd);
+    return false;
+  }
+  close(fd);
+  if (applied != nullptr) *applied = count;
+  return true;
+}
@@ -0,0 +1,41 @@
+#ifndef FLUTTER_DECK_JOURNAL_H_
+#define FLUTTER_DECK_JOURNAL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "card_store.h"
+
+// Append-only journal of card changes made since the deck file was last
+// written (DECK.fsdeck.journal). Each record is
+//
+//   u32 payload length, u32 CRC-32 of the payload, payload
+//
+// where the payload is a put (the card's full state: review fields, text and
+// tag names) or a remove (just the id). Every record is stamped with the
+// generation of the deck it follows (DeckFileHeader::generation). Compaction
+// writes the deck with the next generation before it empties the journal,
+// so if it is interrupted in between, replay skips the records the new deck
+// already holds instead of rolling the deck back to them.
+
+// Appends a put record for the card in slot to out.
+void EncodeJournalPut(const CardStore& store, uint32_t slot,
+                      uint64_t generation, std::string* out);
+
+// Appends a remove record for id to out.
+void EncodeJournalRemove(int64_t id, uint64_t generation, std::string* out);
+
+// Appends records to the journal at path and fdatasyncs it.
+bool AppendJournal(const std::string& path, const std::string& records,
+                   std::string* error);
+
+// Applies the journal at path to store, which holds a deck of generation
+// generation; older records are skipped. A missing journal is empty. Replay
+// stops at the first torn or corrupt record (an interrupted append), and the
+// journal is truncated there so later appends follow valid data. applied, if
+// not null, receives the number of records applied.
+bool ReplayJournal(const std::string& path, uint64_t generation,
+                   CardStore* store, size_t* applied, std::string* error);
+
+#endif  // FLUTTER_DECK_JOURNAL_H_
@@ -0,0 +1,40 @@
+#include "deck_migration.h"
+
+#include <chrono>
+
+#include "cards_json_parser.h"
+#include "deck_file.h"
+#include "hive_box_reader.h"
+
+namespace {
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+}  // namespace
+
+bool MigrateHiveBox(const std::string& hive_path, const std::string& deck_path,
+                    CardStore* store, MigrationReport* report,
+                    std::string* error) {
+  *report = MigrationReport();
+  store->Clear();
+
+  auto start = std::chrono::steady_clock::now();
+  HiveBoxReader reader;
+  if (!reader.Open(hive_path, error)) return false;
+  const char* json = nullptr;
+  if (!reader.FindString("cards", &json, &report->json_bytes)) return true;
+  report->found_cards = true;
+  if (!ParseCardsJson(json, report->json_bytes, store, error)) return false;
+  reader.Close();
+  report->cards = store->size();
+  report->parse_ms = MillisecondsSince(start);
+
+  start = std::chrono::steady_clock::now();
+  if (!ReplaceDeckFile(*store, 0, deck_path, error)) return false;
+  report->write_ms = MillisecondsSince(start);
+  return true;
+}
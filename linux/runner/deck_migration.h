@@ -0,0 +1,28 @@
+#ifndef FLUTTER_DECK_MIGRATION_H_
+#define FLUTTER_DECK_MIGRATION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "card_store.h"
+
+struct MigrationReport {
+  bool found_cards = false;  // false: the box had no 'cards' value
+  size_t cards = 0;
+  size_t json_bytes = 0;
+  double parse_ms = 0;
+  double write_ms = 0;  // write, read back and verify, rename
+};
+
+// Moves the cards stored in the Hive box at hive_path (key 'cards', as
+// written by LeitnerSystem._persist) into a deck file at deck_path, leaving
+// them loaded in store. The deck appears at deck_path only after it has been
+// read back and matched card for card, so an interrupted migration leaves
+// the Hive box as the only copy and simply runs again next time. The box
+// itself is never modified.
+bool MigrateHiveBox(const std::string& hive_path, const std::string& deck_path,
+                    CardStore* store, MigrationReport* report,
+                    std::string* error);
+
+#endif  // FLUTTER_DECK_MIGRATION_H_
@@ -0,0 +1,315 @@
+#include "engine.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "deck_file.h"
+#include "deck_journal.h"
+#include "engine_image.h"
+#include "startup_trace.h"
+
+namespace {
+
+std::string JournalPath(const std::string& deck_path) {
+  return deck_path + ".journal";
+}
+
+std::string ImagePath(const std::string& deck_path) {
+  return deck_path + ".image";
+}
+
+size_t FileSize(const std::string& path) {
+  struct stat st;
+  return stat(path.c_str(), &st) == 0 ? static_cast<size_t>(st.st_size) : 0;
+}
+
+}  // namespace
+
+AutosaveOptions AutosaveOptions::FromEnvironment() {
+  AutosaveOptions options;
+  if (const char* ms = getenv("FLASHSPRINT_AUTOSAVE_MS")) {
+    options.interval_ms = std::max(0, atoi(ms));
+  }
+  if (const char* cards = getenv("FLASHSPRINT_AUTOSAVE_CARDS")) {
+    options.max_dirty = static_cast<size_t>(std::max(1, atoi(cards)));
+  }
+  return options;
+}
+
+Engine* Engine::Instance() {
+  static Engine* engine = new Engine();
+  return engine;
+}
+
+bool Engine::Open(const std::string& hive_path, const std::string& deck_path,
+                  OpenResult* result, MigrationReport* report,
+                  std::string* error) {
+  deck_path_.clear();
+  dirty_ids_.clear();
+  saved_changes_ = changes_;
+  if (access(deck_path.c_str(), F_OK) == 0) {
+    // The image left by the last clean exit holds the store ready-made.
+    std::string image_error;
+    DeckFileHeader header;
+    if (EngineImage::Load(ImagePath(deck_path), deck_path, &store_,
+                          &image_error)) {
+      if (!ReadDeckHeader(deck_path, &header, error)) {
+        store_.Clear();
+        return false;
+      }
+      StartupTraceMark("deck restored from image");
+    } else {
+      if (access(ImagePath(deck_path).c_str(), F_OK) == 0) {
+        fprintf(stderr, "Ignoring engine image: %s\n", image_error.c_str());
+        unlink(ImagePath(deck_path).c_str());
+      }
+      size_t replayed = 0;
+      if (!ReadDeckFile(deck_path, &store_, &header, error) ||
+          !ReplayJournal(JournalPath(deck_path), header.generation, &store_,
+                         &replayed, error)) {
+        store_.Clear();
+        return false;
+      }
+      StartupTraceMark("deck loaded");
+    }
+    generation_ = header.generation;
+    *result = OpenResult::kOpened;
+  } else {
+    // A journal or image without its deck belongs to nothing we can load.
+    unlink(JournalPath(deck_path).c_str());
+    unlink(ImagePath(deck_path).c_str());
+    MigrationReport migration;
+    if (!MigrateHiveBox(hive_path, deck_path, &store_, &migration, error)) {
+      store_.Clear();
+      return false;
+    }
+    if (report != nullptr) *report = migration;
+    if (!migration.found_cards) {
+      *result = OpenResult::kEmpty;
+      return true;
+    }
+    generation_ = 0;
+    *result = OpenResult::kMigrated;
+  }
+
+  deck_path_ = deck_path;
+  deck_bytes_ = FileSize(deck_path);
+  journal_bytes_ = FileSize(JournalPath(deck_path));
+  stopping_ = false;
+  if (!autosave_thread_.joinable()) {
+    autosave_thread_ = std::thread(&Engine::AutosaveLoop, this);
+  }
+  PublishBoxCounts();
+  return true;
+}
+
+const SearchIndex& Engine::search_index() {
+  if (!search_index_.IsCurrent(store_)) search_index_.Build(store_);
+  return search_index_;
+}
+
+const TagFacets& Engine::tag_facets() {
+  if (!tag_facets_.IsCurrent(store_)) tag_facets_.Build(store_);
+  return tag_facets_;
+}
+
+bool Engine::Review(int64_t id, bool correct, int64_t reviewed_epoch) {
+  uint32_t slot = store_.FindSlot(id);
+  if (slot == CardStore::kNoSlot) return false;
+  const CardRecord& card = store_.card(slot);
+  int32_t box = correct ? std::min(card.box_number + 1, CardStore::kBoxCount - 1)
+                        : 0;
+  const int old_box = card.box_number;
+  store_.SetReviewState(slot, card.review_count + 1, box, reviewed_epoch);
+  MarkDirty(id);
+  if (box != old_box) {
+    PublishBoxCount(old_box);
+    PublishBoxCount(box);
+  }
+  return true;
+}
+
+void Engine::PublishBoxCounts() {
+  for (int box = 0; box < CardStore::kBoxCount; ++box) PublishBoxCount(box);
+}
+
+void Engine::PublishBoxCount(int box) {
+  events_.Publish(FS_EVENT_BOX_COUNT, box,
+                  static_cast<int64_t>(store_.box(box).size()), 0);
+}
+
+// --- Autosave ---
+
+void Engine::MarkDirty(int64_t id) {
+  if (dirty_ids_.empty()) {
+    dirty_since_ = std::chrono::steady_clock::now();
+    autosave_wakeup_.notify_one();
+  }
+  dirty_ids_.insert(id);
+  ++changes_;
+  if (dirty_ids_.size() == options_.max_dirty) autosave_wakeup_.notify_one();
+}
+
+bool Engine::Flush(std::unique_lock<std::mutex>* lock, std::string* error) {
+  if (!is_open()) {
+    *error = "no deck is open";
+    return false;
+  }
+  const uint64_t target = changes_;
+  const uint64_t failures = failed_checkpoints_;
+  ++flush_waiters_;
+  autosave_wakeup_.notify_one();
+  checkpoint_done_.wait(*lock, [&] {
+    return saved_changes_ >= target || failed_checkpoints_ != failures ||
+           !autosave_thread_.joinable();
+  });
+  --flush_waiters_;
+  if (saved_changes_ >= target) return true;
+  *error = failed_checkpoints_ != failures ? last_error_
+                                          : "autosave is not running";
+  return false;
+}
+
+void Engine::Shutdown() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!autosave_thread_.joinable()) return;
+  // The loop writes whatever is still dirty before it exits.
+  const uint64_t failures = failed_checkpoints_;
+  stopping_ = true;
+  autosave_wakeup_.notify_one();
+  lock.unlock();
+  autosave_thread_.join();
+
+  // Everything is on disk now; leave an image of the store for the next
+  // start, unless the final checkpoint failed and the files lag behind it.
+  lock.lock();
+  if (failed_checkpoints_ != failures) return;
+  std::string error;
+  if (!EngineImage::Save(store_, deck_path_, ImagePath(deck_path_), &error)) {
+    fprintf(stderr, "Engine image not written: %s\n", error.c_str());
+  }
+}
+
+void Engine::AutosaveLoop() {
+  using Clock = std::chrono::steady_clock;
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    if (dirty_ids_.empty()) {
+      if (stopping_) break;
+      // Nothing to write: answer any flush and sleep until a change.
+      saved_changes_ = changes_;
+      checkpoint_done_.notify_all();
+      autosave_wakeup_.wait(lock);
+      continue;
+    }
+    if (!stopping_ && flush_waiters_ == 0) {
+      // Coalesce: wait out the interval, or less once enough cards are
+      // dirty, but keep at least min_gap_ms between checkpoints.
+      Clock::time_point due =
+          dirty_ids_.size() >= options_.max_dirty
+              ? Clock::now()
+              : dirty_since_ + std::chrono::milliseconds(options_.interval_ms);
+      due = std::max(due, last_checkpoint_ +
+                              std::chrono::milliseconds(options_.min_gap_ms));
+      if (Clock::now() < due) {
+        autosave_wakeup_.wait_until(lock, due);
+        continue;
+      }
+    }
+    Checkpoint(&lock);
+  }
+  saved_changes_ = changes_;
+  checkpoint_done_.notify_all();
+}
+
+// Writes the dirty cards. Called on the autosave thread with the lock held;
+// the lock is released while writing, so the UI keeps going.
+//
+// The records always go to the journal first. Compaction then folds deck and
+// journal, as read back from disk, into a deck of the next generation, all
+// off the lock rather than copying the live store under it. Should it stop
+// after the rename but before the truncate, the leftover records carry the
+// old generation and the next replay skips them.
+void Engine::Checkpoint(std::unique_lock<std::mutex>* lock) {
+  std::vector<int64_t> ids(dirty_ids_.begin(), dirty_ids_.end());
+  dirty_ids_.clear();
+  const uint64_t changes = changes_;
+
+  std::string records;
+  for (int64_t id : ids) {
+    uint32_t slot = store_.FindSlot(id);
+    if (slot == CardStore::kNoSlot) {
+      EncodeJournalRemove(id, generation_, &records);
+    } else {
+      EncodeJournalPut(store_, slot, generation_, &records);
+    }
+  }
+  const bool compact = journal_bytes_ + records.size() >
+                       std::max(options_.compact_bytes, deck_bytes_ / 4);
+  const std::string deck_path = deck_path_;
+  const int64_t cards = static_cast<int64_t>(store_.size());
+  events_.Publish(FS_EVENT_DECK_SAVE, 0, cards, 0);
+
+  lock->unlock();
+  std::string error;
+  const bool ok = AppendJournal(JournalPath(deck_path), records, &error);
+  bool renamed = false, compacted = false;
+  DeckFileHeader header;
+  if (ok && compact) {
+    // Only this thread writes the files, so they hold still meanwhile.
+    CardStore folded;
+    std::string compact_error;
+    renamed = ReadDeckFile(deck_path, &folded, &header, &compact_error) &&
+              ReplayJournal(JournalPath(deck_path), header.generation,
+                            &folded, nullptr, &compact_error) &&
+              ReplaceDeckFile(folded, header.generation + 1, deck_path,
+                              &compact_error);
+    compacted = renamed;
+    if (renamed && truncate(JournalPath(deck_path).c_str(), 0) != 0) {
+      compact_error = JournalPath(deck_path) + ": " + strerror(errno);
+      compacted = false;
+    }
+    // The changes are safe in the journal either way; the next checkpoint
+    // tries again.
+    if (!compacted) {
+      fprintf(stderr, "Deck compaction failed: %s\n", compact_error.c_str());
+    }
+  }
+  lock->lock();
+
+  last_checkpoint_ = std::chrono::steady_clock::now();
+  // Once the new deck is in place, later records must carry its generation
+  // or the next replay would skip them, journal emptied or not.
+  if (renamed) generation_ = header.generation + 1;
+  if (ok) {
+    saved_changes_ = std::max(saved_changes_, changes);
+    if (compacted) {
+      journal_bytes_ = 0;
+      deck_bytes_ = FileSize(deck_path);
+    } else {
+      journal_bytes_ += records.size();
+    }
+  } else if (stopping_) {
+    // No later checkpoint to retry in.
+    fprintf(stderr, "Autosave failed at exit, %zu cards not saved: %s\n",
+            ids.size(), error.c_str());
+    last_error_ = error;
+    ++failed_checkpoints_;
+  } else {
+    // Keep the cards dirty so the next checkpoint retries them.
+    fprintf(stderr, "Autosave failed: %s\n", error.c_str());
+    if (dirty_ids_.empty()) dirty_since_ = last_checkpoint_;
+    dirty_ids_.insert(ids.begin(), ids.end());
+    last_error_ = error;
+    ++failed_checkpoints_;
+  }
+  events_.Publish(FS_EVENT_DECK_SAVE, ok ? 1 : -1, cards, 0);
+  checkpoint_done_.notify_all();
+}
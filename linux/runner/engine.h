@@ -0,0 +1,124 @@
+#ifndef FLUTTER_ENGINE_H_
+#define FLUTTER_ENGINE_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
+#include "card_store.h"
+#include "deck_migration.h"
+#include "event_ring.h"
+#include "search_index.h"
+#include "tag_facets.h"
+
+// How the engine's autosave thread batches changes into checkpoints.
+struct AutosaveOptions {
+  // Longest a change waits before it is written
+  // (FLASHSPRINT_AUTOSAVE_MS).
+  int interval_ms = 2000;
+  // Write sooner once this many cards are dirty
+  // (FLASHSPRINT_AUTOSAVE_CARDS)...
+  size_t max_dirty = 256;
+  // ...but never checkpoint more often than this.
+  int min_gap_ms = 250;
+  // Rewrite the deck and empty the journal once the journal outgrows
+  // max(compact_bytes, deck size / 4).
+  size_t compact_bytes = 8 << 20;
+
+  static AutosaveOptions FromEnvironment();
+};
+
+// The runner's card engine: one CardStore and the deck file that persists
+// it. It is shared by the method channel (platform thread) and the dart:ffi
+// entry points (Dart UI thread), so callers hold lock() around every use.
+//
+// Changes are not written by the caller. Mutations mark cards dirty and a
+// background thread checkpoints them: dirty cards are appended to the deck's
+// journal (deck_journal.h), and now and then the journal is folded into a
+// rewritten deck file and emptied. Opening a deck replays its journal.
+class Engine {
+ public:
+  enum class OpenResult { kOpened, kMigrated, kEmpty };
+
+  // The process-wide engine. Never destroyed.
+  static Engine* Instance();
+
+  std::mutex& lock() { return mutex_; }
+  CardStore* store() { return &store_; }
+  EventRing* events() { return &events_; }
+  bool is_open() const { return !deck_path_.empty(); }
+
+  // The full-text index over store(), rebuilt here on first use after the
+  // cards' text changed.
+  const SearchIndex& search_index();
+
+  // Tag counts for search results (tag_facets.h), rebuilt like
+  // search_index().
+  const TagFacets& tag_facets();
+
+  // Loads the deck at deck_path, migrating the Hive box at hive_path into it
+  // first if there is no deck yet. kEmpty means neither holds cards and no
+  // deck was opened; report, if not null, describes a migration.
+  bool Open(const std::string& hive_path, const std::string& deck_path,
+            OpenResult* result, MigrationReport* report, std::string* error);
+
+  // Applies a review to the card with this id as LeitnerSystem.reviewResult
+  // does: one more review, up a box when correct (capped at the last box),
+  // back to the first box otherwise. Returns false if there is no such card.
+  bool Review(int64_t id, bool correct, int64_t reviewed_epoch);
+
+  // Records that the card with this id was added, changed or removed, for
+  // the next checkpoint. Review marks its own cards.
+  void MarkDirty(int64_t id);
+
+  // Waits (releasing lock meanwhile) until every change made so far is on
+  // disk. Returns false if a checkpoint failed in the meantime.
+  bool Flush(std::unique_lock<std::mutex>* lock, std::string* error);
+
+  // Flushes and stops the autosave thread; called when the app quits. Takes
+  // the lock itself.
+  void Shutdown();
+
+  // Publishes FS_EVENT_BOX_COUNT for every box, e.g. after cards were added
+  // or removed. Review publishes its own.
+  void PublishBoxCounts();
+
+ private:
+  Engine() = default;
+
+  void PublishBoxCount(int box);
+  void AutosaveLoop();
+  void Checkpoint(std::unique_lock<std::mutex>* lock);
+
+  std::mutex mutex_;
+  CardStore store_;
+  EventRing events_{4096};
+  SearchIndex search_index_;
+  TagFacets tag_facets_;
+  std::string deck_path_;  // empty until Open succeeds
+
+  // Autosave state, guarded by mutex_.
+  AutosaveOptions options_ = AutosaveOptions::FromEnvironment();
+  std::thread autosave_thread_;
+  std::condition_variable autosave_wakeup_;
+  std::condition_variable checkpoint_done_;
+  std::unordered_set<int64_t> dirty_ids_;
+  std::chrono::steady_clock::time_point dirty_since_;
+  std::chrono::steady_clock::time_point last_checkpoint_;
+  uint64_t changes_ = 0;        // MarkDirty calls so far
+  uint64_t saved_changes_ = 0;  // of which on disk
+  uint64_t failed_checkpoints_ = 0;
+  std::string last_error_;
+  size_t flush_waiters_ = 0;
+  size_t journal_bytes_ = 0;
+  size_t deck_bytes_ = 0;
+  uint64_t generation_ = 0;  // of the deck file; stamped on journal records
+  bool stopping_ = false;
+};
+
+#endif  // FLUTTER_ENGINE_H_
@@ -0,0 +1,241 @@
+#include "engine_channel.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr char kChannelName[] = "flashsprint/engine";
+
+// Returns the string argument named key, or nullptr if it is missing.
+const gchar* StringArg(FlValue* args, const char* key) {
+  if (args == nullptr || fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
+    return nullptr;
+  }
+  FlValue* value = fl_value_lookup_string(args, key);
+  if (value == nullptr || fl_value_get_type(value) != FL_VALUE_TYPE_STRING) {
+    return nullptr;
+  }
+  return fl_value_get_string(value);
+}
+
+// Returns the integer argument named key, or false if it is missing.
+bool IntArg(FlValue* args, const char* key, int64_t* out) {
+  if (args == nullptr || fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
+    return false;
+  }
+  FlValue* value = fl_value_lookup_string(args, key);
+  if (value == nullptr || fl_value_get_type(value) != FL_VALUE_TYPE_INT) {
+    return false;
+  }
+  *out = fl_value_get_int(value);
+  return true;
+}
+
+FlMethodResponse* ErrorResponse(const char* code, const std::string& message) {
+  return FL_METHOD_RESPONSE(
+      fl_method_error_response_new(code, message.c_str(), nullptr));
+}
+
+}  // namespace
+
+EngineChannel::EngineChannel(FlBinaryMessenger* messenger) {
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  channel_ = fl_method_channel_new(messenger, kChannelName,
+                                   FL_METHOD_CODEC(codec));
+  fl_method_channel_set_method_call_handler(channel_, HandleMethodCall, this,
+                                            nullptr);
+}
+
+EngineChannel::~EngineChannel() {
+  fl_method_channel_set_method_call_handler(channel_, nullptr, nullptr,
+                                            nullptr);
+  g_clear_object(&channel_);
+}
+
+void EngineChannel::HandleMethodCall(FlMethodChannel* channel,
+                                     FlMethodCall* call, gpointer user_data) {
+  EngineChannel* self = static_cast<EngineChannel*>(user_data);
+  const gchar* method = fl_method_call_get_name(call);
+  FlValue* args = fl_method_call_get_args(call);
+
+  g_autoptr(FlMethodResponse) response = nullptr;
+  if (g_strcmp0(method, "openDeck") == 0) {
+    response = self->OpenDeck(args);
+  } else if (g_strcmp0(method, "putCard") == 0) {
+    response = self->PutCard(args);
+  } else if (g_strcmp0(method, "removeCard") == 0) {
+    response = self->RemoveCard(args);
+  } else if (g_strcmp0(method, "saveDeck") == 0) {
+    response = self->SaveDeck();
+  } else {
+    response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+  }
+
+  g_autoptr(GError) error = nullptr;
+  if (!fl_method_call_respond(call, response, &error)) {
+    g_warning("Failed to send %s response: %s", method, error->message);
+  }
+}
+
+FlMethodResponse* EngineChannel::OpenDeck(FlValue* args) {
+  const gchar* hive_path = StringArg(args, "hivePath");
+  const gchar* deck_path = StringArg(args, "deckPath");
+  if (hive_path == nullptr || deck_path == nullptr) {
+    return ErrorResponse("bad_args", "openDeck expects {hivePath, deckPath}");
+  }
+
+  std::unique_lock<std::mutex> lock(engine_->lock());
+  Engine::OpenResult result;
+  MigrationReport report;
+  std::string error;
+  // Reopening (e.g. after a hot restart) must not lose unsaved changes.
+  if (engine_->is_open() && !engine_->Flush(&lock, &error)) {
+    return ErrorResponse("save_failed", error);
+  }
+  if (!engine_->Open(hive_path, deck_path, &result, &report, &error)) {
+    return ErrorResponse("open_failed", error);
+  }
+  if (result == Engine::OpenResult::kEmpty) {
+    return FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+  }
+  if (result == Engine::OpenResult::kMigrated) {
+    g_message("Migrated %zu cards from %s to %s (parse %.0f ms, write %.0f ms)",
+              report.cards, hive_path, deck_path, report.parse_ms,
+              report.write_ms);
+  }
+  return ColumnsResponse(result == Engine::OpenResult::kMigrated);
+}
+
+FlMethodResponse* EngineChannel::PutCard(FlValue* args) {
+  CardRecord card = {};
+  int64_t review_count = 0;
+  int64_t box_number = 0;
+  const gchar* question = StringArg(args, "question");
+  const gchar* answer = StringArg(args, "answer");
+  FlValue* tags = args != nullptr && fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+                      ? fl_value_lookup_string(args, "tags")
+                      : nullptr;
+  if (!IntArg(args, "id", &card.id) || question == nullptr ||
+      answer == nullptr || tags == nullptr ||
+      fl_value_get_type(tags) != FL_VALUE_TYPE_LIST) {
+    return ErrorResponse("bad_args", "putCard expects a card map");
+  }
+  IntArg(args, "reviewCount", &review_count);
+  IntArg(args, "boxNumber", &box_number);
+  IntArg(args, "lastReviewedEpoch", &card.last_reviewed_epoch);
+  card.review_count = static_cast<int32_t>(review_count);
+  card.box_number = static_cast<int32_t>(box_number);
+
+  std::lock_guard<std::mutex> lock(engine_->lock());
+  CardStore* store = engine_->store();
+  std::vector<uint32_t> tag_ids;
+  for (size_t i = 0; i < fl_value_get_length(tags); i++) {
+    FlValue* tag = fl_value_get_list_value(tags, i);
+    if (fl_value_get_type(tag) != FL_VALUE_TYPE_STRING) continue;
+    const gchar* name = fl_value_get_string(tag);
+    tag_ids.push_back(store->InternTag(name, strlen(name)));
+  }
+  card.question_length = static_cast<uint32_t>(strlen(question));
+  card.question_offset = store->AppendString(question, card.question_length);
+  card.answer_length = static_cast<uint32_t>(strlen(answer));
+  card.answer_offset = store->AppendString(answer, card.answer_length);
+  store->AddCard(card, tag_ids.data(), tag_ids.size());
+  engine_->MarkDirty(card.id);
+  engine_->PublishBoxCounts();
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+}
+
+FlMethodResponse* EngineChannel::RemoveCard(FlValue* args) {
+  int64_t id = 0;
+  if (!IntArg(args, "id", &id)) {
+    return ErrorResponse("bad_args", "removeCard expects {id}");
+  }
+  std::lock_guard<std::mutex> lock(engine_->lock());
+  if (engine_->store()->RemoveCard(id)) {
+    engine_->MarkDirty(id);
+    engine_->PublishBoxCounts();
+  }
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+}
+
+FlMethodResponse* EngineChannel::SaveDeck() {
+  std::unique_lock<std::mutex> lock(engine_->lock());
+  std::string error;
+  if (!engine_->Flush(&lock, &error)) {
+    return ErrorResponse("save_failed", error);
+  }
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+}
+
+// Returns the store column by column so that Dart can rebuild its map
+// without decoding a JSON document or one message object per card:
+//
+//   count         number of cards
+//   migrated      true if this load moved the cards out of the Hive box
+//   ids, epochs   Int64List, one entry per card
+//   reviewCounts, boxNumbers
+//                 Int32List, one entry per card
+//   text          Uint8List, the UTF-8 string heap
+//   spans         Int32List, question offset/length, answer offset/length
+//   tagStarts     Int32List, count + 1 prefix offsets into tagRefs
+//   tagRefs       Int32List, tag ids
+//   tagNames      List<String>, indexed by tag id
+FlMethodResponse* EngineChannel::ColumnsResponse(bool migrated) {
+  const CardStore& store = *engine_->store();
+  const size_t count = store.size();
+  std::vector<int64_t> ids(count), epochs(count);
+  std::vector<int32_t> review_counts(count), box_numbers(count);
+  std::vector<int32_t> spans(count * 4), tag_starts(count + 1);
+  for (uint32_t slot = 0; slot < count; slot++) {
+    const CardRecord& card = store.card(slot);
+    ids[slot] = card.id;
+    epochs[slot] = card.last_reviewed_epoch;
+    review_counts[slot] = card.review_count;
+    box_numbers[slot] = card.box_number;
+    spans[slot * 4] = static_cast<int32_t>(card.question_offset);
+    spans[slot * 4 + 1] = static_cast<int32_t>(card.question_length);
+    spans[slot * 4 + 2] = static_cast<int32_t>(card.answer_offset);
+    spans[slot * 4 + 3] = static_cast<int32_t>(card.answer_length);
+    tag_starts[slot] = static_cast<int32_t>(card.tags_begin);
+  }
+  tag_starts[count] = static_cast<int32_t>(store.tag_refs().size());
+
+  g_autoptr(FlValue) tag_names = fl_value_new_list();
+  for (uint32_t tag = 0; tag < store.tag_count(); tag++) {
+    StrRef name = store.tag_name(tag);
+    fl_value_append_take(tag_names,
+                         fl_value_new_string_sized(name.data, name.size));
+  }
+  const std::vector<uint32_t>& tag_refs = store.tag_refs();
+
+  g_autoptr(FlValue) result = fl_value_new_map();
+  fl_value_set_string_take(result, "count", fl_value_new_int(count));
+  fl_value_set_string_take(result, "migrated", fl_value_new_bool(migrated));
+  fl_value_set_string_take(result, "ids",
+                           fl_value_new_int64_list(ids.data(), count));
+  fl_value_set_string_take(result, "epochs",
+                           fl_value_new_int64_list(epochs.data(), count));
+  fl_value_set_string_take(
+      result, "reviewCounts",
+      fl_value_new_int32_list(review_counts.data(), count));
+  fl_value_set_string_take(result, "boxNumbers",
+                           fl_value_new_int32_list(box_numbers.data(), count));
+  fl_value_set_string_take(
+      result, "text",
+      fl_value_new_uint8_list(
+          reinterpret_cast<const uint8_t*>(store.string_data()),
+          store.string_bytes()));
+  fl_value_set_string_take(result, "spans",
+                           fl_value_new_int32_list(spans.data(), spans.size()));
+  fl_value_set_string_take(
+      result, "tagStarts",
+      fl_value_new_int32_list(tag_starts.data(), tag_starts.size()));
+  fl_value_set_string_take(
+      result, "tagRefs",
+      fl_value_new_int32_list(reinterpret_cast<const int32_t*>(tag_refs.data()),
+                              tag_refs.size()));
+  fl_value_set_string(result, "tagNames", tag_names);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
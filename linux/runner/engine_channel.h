@@ -0,0 +1,42 @@
+#ifndef FLUTTER_ENGINE_CHANNEL_H_
+#define FLUTTER_ENGINE_CHANNEL_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+#include "engine.h"
+
+// Native side of the "flashsprint/engine" method channel: answers the Dart
+// LeitnerSystem's calls against the process-wide Engine.
+//
+//   openDeck {hivePath, deckPath}
+//                    Loads the deck at deckPath, first migrating the cards
+//                    out of the Hive box at hivePath if there is no deck yet.
+//                    Returns the cards as columns (see ColumnsResponse), or
+//                    null when neither holds any cards.
+//   putCard {id, question, answer, tags, reviewCount, boxNumber,
+//            lastReviewedEpoch}
+//                    Adds or replaces a card; autosave writes it shortly.
+//   removeCard {id}  Removes a card; autosave writes it shortly.
+//   saveDeck         Returns once every change so far is on disk.
+class EngineChannel {
+ public:
+  explicit EngineChannel(FlBinaryMessenger* messenger);
+  ~EngineChannel();
+  EngineChannel(const EngineChannel&) = delete;
+  EngineChannel& operator=(const EngineChannel&) = delete;
+
+ private:
+  static void HandleMethodCall(FlMethodChannel* channel, FlMethodCall* call,
+                               gpointer user_data);
+
+  FlMethodResponse* OpenDeck(FlValue* args);
+  FlMethodResponse* PutCard(FlValue* args);
+  FlMethodResponse* RemoveCard(FlValue* args);
+  FlMethodResponse* ColumnsResponse(bool migrated);  // engine lock held
+  FlMethodResponse* SaveDeck();
+
+  FlMethodChannel* channel_ = nullptr;
+  Engine* engine_ = Engine::Instance();
+};
+
+#endif  // FLUTTER_ENGINE_CHANNEL_H_
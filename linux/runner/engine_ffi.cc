@@ -0,0 +1,390 @@
+#include "engine_ffi.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+#include <vector>
+
+#include "engine.h"
+
+namespace {
+
+static_assert(sizeof(FsCardView) == 64, "FsCardView layout is part of the ABI");
+static_assert(sizeof(FsReview) == 24, "FsReview layout is part of the ABI");
+static_assert(sizeof(FsReviewResult) == 16,
+              "FsReviewResult layout is part of the ABI");
+static_assert(sizeof(FsEvent) == 32, "FsEvent layout is part of the ABI");
+static_assert(sizeof(FsSearchHit) == 56,
+              "FsSearchHit layout is part of the ABI");
+static_assert(sizeof(FsFacet) == 8, "FsFacet layout is part of the ABI");
+static_assert(sizeof(FsTextBuffer) == 24,
+              "FsTextBuffer layout is part of the ABI");
+
+void ResetText(FsTextBuffer* text) {
+  text->used = 0;
+  text->written = 0;
+  text->full = 0;
+}
+
+// Claims size bytes of the caller's buffer at the given alignment, or
+// marks it full and returns null if they do not fit.
+char* ClaimText(FsTextBuffer* text, size_t size, size_t align) {
+  const size_t begin = (text->used + align - 1) & ~(align - 1);
+  if (begin > text->capacity || size > text->capacity - begin) {
+    text->full = 1;
+    return nullptr;
+  }
+  text->used = static_cast<uint32_t>(begin + size);
+  return text->data + begin;
+}
+
+// Copies the card's text and tags into text and points view at them; false
+// (text unchanged) if they do not fit.
+bool FillView(const CardStore& store, uint32_t slot, FsCardView* view,
+              FsTextBuffer* text) {
+  const CardRecord& card = store.card(slot);
+  StrRef question = store.question(slot);
+  StrRef answer = store.answer(slot);
+  const size_t tag_bytes = card.tag_count * sizeof(uint32_t);
+  const uint32_t mark = text->used;
+  char* tags = ClaimText(text, tag_bytes, alignof(uint32_t));
+  char* chars = tags ? ClaimText(text, question.size + answer.size, 1) : nullptr;
+  if (!chars) {
+    text->used = mark;
+    return false;
+  }
+  if (tag_bytes) memcpy(tags, store.tag_refs().data() + card.tags_begin, tag_bytes);
+  if (question.size) memcpy(chars, question.data, question.size);
+  if (answer.size) memcpy(chars + question.size, answer.data, answer.size);
+  view->id = card.id;
+  view->last_reviewed_epoch = card.last_reviewed_epoch;
+  view->question = chars;
+  view->answer = chars + question.size;
+  view->tag_ids = reinterpret_cast<const uint32_t*>(tags);
+  view->question_length = card.question_length;
+  view->answer_length = card.answer_length;
+  view->tag_count = card.tag_count;
+  view->review_count = card.review_count;
+  view->box_number = card.box_number;
+  view->reserved = 0;
+  text->written++;
+  return true;
+}
+
+bool EqualsIgnoreAsciiCase(const char* a, const char* b, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    unsigned char x = static_cast<unsigned char>(a[i]);
+    unsigned char y = static_cast<unsigned char>(b[i]);
+    if (x >= 'A' && x <= 'Z') x += 'a' - 'A';
+    if (y >= 'A' && y <= 'Z') y += 'a' - 'A';
+    if (x != y) return false;
+  }
+  return true;
+}
+
+// UTF-16 code units in bytes [begin, end) of valid UTF-8.
+uint32_t Utf16Units(const char* text, size_t begin, size_t end) {
+  uint32_t units = 0;
+  for (size_t i = begin; i < end; ++i) {
+    unsigned char c = static_cast<unsigned char>(text[i]);
+    if ((c & 0xc0) != 0x80) ++units;  // a code point starts here
+    if (c >= 0xf0) ++units;           // outside the BMP: a surrogate pair
+  }
+  return units;
+}
+
+// Cuts the snippet of one field and writes the highlights inside it.
+// Returns how many were written.
+uint16_t WriteSnippet(StrRef text, const SearchMatch* matches, size_t count,
+                      size_t snippet_bytes, const char** snippet_text,
+                      uint32_t* snippet_length, uint32_t* flags,
+                      uint32_t head_flag, uint32_t tail_flag,
+                      FsHighlight* highlights, size_t capacity) {
+  Snippet snippet = SearchIndex::Cut(text, matches, count, snippet_bytes);
+  *snippet_text = text.data + snippet.begin;
+  *snippet_length = snippet.length;
+  if (snippet.clipped_head) *flags |= head_flag;
+  if (snippet.clipped_tail) *flags |= tail_flag;
+
+  const size_t end = snippet.begin + snippet.length;
+  size_t position = snippet.begin;  // scanned up to here...
+  uint32_t units = 0;               // ...which is this far into the snippet
+  uint16_t written = 0;
+  for (size_t i = 0; i < count && written < capacity && written < 0xffff;
+       ++i) {
+    const SearchMatch& m = matches[i];
+    if (m.offset < position || m.offset + m.length > end) continue;
+    units += Utf16Units(text.data, position, m.offset);
+    const uint32_t length =
+        Utf16Units(text.data, m.offset, m.offset + m.length);
+    highlights[written++] = {units, length};
+    units += length;
+    position = m.offset + m.length;
+  }
+  return written;
+}
+
+}  // namespace
+
+int32_t fs_engine_abi_version(void) { return FS_ENGINE_ABI_VERSION; }
+
+int32_t fs_engine_next_cards(int32_t skip, FsCardView* out, int32_t capacity,
+                             FsTextBuffer* text) {
+  ResetText(text);
+  Engine* engine = Engine::Instance();
+  std::lock_guard<std::mutex> lock(engine->lock());
+  if (!engine->is_open()) return -1;
+  const CardStore& store = *engine->store();
+
+  int32_t written = 0;
+  size_t to_skip = skip > 0 ? static_cast<size_t>(skip) : 0;
+  for (int b = 0; b < CardStore::kBoxCount && written < capacity; ++b) {
+    const BoxQueue box = store.box(b);
+    if (to_skip >= box.size()) {
+      to_skip -= box.size();
+      continue;
+    }
+    for (auto it = std::next(box.begin(), to_skip);
+         it != box.end() && written < capacity; ++it) {
+      if (!FillView(store, *it, &out[written], text)) return written;
+      ++written;
+    }
+    to_skip = 0;
+  }
+  return written;
+}
+
+int32_t fs_engine_review(const FsReview* reviews, FsReviewResult* results,
+                         int32_t count) {
+  Engine* engine = Engine::Instance();
+  std::lock_guard<std::mutex> lock(engine->lock());
+  if (!engine->is_open()) return -1;
+  const CardStore& store = *engine->store();
+
+  int32_t applied = 0;
+  for (int32_t i = 0; i < count; ++i) {
+    const FsReview& review = reviews[i];
+    FsReviewResult& result = results[i];
+    result.id = review.id;
+    if (!engine->Review(review.id, review.correct != 0,
+                        review.reviewed_epoch)) {
+      result.box_number = -1;
+      result.review_count = 0;
+      continue;
+    }
+    const CardRecord& card = store.card(store.FindSlot(review.id));
+    result.box_number = card.box_number;
+    result.review_count = card.review_count;
+    ++applied;
+  }
+  return applied;
+}
+
+int32_t fs_engine_search_tag(const char* tag, int32_t tag_length,
+                             int32_t skip, FsCardView* out, int32_t capacity,
+                             FsTextBuffer* text) {
+  ResetText(text);
+  Engine* engine = Engine::Instance();
+  std::lock_guard<std::mutex> lock(engine->lock());
+  if (!engine->is_open() || tag_length < 0) return -1;
+  const CardStore& store = *engine->store();
+
+  // Tag ids differ by case ("Graph", "graph"), so gather every spelling.
+  std::vector<uint32_t> slots;
+  for (uint32_t t = 0; t < store.tag_count(); ++t) {
+    StrRef name = store.tag_name(t);
+    if (name.size == static_cast<size_t>(tag_length) &&
+        EqualsIgnoreAsciiCase(name.data, tag, name.size)) {
+      const auto& postings = store.tag_postings(t);
+      slots.insert(slots.end(), postings.begin(), postings.end());
+    }
+  }
+  std::sort(slots.begin(), slots.end());
+  slots.erase(std::unique(slots.begin(), slots.end()), slots.end());
+
+  for (size_t i = std::max(skip, 0); i < slots.size() && text->written < capacity;
+       ++i) {
+    if (!FillView(store, slots[i], &out[text->written], text)) break;
+  }
+  return static_cast<int32_t>(slots.size());
+}
+
+int32_t fs_engine_find_range(int32_t field, int64_t lo, int64_t hi,
+                             int32_t skip, FsCardView* out,
+                             int32_t capacity, FsTextBuffer* text) {
+  ResetText(text);
+  Engine* engine = Engine::Instance();
+  std::lock_guard<std::mutex> lock(engine->lock());
+  if (!engine->is_open()) return -1;
+  CardStore* store = engine->store();
+  const size_t first = static_cast<size_t>(std::max(skip, 0));
+  const size_t room = static_cast<size_t>(std::max(capacity, 0));
+  std::vector<uint32_t> slots;
+  size_t total = 0;
+  if (field == FS_RANGE_INTERVAL) {
+    // The interval follows from the box, so the box queues are the index.
+    for (int b = 0; b < CardStore::kBoxCount; ++b) {
+      const int64_t days = CardStore::IntervalDays(b);
+      if (days < lo || days > hi) continue;
+      const BoxQueue box = store->box(b);
+      const size_t skip_here = first > total ? first - total : 0;
+      if (skip_here < box.size()) {
+        for (auto it = std::next(box.begin(), skip_here);
+             it != box.end() && slots.size() < room; ++it) {
+          slots.push_back(*it);
+        }
+      }
+      total += box.size();
+    }
+  } else if (field == FS_RANGE_REVIEW_COUNT || field == FS_RANGE_LAST_REVIEWED ||
+             field == FS_RANGE_DUE) {
+    const auto key = field == FS_RANGE_REVIEW_COUNT ? CardStore::kReviewCount
+                     : field == FS_RANGE_LAST_REVIEWED ? CardStore::kLastReviewed
+                                                       : CardStore::kDueEpoch;
+    const RangeIndex& index = store->range_index(key);
+    index.Scan(lo, hi, first, room, &slots);
+    total = index.Count(lo, hi);
+  } else {
+    return -1;
+  }
+  for (size_t i = 0; i < slots.size(); ++i) {
+    if (!FillView(*store, slots[i], &out[i], text)) break;
+  }
+  return static_cast<int32_t>(total);
+}
+
+int32_t fs_engine_search(const char* query, int32_t query_length,
+                         int32_t skip, int32_t snippet_bytes,
+                         FsSearchHit* out, int32_t capacity,
+                         FsHighlight* highlights,
+                         int32_t highlight_capacity, FsTextBuffer* text) {
+  ResetText(text);
+  Engine* engine = Engine::Instance();
+  std::lock_guard<std::mutex> lock(engine->lock());
+  if (!engine->is_open() || query_length < 0 || snippet_bytes <= 0) return -1;
+  const CardStore& store = *engine->store();
+  const SearchIndex& index = engine->search_index();
+
+  SearchIndex::Query parsed;
+  if (!index.Parse(query, static_cast<size_t>(query_length), &parsed)) {
+    return 0;
+  }
+  std::vector<uint32_t> slots;
+  index.Search(parsed, &slots);
+
+  std::vector<SearchMatch> matches;
+  size_t used = 0;
+  const size_t highlight_room =
+      highlight_capacity > 0 ? static_cast<size_t>(highlight_capacity) : 0;
+  for (size_t i = std::max(skip, 0);
+       i < slots.size() && text->written < capacity; ++i) {
+    const uint32_t slot = slots[i];
+    index.Matches(parsed, slot, &matches);
+    // Matches are ordered by field: question, answer, then tags.
+    auto answer = std::find_if(matches.begin(), matches.end(),
+                               [](const SearchMatch& m) {
+                                 return m.field != SearchIndex::kQuestion;
+                               });
+    auto tags = std::find_if(answer, matches.end(), [](const SearchMatch& m) {
+      return m.field == SearchIndex::kTag;
+    });
+
+    FsSearchHit& hit = out[text->written];
+    memset(&hit, 0, sizeof(hit));
+    hit.id = store.card(slot).id;
+    hit.highlight_begin = static_cast<uint32_t>(used);
+    hit.question_highlights = WriteSnippet(
+        store.question(slot), matches.data(), answer - matches.begin(),
+        snippet_bytes, &hit.question, &hit.question_length, &hit.flags,
+        FS_SNIPPET_QUESTION_HEAD, FS_SNIPPET_QUESTION_TAIL, highlights + used,
+        highlight_room - used);
+    used += hit.question_highlights;
+    hit.answer_highlights = WriteSnippet(
+        store.answer(slot), matches.data() + (answer - matches.begin()),
+        tags - answer, snippet_bytes,
+        &hit.answer, &hit.answer_length, &hit.flags, FS_SNIPPET_ANSWER_HEAD,
+        FS_SNIPPET_ANSWER_TAIL, highlights + used, highlight_room - used);
+    used += hit.answer_highlights;
+    // The snippets still point into the card text; move them into the
+    // caller's buffer, or end the page here if they do not fit.
+    char* copy = ClaimText(text, hit.question_length + hit.answer_length, 1);
+    if (!copy) break;
+    if (hit.question_length) memcpy(copy, hit.question, hit.question_length);
+    if (hit.answer_length) {
+      memcpy(copy + hit.question_length, hit.answer, hit.answer_length);
+    }
+    hit.question = copy;
+    hit.answer = copy + hit.question_length;
+    for (auto it = tags; it != matches.end(); ++it) {
+      if (it->tag < 64) hit.tag_mask |= uint64_t{1} << it->tag;
+    }
+    text->written++;
+  }
+  return static_cast<int32_t>(slots.size());
+}
+
+int32_t fs_engine_search_facets(const char* query, int32_t query_length,
+                                FsFacet* out, int32_t capacity) {
+  Engine* engine = Engine::Instance();
+  std::lock_guard<std::mutex> lock(engine->lock());
+  if (!engine->is_open() || query_length < 0) return -1;
+  if (capacity <= 0) return 0;
+  const CardStore& store = *engine->store();
+  const SearchIndex& index = engine->search_index();
+
+  SearchIndex::Query parsed;
+  if (!index.Parse(query, static_cast<size_t>(query_length), &parsed)) {
+    return 0;
+  }
+  std::vector<uint32_t> slots;
+  index.Search(parsed, &slots);
+  std::vector<TagFacets::Facet> facets;
+  engine->tag_facets().Count(store, slots, static_cast<size_t>(capacity),
+                             &facets);
+  for (size_t i = 0; i < facets.size(); ++i) {
+    out[i].tag = facets[i].tag;
+    out[i].count = facets[i].count;
+  }
+  return static_cast<int32_t>(facets.size());
+}
+
+void fs_engine_stats(FsStats* out) {
+  Engine* engine = Engine::Instance();
+  std::lock_guard<std::mutex> lock(engine->lock());
+  memset(out, 0, sizeof(*out));
+  if (!engine->is_open()) return;
+  const CardStore& store = *engine->store();
+  out->card_count = static_cast<int64_t>(store.size());
+  out->tag_count = static_cast<int64_t>(store.tag_count());
+  out->string_bytes = static_cast<int64_t>(store.string_bytes());
+  for (int b = 0; b < CardStore::kBoxCount; ++b) {
+    out->box_counts[b] = static_cast<int64_t>(store.box(b).size());
+  }
+}
+
+int32_t fs_engine_tag_name(uint32_t tag, char* out, int32_t capacity) {
+  Engine* engine = Engine::Instance();
+  std::lock_guard<std::mutex> lock(engine->lock());
+  const CardStore& store = *engine->store();
+  if (tag >= store.tag_count()) return -1;
+  StrRef name = store.tag_name(tag);
+  const size_t room = capacity > 0 ? static_cast<size_t>(capacity) : 0;
+  if (name.size && room) memcpy(out, name.data, std::min(name.size, room));
+  return static_cast<int32_t>(name.size);
+}
+
+int32_t fs_events_poll(FsEvent* out, int32_t capacity) {
+  if (capacity <= 0) return 0;
+  return static_cast<int32_t>(
+      Engine::Instance()->events()->Poll(out, static_cast<size_t>(capacity)));
+}
+
+int64_t fs_events_wait(int64_t seen, int32_t timeout_ms) {
+  return static_cast<int64_t>(Engine::Instance()->events()->Wait(
+      static_cast<uint64_t>(seen), timeout_ms));
+}
+
+int64_t fs_events_dropped(void) {
+  return static_cast<int64_t>(Engine::Instance()->events()->dropped());
+}
@@ -0,0 +1,218 @@
+#ifndef FLUTTER_ENGINE_FFI_H_
+#define FLUTTER_ENGINE_FFI_H_
+
+// Plain C ABI over the runner's Engine for dart:ffi (see
+// lib/native_engine.dart), exported from the executable so Dart can bind it
+// with DynamicLibrary.executable(). Unlike the method channel these calls run
+// synchronously on the calling (Dart UI) thread with no codec in between.
+//
+// Results are written into caller-owned struct arrays. Card text, snippets
+// and tag lists are copied, under the engine lock, into a caller-owned
+// FsTextBuffer that the views then point into: the channel changes cards on
+// the platform thread at any time, so nothing handed out may point into the
+// engine's own storage.
+//
+// Every function returns a negative value, or zeroes its output, while no
+// deck is open.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FS_ENGINE_EXPORT __attribute__((visibility("default"), used))
+
+#define FS_ENGINE_ABI_VERSION 6
+#define FS_ENGINE_BOX_COUNT 5
+
+// Storage for the text of one call's results. The call sets used, written
+// and full, and stops before a view whose text would not fit, so written may
+// be less than the views asked for (0 with full set: retry with a larger
+// buffer). data must be 4-byte aligned; tag ids go there too.
+typedef struct {
+  char* data;
+  uint32_t capacity;  // bytes
+  uint32_t used;      // bytes filled by the call
+  int32_t written;    // views or hits written by the call
+  int32_t full;       // nonzero if the call stopped for lack of room
+} FsTextBuffer;
+
+typedef struct {
+  int64_t id;
+  int64_t last_reviewed_epoch;
+  const char* question;  // UTF-8 in the FsTextBuffer, not NUL-terminated
+  const char* answer;
+  const uint32_t* tag_ids;  // see fs_engine_tag_name
+  uint32_t question_length;
+  uint32_t answer_length;
+  uint32_t tag_count;
+  int32_t review_count;
+  int32_t box_number;
+  int32_t reserved;
+} FsCardView;
+
+typedef struct {
+  int64_t id;
+  int64_t reviewed_epoch;  // seconds since the Unix epoch, UTC
+  int32_t correct;         // nonzero if answered correctly
+  int32_t reserved;
+} FsReview;
+
+typedef struct {
+  int64_t id;
+  int32_t box_number;  // -1: no card with this id
+  int32_t review_count;
+} FsReviewResult;
+
+typedef struct {
+  int64_t card_count;
+  int64_t tag_count;
+  int64_t string_bytes;
+  int64_t box_counts[FS_ENGINE_BOX_COUNT];
+} FsStats;
+
+// A highlighted match inside a search snippet, in UTF-16 code units from the
+// start of the snippet, so Dart can slice the decoded String directly.
+typedef struct {
+  uint32_t offset;
+  uint32_t length;
+} FsHighlight;
+
+// One search result: an excerpt of the question and of the answer cut
+// around the first match in each, and where the matches are.
+typedef struct {
+  int64_t id;
+  const char* question;  // snippet: UTF-8 in the FsTextBuffer
+  const char* answer;
+  uint32_t question_length;  // snippet bytes
+  uint32_t answer_length;
+  // This hit's highlights are highlights[highlight_begin, +question_highlights)
+  // for the question snippet, followed by answer_highlights for the answer.
+  uint32_t highlight_begin;
+  uint16_t question_highlights;
+  uint16_t answer_highlights;
+  uint32_t flags;     // FS_SNIPPET_*
+  uint32_t reserved;
+  uint64_t tag_mask;  // bit i: the card's i-th tag matched (first 64 tags)
+} FsSearchHit;
+
+// A tag and how many cards of a result set carry it.
+typedef struct {
+  uint32_t tag;  // see fs_engine_tag_name
+  uint32_t count;
+} FsFacet;
+
+// The snippet leaves out text before / after it.
+#define FS_SNIPPET_QUESTION_HEAD 1
+#define FS_SNIPPET_QUESTION_TAIL 2
+#define FS_SNIPPET_ANSWER_HEAD 4
+#define FS_SNIPPET_ANSWER_TAIL 8
+
+// Fields for fs_engine_find_range.
+#define FS_RANGE_REVIEW_COUNT 0
+#define FS_RANGE_LAST_REVIEWED 1  // seconds since the Unix epoch, UTC
+#define FS_RANGE_DUE 2            // last review + the box's interval, same;
+                                  // cards never reviewed have no due date
+#define FS_RANGE_INTERVAL 3       // days, from the box (1, 1, 2, 4, 8)
+
+// Live updates published by the engine (see fs_events_poll).
+typedef struct {
+  int64_t seq;  // position in the stream of published events
+  int32_t kind;  // FS_EVENT_*
+  int32_t arg0;
+  int64_t arg1;
+  int64_t arg2;
+} FsEvent;
+
+// A box's card count changed: arg0 = box number, arg1 = cards in it.
+#define FS_EVENT_BOX_COUNT 1
+// Deck save progress: arg0 = 0 started / 1 done / -1 failed, arg1 = cards.
+#define FS_EVENT_DECK_SAVE 2
+
+// Returns FS_ENGINE_ABI_VERSION; Dart checks it before binding the rest.
+FS_ENGINE_EXPORT int32_t fs_engine_abi_version(void);
+
+// Fills out with up to capacity cards in review order (box 1 first, each box
+// in queue order), skipping the first skip. Returns the number written.
+FS_ENGINE_EXPORT int32_t fs_engine_next_cards(int32_t skip, FsCardView* out,
+                                              int32_t capacity,
+                                              FsTextBuffer* text);
+
+// Applies count reviews in order and writes one result per review. Returns
+// the number of reviews applied to existing cards, which the engine's
+// autosave thread then writes out.
+FS_ENGINE_EXPORT int32_t fs_engine_review(const FsReview* reviews,
+                                          FsReviewResult* results,
+                                          int32_t count);
+
+// Cards carrying tag (UTF-8, compared ASCII case-insensitively), in deck
+// order. Writes up to capacity views, skipping the first skip matches, and
+// returns the total number of matches; text->written says how many views.
+FS_ENGINE_EXPORT int32_t fs_engine_search_tag(const char* tag,
+                                              int32_t tag_length,
+                                              int32_t skip, FsCardView* out,
+                                              int32_t capacity,
+                                              FsTextBuffer* text);
+
+// Cards whose field (FS_RANGE_*) lies in [lo, hi], in field order (ties by
+// slot). Writes up to capacity views after the first skip and returns the
+// total number of matches, or -1 for an unknown field; text->written says
+// how many views. Served from range indexes kept up to date on every
+// review, so the cost is O(log n + the cards written).
+FS_ENGINE_EXPORT int32_t fs_engine_find_range(int32_t field, int64_t lo,
+                                              int64_t hi, int32_t skip,
+                                              FsCardView* out,
+                                              int32_t capacity,
+                                              FsTextBuffer* text);
+
+// Full-text search over questions, answers and tag names (see
+// search_index.h): cards containing every word of query, the last word also
+// matching as a prefix, in deck order. Writes up to capacity hits after the
+// first skip, cutting snippets of at most snippet_bytes, and their
+// highlights into highlights until highlight_capacity is used up (later
+// hits then report fewer highlights). Returns the total number of matches;
+// text->written says how many hits, whose snippets are copied into text.
+// The index is rebuilt by the first search after cards change.
+FS_ENGINE_EXPORT int32_t fs_engine_search(const char* query,
+                                          int32_t query_length, int32_t skip,
+                                          int32_t snippet_bytes,
+                                          FsSearchHit* out, int32_t capacity,
+                                          FsHighlight* highlights,
+                                          int32_t highlight_capacity,
+                                          FsTextBuffer* text);
+
+// Facets of the fs_engine_search result set for query: the (up to)
+// capacity tags carried by most of the matching cards, most common first
+// (ties by tag id). Returns the number written.
+FS_ENGINE_EXPORT int32_t fs_engine_search_facets(const char* query,
+                                                 int32_t query_length,
+                                                 FsFacet* out,
+                                                 int32_t capacity);
+
+FS_ENGINE_EXPORT void fs_engine_stats(FsStats* out);
+
+// Copies the name of a tag id from FsCardView.tag_ids into out, up to
+// capacity bytes, and returns its full length (retry with more room if that
+// is larger), or -1 if the id is out of range.
+FS_ENGINE_EXPORT int32_t fs_engine_tag_name(uint32_t tag, char* out,
+                                            int32_t capacity);
+
+// Event ring consumer side. Poll and wait may run on different threads, but
+// each on only one at a time.
+//
+// Copies up to capacity pending events into out and returns the count.
+FS_ENGINE_EXPORT int32_t fs_events_poll(FsEvent* out, int32_t capacity);
+
+// Blocks until the total number of events published exceeds seen, or for
+// timeout_ms (-1: forever). Returns the total published so far.
+FS_ENGINE_EXPORT int64_t fs_events_wait(int64_t seen, int32_t timeout_ms);
+
+// Number of events dropped because the ring was full.
+FS_ENGINE_EXPORT int64_t fs_events_dropped(void);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // FLUTTER_ENGINE_FFI_H_
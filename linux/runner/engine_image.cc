@@ -0,0 +1,304 @@
+#include "engine_image.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "deck_file.h"
+#include "hive_box_reader.h"
+
+namespace {
+
+constexpr char kMagic[8] = "FSIMG1";
+constexpr uint32_t kVersion = 1;
+// Changes whenever a record the image copies verbatim changes shape.
+constexpr uint32_t kLayout =
+    static_cast<uint32_t>(sizeof(CardRecord)) | CardStore::kBoxCount << 16;
+
+struct EngineImageHeader {
+  char magic[8];  // "FSIMG1"
+  uint32_t version;
+  uint32_t layout;
+
+  // The deck and journal this image was taken from.
+  uint64_t deck_size;
+  uint64_t deck_mtime_ns;
+  uint64_t deck_inode;
+  uint64_t journal_size;
+  uint64_t journal_mtime_ns;
+  uint32_t deck_payload_crc;
+  uint32_t deck_digest;
+
+  // Element counts of each array, in payload order.
+  uint64_t card_count;
+  uint64_t string_bytes;
+  uint64_t tag_ref_count;
+  uint64_t tag_count;
+  uint64_t tag_table_size;
+  uint64_t posting_count;
+  uint64_t id_table_size;
+  uint64_t box_sizes[CardStore::kBoxCount];
+
+  uint32_t payload_crc;
+  uint32_t header_size;
+};
+
+static_assert(sizeof(EngineImageHeader) == 168, "image header layout");
+
+std::string ErrnoMessage(const std::string& path) {
+  return path + ": " + strerror(errno);
+}
+
+uint64_t MtimeNs(const struct stat& st) {
+  return static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000ull +
+         static_cast<uint64_t>(st.st_mtim.tv_nsec);
+}
+
+// Fills the deck identity fields of header from the files as they are now.
+bool StatSource(const std::string& deck_path, EngineImageHeader* header,
+                std::string* error) {
+  int fd = open(deck_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    *error = ErrnoMessage(deck_path);
+    return false;
+  }
+  struct stat st;
+  DeckFileHeader deck;
+  bool ok = fstat(fd, &st) == 0 &&
+            pread(fd, &deck, sizeof(deck), 0) == sizeof(deck);
+  close(fd);
+  if (!ok) {
+    *error = deck_path + ": cannot read the deck header";
+    return false;
+  }
+  header->deck_size = static_cast<uint64_t>(st.st_size);
+  header->deck_mtime_ns = MtimeNs(st);
+  header->deck_inode = static_cast<uint64_t>(st.st_ino);
+  header->deck_payload_crc = deck.payload_crc;
+  header->deck_digest = deck.digest;
+
+  // No journal and an empty one are the same state.
+  header->journal_size = 0;
+  header->journal_mtime_ns = 0;
+  if (stat((deck_path + ".journal").c_str(), &st) == 0 && st.st_size > 0) {
+    header->journal_size = static_cast<uint64_t>(st.st_size);
+    header->journal_mtime_ns = MtimeNs(st);
+  }
+  return true;
+}
+
+class ImageWriter {
+ public:
+  explicit ImageWriter(int fd) : fd_(fd) {}
+
+  template <typename T>
+  bool Write(const T* data, size_t count) {
+    const char* p = reinterpret_cast<const char*>(data);
+    size_t size = count * sizeof(T);
+    crc_ = HiveCrc32(reinterpret_cast<const uint8_t*>(p), size, crc_);
+    while (size > 0) {
+      ssize_t n = write(fd_, p, size);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) return false;
+      p += n;
+      size -= static_cast<size_t>(n);
+    }
+    return true;
+  }
+
+  uint32_t crc() const { return crc_; }
+
+ private:
+  int fd_;
+  uint32_t crc_ = 0;
+};
+
+// Sequential reader over the mapped payload.
+class ImageReader {
+ public:
+  ImageReader(const uint8_t* data, size_t size) : p_(data), end_(data + size) {}
+
+  // Copies the next count elements into out; arrays in the payload are not
+  // necessarily aligned.
+  template <typename T>
+  bool Read(uint64_t count, std::vector<T>* out) {
+    if (count > static_cast<uint64_t>(end_ - p_) / sizeof(T)) return false;
+    out->resize(count);
+    if (count > 0) memcpy(out->data(), p_, count * sizeof(T));
+    p_ += count * sizeof(T);
+    return true;
+  }
+
+  bool done() const { return p_ == end_; }
+
+ private:
+  const uint8_t* p_;
+  const uint8_t* end_;
+};
+
+bool IsPowerOfTwoOrZero(uint64_t n) { return (n & (n - 1)) == 0; }
+
+}  // namespace
+
+bool EngineImage::Save(const CardStore& store, const std::string& deck_path,
+                       const std::string& image_path, std::string* error) {
+  EngineImageHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, kMagic, sizeof(h.magic));
+  h.version = kVersion;
+  h.layout = kLayout;
+  h.header_size = sizeof(h);
+  if (!StatSource(deck_path, &h, error)) return false;
+
+  h.card_count = store.cards_.size();
+  h.string_bytes = store.strings_.size();
+  h.tag_ref_count = store.tag_refs_.size();
+  h.tag_count = store.tag_offsets_.size();
+  h.tag_table_size = store.tag_table_.size();
+  std::vector<uint32_t> posting_sizes;
+  posting_sizes.reserve(store.tag_postings_.size());
+  for (const auto& postings : store.tag_postings_) {
+    posting_sizes.push_back(static_cast<uint32_t>(postings.size()));
+    h.posting_count += postings.size();
+  }
+  h.id_table_size = store.id_table_.size();
+  for (int box = 0; box < CardStore::kBoxCount; ++box) {
+    h.box_sizes[box] = store.box(box).size();
+  }
+
+  // Not fsynced: losing the image to a crash only costs a slower start,
+  // and a torn one fails its checksum.
+  const std::string temp = image_path + ".tmp";
+  int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    *error = ErrnoMessage(temp);
+    return false;
+  }
+  ImageWriter out(fd);
+  bool ok = lseek(fd, sizeof(h), SEEK_SET) == sizeof(h) &&
+            out.Write(store.cards_.data(), store.cards_.size()) &&
+            out.Write(store.strings_.data(), store.strings_.size()) &&
+            out.Write(store.tag_refs_.data(), store.tag_refs_.size()) &&
+            out.Write(store.tag_offsets_.data(), store.tag_offsets_.size()) &&
+            out.Write(store.tag_lengths_.data(), store.tag_lengths_.size()) &&
+            out.Write(store.tag_table_.data(), store.tag_table_.size()) &&
+            out.Write(posting_sizes.data(), posting_sizes.size());
+  for (const auto& postings : store.tag_postings_) {
+    ok = ok && out.Write(postings.data(), postings.size());
+  }
+  ok = ok && out.Write(store.id_table_.data(), store.id_table_.size());
+  for (int box = 0; box < CardStore::kBoxCount; ++box) {
+    // Boxes are linked through the slots; write each out in queue order.
+    const BoxQueue queue = store.box(box);
+    std::vector<uint32_t> slots(queue.begin(), queue.end());
+    ok = ok && out.Write(slots.data(), slots.size());
+  }
+  h.payload_crc = out.crc();
+  ok = ok && pwrite(fd, &h, sizeof(h), 0) == sizeof(h);
+  if (close(fd) != 0) ok = false;
+  if (!ok || rename(temp.c_str(), image_path.c_str()) != 0) {
+    *error = ErrnoMessage(image_path);
+    unlink(temp.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool EngineImage::Load(const std::string& image_path,
+                       const std::string& deck_path, CardStore* store,
+                       std::string* error) {
+  store->Clear();
+  int fd = open(image_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    *error = ErrnoMessage(image_path);
+    return false;
+  }
+  struct stat st;
+  EngineImageHeader h;
+  if (fstat(fd, &st) != 0 || pread(fd, &h, sizeof(h), 0) != sizeof(h) ||
+      memcmp(h.magic, kMagic, sizeof(h.magic)) != 0 ||
+      h.header_size != sizeof(h)) {
+    close(fd);
+    *error = image_path + ": not an engine image";
+    return false;
+  }
+  if (h.version != kVersion || h.layout != kLayout) {
+    close(fd);
+    *error = image_path + ": written by another build";
+    return false;
+  }
+
+  // Cheap staleness check before touching the payload.
+  EngineImageHeader now;
+  if (!StatSource(deck_path, &now, error)) {
+    close(fd);
+    return false;
+  }
+  if (now.deck_size != h.deck_size || now.deck_mtime_ns != h.deck_mtime_ns ||
+      now.deck_inode != h.deck_inode ||
+      now.deck_payload_crc != h.deck_payload_crc ||
+      now.deck_digest != h.deck_digest ||
+      now.journal_size != h.journal_size ||
+      now.journal_mtime_ns != h.journal_mtime_ns) {
+    close(fd);
+    *error = image_path + ": stale, the deck changed since it was written";
+    return false;
+  }
+
+  const size_t payload = static_cast<size_t>(st.st_size) - sizeof(h);
+  void* map = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                   MAP_PRIVATE | MAP_POPULATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    *error = ErrnoMessage(image_path);
+    return false;
+  }
+  const uint8_t* data = static_cast<const uint8_t*>(map) + sizeof(h);
+
+  const bool intact = HiveCrc32(data, payload) == h.payload_crc;
+  bool ok = intact;
+
+  ImageReader in(data, payload);
+  std::vector<uint32_t> posting_sizes;
+  ok = ok && h.tag_count <= UINT32_MAX && h.card_count < UINT32_MAX &&
+       IsPowerOfTwoOrZero(h.tag_table_size) &&
+       IsPowerOfTwoOrZero(h.id_table_size) &&
+       in.Read(h.card_count, &store->cards_) &&
+       in.Read(h.string_bytes, &store->strings_) &&
+       in.Read(h.tag_ref_count, &store->tag_refs_) &&
+       in.Read(h.tag_count, &store->tag_offsets_) &&
+       in.Read(h.tag_count, &store->tag_lengths_) &&
+       in.Read(h.tag_table_size, &store->tag_table_) &&
+       in.Read(h.tag_count, &posting_sizes);
+  if (ok) {
+    store->tag_postings_.resize(h.tag_count);
+    uint64_t postings = 0;
+    for (size_t tag = 0; ok && tag < h.tag_count; ++tag) {
+      postings += posting_sizes[tag];
+      ok = in.Read(posting_sizes[tag], &store->tag_postings_[tag]);
+    }
+    ok = ok && postings == h.posting_count;
+  }
+  ok = ok && in.Read(h.id_table_size, &store->id_table_);
+  std::vector<uint32_t> boxes[CardStore::kBoxCount];
+  for (int box = 0; ok && box < CardStore::kBoxCount; ++box) {
+    ok = in.Read(h.box_sizes[box], &boxes[box]);
+  }
+  ok = ok && in.done() && store->RestoreLinks(boxes);
+  munmap(map, static_cast<size_t>(st.st_size));
+
+  if (!ok) {
+    *error = image_path + (intact ? ": truncated or oversized image"
+                                  : ": checksum mismatch");
+    store->Clear();
+    return false;
+  }
+  return true;
+}
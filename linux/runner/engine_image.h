@@ -0,0 +1,39 @@
+#ifndef FLUTTER_ENGINE_IMAGE_H_
+#define FLUTTER_ENGINE_IMAGE_H_
+
+#include <string>
+
+#include "card_store.h"
+
+// Engine image (.fsdeck.image): a dump of a CardStore's in-memory arrays,
+// written when the app quits so the next start can skip rebuilding the
+// store from the deck file and its journal.
+//
+//   header     see EngineImageHeader in engine_image.cc
+//   arrays     the store's members in declaration order, verbatim: cards,
+//              string heap, tag refs, tag offsets and lengths, tag hash
+//              table, tag postings (sizes, then slots), id hash table, and
+//              the five box queues in review order; the queue links and
+//              posting positions are rebuilt from these on load
+//
+// An image only stands in for the deck it was taken from. The header
+// records the deck header's checksums and the size, inode and mtime of the
+// deck and its journal; any later write to either makes the image stale.
+// The payload is covered by a CRC-32, and the layout by a version and the
+// record sizes it was built with, so an image from another build is refused
+// rather than misread.
+class EngineImage {
+ public:
+  // Writes store, which must be what deck_path and its journal hold right
+  // now, to image_path (through a temporary file and a rename).
+  static bool Save(const CardStore& store, const std::string& deck_path,
+                   const std::string& image_path, std::string* error);
+
+  // Loads image_path into store if it is intact and still matches
+  // deck_path. Returns false, leaving store empty and saying why in error,
+  // otherwise; the caller then loads the deck the usual way.
+  static bool Load(const std::string& image_path, const std::string& deck_path,
+                   CardStore* store, std::string* error);
+};
+
+#endif  // FLUTTER_ENGINE_IMAGE_H_
@@ -0,0 +1,128 @@
+#include "event_ring.h"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <new>
+
+namespace {
+
+size_t RoundUp(size_t n, size_t to) { return (n + to - 1) / to * to; }
+
+}  // namespace
+
+EventRing::EventRing(uint32_t capacity) {
+  uint32_t slots = 1;
+  while (slots < capacity) slots <<= 1;
+  const size_t header = RoundUp(sizeof(Shared), 64);
+  map_size_ = RoundUp(header + slots * sizeof(FsEvent),
+                      static_cast<size_t>(sysconf(_SC_PAGESIZE)));
+
+  int fd = memfd_create("flashsprint-events", MFD_CLOEXEC);
+  if (fd < 0) return;
+  void* map = MAP_FAILED;
+  if (ftruncate(fd, static_cast<off_t>(map_size_)) == 0) {
+    map = mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (map == MAP_FAILED) return;
+
+  event_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (event_fd_ < 0) {
+    munmap(map, map_size_);
+    return;
+  }
+  // The mapping starts zeroed, which is a valid empty ring.
+  shared_ = new (map) Shared();
+  shared_->capacity = slots;
+  slots_ = reinterpret_cast<FsEvent*>(static_cast<char*>(map) + header);
+  mask_ = slots - 1;
+}
+
+EventRing::~EventRing() {
+  if (shared_ != nullptr) munmap(shared_, map_size_);
+  if (event_fd_ >= 0) close(event_fd_);
+}
+
+bool EventRing::Publish(int32_t kind, int32_t arg0, int64_t arg1,
+                        int64_t arg2) {
+  if (shared_ == nullptr) return false;
+  const uint64_t head = shared_->head.load(std::memory_order_relaxed);
+  if (head - producer_tail_ > mask_) {
+    producer_tail_ = shared_->tail.load(std::memory_order_acquire);
+    if (head - producer_tail_ > mask_) {
+      shared_->dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+  }
+  FsEvent& slot = slots_[head & mask_];
+  slot.seq = static_cast<int64_t>(head);
+  slot.kind = kind;
+  slot.arg0 = arg0;
+  slot.arg1 = arg1;
+  slot.arg2 = arg2;
+  shared_->head.store(head + 1, std::memory_order_release);
+
+  // Pairs with the fence in Wait: either the waiter sees the new head before
+  // sleeping, or we see it waiting and wake it.
+  // Only the first event after the waiter went to sleep pays for the
+  // eventfd write; it clears the flag so the rest of a burst does not.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (shared_->waiting.load(std::memory_order_relaxed) != 0 &&
+      shared_->waiting.exchange(0, std::memory_order_relaxed) != 0) {
+    uint64_t one = 1;
+    ssize_t n = write(event_fd_, &one, sizeof(one));
+    (void)n;  // EAGAIN: the counter is already nonzero, the waiter will wake
+  }
+  return true;
+}
+
+size_t EventRing::Poll(FsEvent* out, size_t capacity) {
+  if (shared_ == nullptr) return 0;
+  const uint64_t tail = shared_->tail.load(std::memory_order_relaxed);
+  const uint64_t head = shared_->head.load(std::memory_order_acquire);
+  size_t n = static_cast<size_t>(head - tail);
+  if (n > capacity) n = capacity;
+  for (size_t i = 0; i < n; ++i) out[i] = slots_[(tail + i) & mask_];
+  shared_->tail.store(tail + n, std::memory_order_release);
+  return n;
+}
+
+uint64_t EventRing::Wait(uint64_t seen, int timeout_ms) {
+  if (shared_ == nullptr) return 0;
+  for (;;) {
+    uint64_t head = shared_->head.load(std::memory_order_acquire);
+    if (head != seen) return head;
+
+    shared_->waiting.store(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    head = shared_->head.load(std::memory_order_acquire);
+    if (head == seen) {
+      struct pollfd pfd = {event_fd_, POLLIN, 0};
+      int ready = poll(&pfd, 1, timeout_ms);
+      if (ready > 0) {
+        uint64_t count;
+        ssize_t n = read(event_fd_, &count, sizeof(count));
+        (void)n;
+      }
+      if (ready == 0) {
+        shared_->waiting.store(0, std::memory_order_relaxed);
+        return shared_->head.load(std::memory_order_acquire);
+      }
+      if (ready < 0 && errno != EINTR) {
+        shared_->waiting.store(0, std::memory_order_relaxed);
+        return head;
+      }
+    }
+    shared_->waiting.store(0, std::memory_order_relaxed);
+  }
+}
+
+uint64_t EventRing::dropped() const {
+  return shared_ == nullptr
+             ? 0
+             : shared_->dropped.load(std::memory_order_relaxed);
+}
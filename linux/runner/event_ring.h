@@ -0,0 +1,62 @@
+#ifndef FLUTTER_EVENT_RING_H_
+#define FLUTTER_EVENT_RING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "engine_ffi.h"
+
+// Single-producer/single-consumer ring of FsEvent records in a shared memory
+// mapping (a memfd), used by the engine to publish live updates to Dart
+// without a channel message per event.
+//
+// Publishing is a slot write and a release store of the head index; the
+// consumer drains everything published since its last poll in one call, so
+// bursts batch up on their own. A consumer that has nothing to do blocks in
+// Wait(), and only then does the producer pay for a wake-up (an eventfd
+// write). When the ring is full new events are dropped and counted rather
+// than blocking the engine.
+//
+// One thread publishes at a time (the engine publishes under its lock), one
+// thread polls, and one thread may wait.
+class EventRing {
+ public:
+  // capacity is rounded up to a power of two.
+  explicit EventRing(uint32_t capacity);
+  ~EventRing();
+  EventRing(const EventRing&) = delete;
+  EventRing& operator=(const EventRing&) = delete;
+
+  bool ok() const { return shared_ != nullptr; }
+
+  // Producer. Returns false if the event was dropped.
+  bool Publish(int32_t kind, int32_t arg0, int64_t arg1, int64_t arg2);
+
+  // Consumer: copies up to capacity events into out. Returns the count.
+  size_t Poll(FsEvent* out, size_t capacity);
+
+  // Blocks until more than seen events have been published in total, or
+  // timeout_ms passes (-1: no timeout). Returns the published total.
+  uint64_t Wait(uint64_t seen, int timeout_ms);
+
+  uint64_t dropped() const;
+
+ private:
+  struct Shared {
+    alignas(64) std::atomic<uint64_t> head;  // written by the producer
+    std::atomic<uint64_t> dropped;
+    alignas(64) std::atomic<uint64_t> tail;  // written by the consumer
+    alignas(64) std::atomic<uint32_t> waiting;
+    uint32_t capacity;
+  };
+
+  Shared* shared_ = nullptr;
+  FsEvent* slots_ = nullptr;
+  size_t map_size_ = 0;
+  uint64_t mask_ = 0;
+  uint64_t producer_tail_ = 0;  // producer's last view of tail
+  int event_fd_ = -1;
+};
+
+#endif  // FLUTTER_EVENT_RING_H_
@@ -0,0 +1,132 @@
+#include "hive_box_reader.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace {
+
+// Hive frame layout (hive 2.x): u32 frame length (covering the whole frame),
+// key, optional value, u32 CRC over everything before it. All little-endian.
+constexpr uint8_t kKeyUint = 0;
+constexpr uint8_t kKeyUtf8String = 1;
+constexpr uint8_t kValueString = 4;  // FrameValueType.stringT
+constexpr size_t kMinFrame = 4 + 1 + 4;
+
+uint32_t ReadU32(const uint8_t* p) {
+  return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+         static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+}
+
+// Slicing-by-8 tables: the 'cards' frame is the whole deck, so the checksum
+// is on the startup path and byte-at-a-time would cost as much as the parse.
+struct Crc32Tables {
+  uint32_t t[8][256];
+  Crc32Tables() {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      t[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; ++i)
+      for (int k = 1; k < 8; ++k) t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xff];
+  }
+};
+
+}  // namespace
+
+uint32_t HiveCrc32(const uint8_t* data, size_t size, uint32_t crc) {
+  static const Crc32Tables tables;
+  const auto& t = tables.t;
+  crc ^= 0xffffffffu;
+  for (; size >= 8; data += 8, size -= 8) {
+    uint32_t lo = crc ^ ReadU32(data);
+    uint32_t hi = ReadU32(data + 4);
+    crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^
+          t[4][lo >> 24] ^ t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^
+          t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+  }
+  for (; size > 0; ++data, --size) crc = t[0][(crc ^ *data) & 0xff] ^ (crc >> 8);
+  return crc ^ 0xffffffffu;
+}
+
+HiveBoxReader::~HiveBoxReader() { Close(); }
+
+bool HiveBoxReader::Open(const std::string& path, std::string* error) {
+  Close();
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    *error = path + ": " + strerror(errno);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    *error = path + ": " + strerror(errno);
+    close(fd);
+    return false;
+  }
+  size_ = static_cast<size_t>(st.st_size);
+  if (size_ > 0) {
+    void* map = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+      *error = path + ": " + strerror(errno);
+      close(fd);
+      size_ = 0;
+      return false;
+    }
+    madvise(map, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<const uint8_t*>(map);
+  }
+  close(fd);
+  return true;
+}
+
+void HiveBoxReader::Close() {
+  if (data_ != nullptr) munmap(const_cast<uint8_t*>(data_), size_);
+  data_ = nullptr;
+  size_ = 0;
+}
+
+bool HiveBoxReader::FindString(const std::string& key, const char** data,
+                               size_t* size) const {
+  bool found = false;
+  size_t offset = 0;
+  while (offset + kMinFrame <= size_) {
+    const uint8_t* frame = data_ + offset;
+    uint32_t length = ReadU32(frame);
+    if (length < kMinFrame || length > size_ - offset) break;
+    if (HiveCrc32(frame, length - 4) != ReadU32(frame + length - 4)) break;
+
+    const uint8_t* p = frame + 4;
+    const uint8_t* end = frame + length - 4;
+    bool key_matches = false;
+    if (*p == kKeyUint) {
+      p += 1 + 4;
+    } else if (*p == kKeyUtf8String && p + 2 <= end) {
+      size_t key_length = p[1];
+      key_matches = key_length == key.size() && p + 2 + key_length <= end &&
+                    memcmp(p + 2, key.data(), key_length) == 0;
+      p += 2 + key_length;
+    } else {
+      break;
+    }
+    if (key_matches) {
+      if (p >= end) {
+        found = false;  // deleted
+      } else if (*p == kValueString && p + 5 <= end &&
+                 ReadU32(p + 1) <= static_cast<size_t>(end - p - 5)) {
+        *data = reinterpret_cast<const char*>(p + 5);
+        *size = ReadU32(p + 1);
+        found = true;
+      } else {
+        found = false;  // overwritten with something that is not a String
+      }
+    }
+    offset += length;
+  }
+  return found;
+}
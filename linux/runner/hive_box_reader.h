@@ -0,0 +1,39 @@
+#ifndef FLUTTER_HIVE_BOX_READER_H_
+#define FLUTTER_HIVE_BOX_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only view of a Hive box file (the .hive file behind Hive.openBox).
+// The file is memory-mapped; values found in it point into the mapping and
+// stay valid until the reader is closed or destroyed.
+class HiveBoxReader {
+ public:
+  HiveBoxReader() = default;
+  ~HiveBoxReader();
+  HiveBoxReader(const HiveBoxReader&) = delete;
+  HiveBoxReader& operator=(const HiveBoxReader&) = delete;
+
+  bool Open(const std::string& path, std::string* error);
+  void Close();
+
+  // Finds the live String value stored under a string key. Hive appends a
+  // frame per put, so the last frame for the key wins and a frame without a
+  // value means the key was deleted. Scanning stops at the first frame whose
+  // CRC does not match, the same point where Hive itself would recover.
+  bool FindString(const std::string& key, const char** data, size_t* size) const;
+
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+// CRC-32 (IEEE) as used by Hive frame checksums; pass the previous result to
+// continue a running checksum.
+uint32_t HiveCrc32(const uint8_t* data, size_t size, uint32_t crc = 0);
+
+#endif  // FLUTTER_HIVE_BOX_READER_H_
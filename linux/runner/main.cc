@@ -1,6 +1,10 @@
 #include "my_application.h"
+#include "sampling_profiler.h"
+#include "startup_trace.h"
 
 int main(int argc, char** argv) {
+  StartupTraceMark("main");
+  SamplingProfilerStartFromEnvironment();
   g_autoptr(MyApplication) app = my_application_new();
   return g_application_run(G_APPLICATION(app), argc, argv);
 }
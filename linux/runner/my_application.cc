@@ -6,18 +6,49 @@
 #endif
 
 #include "flutter/generated_plugin_registrant.h"
+#include "engine_channel.h"
+#include "startup_trace.h"
 
 struct _MyApplication {
   GtkApplication parent_instance;
   char** dart_entrypoint_arguments;
+  EngineChannel* engine;
+  gboolean plugins_registered;
 };
 
 G_DEFINE_TYPE(MyApplication, my_application, GTK_TYPE_APPLICATION)
 
+// Registers the generated plugins (audio playback), none of which is needed
+// to draw the first frame.
+static void register_plugins(MyApplication* self, FlView* view) {
+  self->plugins_registered = TRUE;
+  fl_register_plugins(FL_PLUGIN_REGISTRY(view));
+}
+
+// Idle callback queued by first_frame_cb.
+static gboolean register_deferred_plugins_cb(gpointer user_data) {
+  FlView* view = FL_VIEW(user_data);
+  MyApplication* self = MY_APPLICATION(g_application_get_default());
+  gint64 start = g_get_monotonic_time();
+  register_plugins(self, view);
+  StartupTraceDeferred("deferred plugins registered",
+                       (g_get_monotonic_time() - start) / 1000.0);
+  StartupTraceReport();
+  return G_SOURCE_REMOVE;
+}
+
 // Called when first Flutter frame received.
 static void first_frame_cb(MyApplication* self, FlView *view)
 {
   gtk_widget_show(gtk_widget_get_toplevel(GTK_WIDGET(view)));
+  StartupTraceMark("first frame");
+
+  if (self->plugins_registered) {
+    StartupTraceReport();
+    return;
+  }
+  g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, register_deferred_plugins_cb,
+                  g_object_ref(view), g_object_unref);
 }
 
 // Implements GApplication::activate.
@@ -59,6 +90,7 @@ static void my_application_activate(GApplication* application) {
   fl_dart_project_set_dart_entrypoint_arguments(project, self->dart_entrypoint_arguments);
 
   FlView* view = fl_view_new(project);
+  StartupTraceMark("view created");
   GdkRGBA background_color;
   // Background defaults to black, override it here if necessary, e.g. #00000000 for transparent.
   gdk_rgba_parse(&background_color, "#000000");
@@ -71,7 +103,17 @@ static void my_application_activate(GApplication* application) {
   g_signal_connect_swapped(view, "first-frame", G_CALLBACK(first_frame_cb), self);
   gtk_widget_realize(GTK_WIDGET(view));
 
-  fl_register_plugins(FL_PLUGIN_REGISTRY(view));
+  // Native card engine, reached from Dart over "flashsprint/engine". The
+  // Dart side loads the deck through it before its first frame, so it is
+  // the one channel set up eagerly; the generated plugins wait for
+  // first_frame_cb unless FLASHSPRINT_EAGER_PLUGINS asks for the old order.
+  delete self->engine;
+  self->engine = new EngineChannel(
+      fl_engine_get_binary_messenger(fl_view_get_engine(view)));
+  if (g_getenv("FLASHSPRINT_EAGER_PLUGINS") != nullptr) {
+    register_plugins(self, view);
+    StartupTraceMark("plugins registered before first frame");
+  }
 
   gtk_widget_grab_focus(GTK_WIDGET(view));
 }
@@ -109,6 +151,8 @@ static void my_application_shutdown(GApplication* application) {
   //MyApplication* self = MY_APPLICATION(object);
 
   // Perform any actions required at application shutdown.
+  // Write out whatever autosave has not checkpointed yet.
+  Engine::Instance()->Shutdown();
 
   G_APPLICATION_CLASS(my_application_parent_class)->shutdown(application);
 }
@@ -117,6 +161,8 @@ static void my_application_shutdown(GApplication* application) {
 static void my_application_dispose(GObject* object) {
   MyApplication* self = MY_APPLICATION(object);
   g_clear_pointer(&self->dart_entrypoint_arguments, g_strfreev);
+  delete self->engine;
+  self->engine = nullptr;
   G_OBJECT_CLASS(my_application_parent_class)->dispose(object);
 }
 
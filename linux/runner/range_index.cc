@@ -0,0 +1,137 @@
+#include "range_index.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+bool Less(const RangeIndex::Entry& a, const RangeIndex::Entry& b) {
+  return a.key != b.key ? a.key < b.key : a.slot < b.slot;
+}
+
+}  // namespace
+
+void RangeIndex::Build(std::vector<Entry> entries) {
+  std::sort(entries.begin(), entries.end(), Less);
+  Clear();
+  for (size_t i = 0; i < entries.size(); i += kFillBlock) {
+    size_t end = std::min(entries.size(), i + kFillBlock);
+    blocks_.emplace_back(entries.begin() + i, entries.begin() + end);
+    fences_.push_back(entries[i]);
+  }
+  size_ = entries.size();
+}
+
+void RangeIndex::Clear() {
+  blocks_.clear();
+  fences_.clear();
+  size_ = 0;
+}
+
+size_t RangeIndex::BlockFor(const Entry& e) const {
+  auto it = std::upper_bound(fences_.begin(), fences_.end(), e, Less);
+  return it == fences_.begin() ? 0 : (it - fences_.begin()) - 1;
+}
+
+void RangeIndex::Insert(int64_t key, uint32_t slot) {
+  const Entry e{key, slot};
+  if (blocks_.empty()) {
+    blocks_.emplace_back();
+    fences_.push_back(e);
+  }
+  size_t b = BlockFor(e);
+  std::vector<Entry>& block = blocks_[b];
+  block.insert(std::upper_bound(block.begin(), block.end(), e, Less), e);
+  fences_[b] = block.front();
+  ++size_;
+  if (block.size() >= kMaxBlock) {
+    // Split in half; the new block goes right after this one.
+    std::vector<Entry> upper(block.begin() + kMaxBlock / 2, block.end());
+    block.resize(kMaxBlock / 2);
+    fences_.insert(fences_.begin() + b + 1, upper.front());
+    blocks_.insert(blocks_.begin() + b + 1, std::move(upper));
+  }
+}
+
+bool RangeIndex::Erase(int64_t key, uint32_t slot) {
+  if (blocks_.empty()) return false;
+  const Entry e{key, slot};
+  size_t b = BlockFor(e);
+  std::vector<Entry>& block = blocks_[b];
+  auto it = std::lower_bound(block.begin(), block.end(), e, Less);
+  if (it == block.end() || it->key != key || it->slot != slot) return false;
+  block.erase(it);
+  --size_;
+  if (block.empty()) {
+    blocks_.erase(blocks_.begin() + b);
+    fences_.erase(fences_.begin() + b);
+    return true;
+  }
+  fences_[b] = block.front();
+  // Fold a thinned-out block into its successor when both fit in one.
+  if (b + 1 < blocks_.size() &&
+      block.size() + blocks_[b + 1].size() <= kFillBlock) {
+    block.insert(block.end(), blocks_[b + 1].begin(), blocks_[b + 1].end());
+    blocks_.erase(blocks_.begin() + b + 1);
+    fences_.erase(fences_.begin() + b + 1);
+  }
+  return true;
+}
+
+void RangeIndex::LowerBound(int64_t lo, size_t* block, size_t* index) const {
+  const Entry e{lo, 0};
+  size_t b = BlockFor(e);
+  while (b < blocks_.size()) {
+    const std::vector<Entry>& entries = blocks_[b];
+    auto it = std::lower_bound(entries.begin(), entries.end(), e, Less);
+    if (it != entries.end()) {
+      *block = b;
+      *index = static_cast<size_t>(it - entries.begin());
+      return;
+    }
+    ++b;
+  }
+  *block = blocks_.size();
+  *index = 0;
+}
+
+size_t RangeIndex::Count(int64_t lo, int64_t hi) const {
+  if (lo > hi) return 0;
+  size_t b, i;
+  LowerBound(lo, &b, &i);
+  size_t count = 0;
+  for (; b < blocks_.size(); ++b, i = 0) {
+    const std::vector<Entry>& entries = blocks_[b];
+    if (entries.back().key <= hi) {
+      count += entries.size() - i;
+      continue;
+    }
+    auto end = std::upper_bound(
+        entries.begin() + i, entries.end(),
+        Entry{hi, std::numeric_limits<uint32_t>::max()}, Less);
+    count += static_cast<size_t>(end - entries.begin()) - i;
+    break;
+  }
+  return count;
+}
+
+void RangeIndex::Scan(int64_t lo, int64_t hi, size_t skip, size_t limit,
+                      std::vector<uint32_t>* slots) const {
+  if (lo > hi) return;
+  size_t b, i;
+  LowerBound(lo, &b, &i);
+  for (; b < blocks_.size() && limit > 0; ++b, i = 0) {
+    const std::vector<Entry>& entries = blocks_[b];
+    if (skip >= entries.size() - i && entries.back().key <= hi) {
+      skip -= entries.size() - i;
+      continue;
+    }
+    i += skip;
+    skip = 0;
+    for (; i < entries.size() && limit > 0; ++i, --limit) {
+      if (entries[i].key > hi) return;
+      slots->push_back(entries[i].slot);
+    }
+    if (i < entries.size()) return;
+  }
+}
@@ -0,0 +1,54 @@
+#ifndef FLUTTER_RANGE_INDEX_H_
+#define FLUTTER_RANGE_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Ordered index from an int64 key to card slots, for range queries over a
+// card field. Entries are (key, slot) pairs kept in sorted blocks of at most
+// kMaxBlock, under a fence array holding each block's first entry: a B+-tree
+// of height two. Insert and Erase binary-search the fences and shift entries
+// within one block. A range query finds its first block the same way and
+// walks forward, skipping or counting whole blocks by their size, so scans
+// cost O(log n + results) and counts O(log n + blocks spanned).
+class RangeIndex {
+ public:
+  struct Entry {
+    int64_t key;
+    uint32_t slot;
+  };
+
+  // Replaces the contents with entries, in any order.
+  void Build(std::vector<Entry> entries);
+  void Clear();
+
+  void Insert(int64_t key, uint32_t slot);
+  // Returns false if there is no such entry.
+  bool Erase(int64_t key, uint32_t slot);
+
+  // Number of entries with lo <= key <= hi.
+  size_t Count(int64_t lo, int64_t hi) const;
+
+  // Appends the slots of up to limit entries with lo <= key <= hi, in key
+  // order (then slot), after skipping the first skip of them.
+  void Scan(int64_t lo, int64_t hi, size_t skip, size_t limit,
+            std::vector<uint32_t>* slots) const;
+
+  size_t size() const { return size_; }
+
+ private:
+  static constexpr size_t kMaxBlock = 512;
+  static constexpr size_t kFillBlock = kMaxBlock / 2;  // Build leaves room
+
+  // Block that holds (or would hold) e: the last whose fence is <= e.
+  size_t BlockFor(const Entry& e) const;
+  // Position of the first entry with key >= lo, as (block, index).
+  void LowerBound(int64_t lo, size_t* block, size_t* index) const;
+
+  std::vector<std::vector<Entry>> blocks_;
+  std::vector<Entry> fences_;  // blocks_[i].front()
+  size_t size_ = 0;
+};
+
+#endif  // FLUTTER_RANGE_INDEX_H_
@@ -0,0 +1,335 @@
+#include "sampling_profiler.h"
+
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+#if defined(__linux__) && (defined(__x86_64__) || defined(__aarch64__))
+#define FLASHSPRINT_PROFILER_SUPPORTED 1
+#else
+#define FLASHSPRINT_PROFILER_SUPPORTED 0
+#endif
+
+constexpr int kMaxThreads = 64;
+// Words per thread: 1 MiB, several thousand deep samples. The buffers are
+// reserved up front but only pages a thread writes are ever committed.
+constexpr size_t kThreadWords = (1 << 20) / sizeof(uintptr_t);
+constexpr size_t kMaxDepth = 128;
+// A caller's frame lies above its callee's; one further away than this from
+// the interrupted stack pointer is taken as a broken chain.
+constexpr uintptr_t kMaxStackSpan = 64 << 20;
+// Granule in which frame addresses are checked before being read; no
+// larger than any page size, so a checked granule is wholly mapped.
+constexpr uintptr_t kProbeGranule = 4096;
+
+// One thread's samples, each [depth, pc, return address, ...], leaf first.
+struct ThreadBuffer {
+  std::atomic<size_t> used;     // words published
+  std::atomic<bool> writing;    // a sample is being written
+  std::atomic<size_t> dropped;  // samples that did not fit
+  uintptr_t* words;
+};
+
+ThreadBuffer buffers[kMaxThreads];
+uintptr_t* region = nullptr;
+std::atomic<int> claimed(0);
+std::atomic<bool> running(false);
+std::atomic<unsigned> generation(0);
+std::atomic<size_t> unclaimed(0);  // samples from threads past kMaxThreads
+pid_t self_pid = 0;
+char* exit_path = nullptr;
+
+#if FLASHSPRINT_PROFILER_SUPPORTED
+// The thread's buffer in the current profile; claimed on its first sample.
+thread_local ThreadBuffer* thread_buffer = nullptr;
+thread_local unsigned thread_generation = 0;
+
+ThreadBuffer* ClaimBuffer() {
+  unsigned current = generation.load(std::memory_order_acquire);
+  if (thread_buffer && thread_generation == current) return thread_buffer;
+  int slot = claimed.fetch_add(1, std::memory_order_relaxed);
+  if (slot >= kMaxThreads) return nullptr;
+  thread_buffer = &buffers[slot];
+  thread_generation = current;
+  return thread_buffer;
+}
+
+// Copies the two words of the frame record at fp, or returns false if they
+// are not readable. The frame register is only a frame pointer in code built
+// with one; elsewhere it holds any value, so the first word read from each
+// granule goes through the kernel, which fails with EFAULT where a plain
+// load would fault. After that the rest of the granule is read directly.
+bool ReadFrame(uintptr_t fp, uintptr_t* checked, uintptr_t out[2]) {
+  uintptr_t granule = fp & ~(kProbeGranule - 1);
+  if (granule == *checked && fp + 2 * sizeof(uintptr_t) <= granule + kProbeGranule) {
+    const uintptr_t* frame = reinterpret_cast<const uintptr_t*>(fp);
+    out[0] = frame[0];
+    out[1] = frame[1];
+    return true;
+  }
+  struct iovec local = {out, 2 * sizeof(uintptr_t)};
+  struct iovec remote = {reinterpret_cast<void*>(fp), 2 * sizeof(uintptr_t)};
+  if (process_vm_readv(self_pid, &local, 1, &remote, 1, 0) !=
+      static_cast<ssize_t>(2 * sizeof(uintptr_t))) {
+    return false;
+  }
+  *checked = granule;
+  return true;
+}
+
+void OnSample(int, siginfo_t*, void* context) {
+  if (!running.load(std::memory_order_relaxed)) return;
+  int saved_errno = errno;
+  ThreadBuffer* buffer = ClaimBuffer();
+  if (!buffer) {
+    unclaimed.fetch_add(1, std::memory_order_relaxed);
+    errno = saved_errno;
+    return;
+  }
+  // Stop clears running and then waits for writing to drop; both sides
+  // store before they load, so one of them sees the other.
+  buffer->writing.store(true);
+  if (!running.load()) {
+    buffer->writing.store(false);
+    errno = saved_errno;
+    return;
+  }
+
+  const mcontext_t& mc = static_cast<const ucontext_t*>(context)->uc_mcontext;
+#if defined(__x86_64__)
+  uintptr_t pc = mc.gregs[REG_RIP], fp = mc.gregs[REG_RBP], sp = mc.gregs[REG_RSP];
+#else
+  uintptr_t pc = mc.pc, fp = mc.regs[29], sp = mc.sp;
+#endif
+  uintptr_t frames[kMaxDepth];
+  size_t depth = 0;
+  uintptr_t checked = 0;  // no granule checked yet; page 0 is never mapped
+  frames[depth++] = pc;
+  while (depth < kMaxDepth) {
+    if (fp < sp || fp - sp > kMaxStackSpan || fp % sizeof(uintptr_t) != 0) break;
+    uintptr_t frame[2];
+    if (!ReadFrame(fp, &checked, frame)) break;
+    uintptr_t next = frame[0], ret = frame[1];
+    if (ret == 0) break;
+    frames[depth++] = ret - 1;  // inside the call, so it symbolizes as the caller
+    if (next <= fp) break;
+    fp = next;
+  }
+
+  size_t used = buffer->used.load(std::memory_order_relaxed);
+  if (used + depth + 1 > kThreadWords) {
+    buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    buffer->words[used] = depth;
+    memcpy(buffer->words + used + 1, frames, depth * sizeof(uintptr_t));
+    buffer->used.store(used + depth + 1, std::memory_order_release);
+  }
+  buffer->writing.store(false, std::memory_order_release);
+  errno = saved_errno;
+}
+#endif
+
+// "Namespace::Function" for pc, or "module+0xoffset" when it has no
+// exported symbol (addr2line can finish the job).
+std::string Symbolize(uintptr_t pc) {
+  Dl_info info;
+  if (dladdr(reinterpret_cast<void*>(pc), &info) == 0) {
+    char hex[32];
+    snprintf(hex, sizeof(hex), "0x%zx", static_cast<size_t>(pc));
+    return hex;
+  }
+  std::string name;
+  if (info.dli_sname) {
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+    name = status == 0 && demangled ? demangled : info.dli_sname;
+    free(demangled);
+    // drop the parameter list: flame graphs group by function
+    if (status == 0 && !name.empty() && name.back() == ')') {
+      int nesting = 0;
+      for (size_t i = name.size(); i-- > 0;) {
+        if (name[i] == ')') nesting++;
+        if (name[i] == '(' && --nesting == 0) {
+          name.resize(i);
+          break;
+        }
+      }
+    }
+  } else {
+    const char* module = info.dli_fname ? info.dli_fname : "?";
+    if (const char* slash = strrchr(module, '/')) module = slash + 1;
+    char offset[32];
+    snprintf(offset, sizeof(offset), "+0x%zx",
+             static_cast<size_t>(pc - reinterpret_cast<uintptr_t>(info.dli_fbase)));
+    name = std::string(module) + offset;
+  }
+  // ';' separates frames and the last ' ' the count in the folded format
+  for (char& c : name) {
+    if (c == ';') c = ':';
+  }
+  return name;
+}
+
+void WriteAtExit() {
+  if (!exit_path) return;
+  size_t samples = 0;
+  std::string error;
+  if (SamplingProfilerStop(exit_path, &samples, &error)) {
+    fprintf(stderr, "profile: %zu samples written to %s\n", samples, exit_path);
+  } else {
+    fprintf(stderr, "profile: %s\n", error.c_str());
+  }
+}
+
+}  // namespace
+
+bool SamplingProfilerStart(int hz, std::string* error) {
+#if !FLASHSPRINT_PROFILER_SUPPORTED
+  (void)hz;
+  *error = "sampling profiler is not supported on this platform";
+  return false;
+#else
+  if (running.load()) {
+    *error = "a profile is already running";
+    return false;
+  }
+  if (hz <= 0 || hz > 10000) hz = 99;
+  if (!region) {
+    void* p = mmap(nullptr, kMaxThreads * kThreadWords * sizeof(uintptr_t),
+                   PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                   -1, 0);
+    if (p == MAP_FAILED) {
+      *error = std::string("profile buffers: ") + strerror(errno);
+      return false;
+    }
+    region = static_cast<uintptr_t*>(p);
+  }
+  for (int i = 0; i < kMaxThreads; i++) {
+    buffers[i].used.store(0);
+    buffers[i].writing.store(false);
+    buffers[i].dropped.store(0);
+    buffers[i].words = region + i * kThreadWords;
+  }
+  claimed.store(0);
+  unclaimed.store(0);
+  self_pid = getpid();
+  generation.fetch_add(1, std::memory_order_release);
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_sigaction = OnSample;
+  action.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(SIGPROF, &action, nullptr) != 0) {
+    *error = std::string("SIGPROF handler: ") + strerror(errno);
+    return false;
+  }
+  running.store(true);
+  struct itimerval timer;
+  timer.it_interval.tv_sec = 0;
+  timer.it_interval.tv_usec = hz == 1 ? 999999 : 1000000 / hz;
+  timer.it_value = timer.it_interval;
+  if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+    running.store(false);
+    *error = std::string("profiling timer: ") + strerror(errno);
+    return false;
+  }
+  return true;
+#endif
+}
+
+bool SamplingProfilerStop(const std::string& path, size_t* samples,
+                          std::string* error) {
+  if (!running.load()) {
+    *error = "no profile is running";
+    return false;
+  }
+  struct itimerval off;
+  memset(&off, 0, sizeof(off));
+  setitimer(ITIMER_PROF, &off, nullptr);
+  // The handler stays installed, returning at once, so a SIGPROF already
+  // in flight cannot kill the process.
+  running.store(false);
+  int threads = std::min(claimed.load(), kMaxThreads);
+  for (int i = 0; i < threads; i++) {
+    while (buffers[i].writing.load(std::memory_order_acquire)) {
+    }
+  }
+
+  // count identical stacks first, then name each distinct pc once
+  std::map<std::vector<uintptr_t>, size_t> stacks;
+  size_t total = 0, dropped = unclaimed.load();
+  for (int i = 0; i < threads; i++) {
+    const ThreadBuffer& buffer = buffers[i];
+    size_t used = buffer.used.load(std::memory_order_acquire);
+    for (size_t at = 0; at < used;) {
+      size_t depth = buffer.words[at];
+      const uintptr_t* frames = buffer.words + at + 1;
+      stacks[std::vector<uintptr_t>(frames, frames + depth)]++;
+      at += depth + 1;
+      total++;
+    }
+    dropped += buffer.dropped.load();
+  }
+  std::unordered_map<uintptr_t, std::string> names;
+  std::map<std::string, size_t> folded;
+  std::string line;
+  for (const auto& entry : stacks) {
+    line.clear();
+    const std::vector<uintptr_t>& frames = entry.first;
+    for (size_t i = frames.size(); i-- > 0;) {
+      auto it = names.find(frames[i]);
+      if (it == names.end()) it = names.emplace(frames[i], Symbolize(frames[i])).first;
+      if (!line.empty()) line += ';';
+      line += it->second;
+    }
+    folded[line] += entry.second;
+  }
+
+  FILE* f = fopen(path.c_str(), "w");
+  if (!f) {
+    *error = path + ": " + strerror(errno);
+    return false;
+  }
+  for (const auto& entry : folded) {
+    fprintf(f, "%s %zu\n", entry.first.c_str(), entry.second);
+  }
+  if (dropped > 0) fprintf(f, "[dropped] %zu\n", dropped);
+  if (fclose(f) != 0) {
+    *error = path + ": " + strerror(errno);
+    return false;
+  }
+  if (samples) *samples = total;
+  return true;
+}
+
+void SamplingProfilerStartFromEnvironment() {
+  const char* path = getenv("FLASHSPRINT_PROFILE");
+  if (!path || !*path || exit_path) return;
+  const char* hz = getenv("FLASHSPRINT_PROFILE_HZ");
+  std::string error;
+  if (!SamplingProfilerStart(hz ? atoi(hz) : 99, &error)) {
+    fprintf(stderr, "profile: %s\n", error.c_str());
+    return;
+  }
+  exit_path = strdup(path);
+  atexit(WriteAtExit);
+}
@@ -0,0 +1,42 @@
+#ifndef FLUTTER_SAMPLING_PROFILER_H_
+#define FLUTTER_SAMPLING_PROFILER_H_
+
+#include <cstddef>
+#include <string>
+
+// In-process sampling profiler, for when a load or a long session is slow
+// somewhere perf is not at hand. A SIGPROF interval timer (ITIMER_PROF, the
+// process's CPU time) interrupts whichever thread is running; the handler
+// walks that thread's frame pointers and appends the return addresses to the
+// thread's own preallocated buffer, without locks or allocation. Stopping
+// symbolizes the stacks and writes them folded, one line per distinct stack,
+// root first, with its sample count, for flamegraph.pl or speedscope:
+//
+//   main;MigrateHiveBox;ParseCardsJson;CardStore::AddCard 12
+//
+// Set in the environment to profile a whole run, written at exit:
+//
+//   FLASHSPRINT_PROFILE=out.folded   where to write the stacks
+//   FLASHSPRINT_PROFILE_HZ=N         samples per CPU second (default 99)
+//
+// At the default rate a sample costs well under a microsecond, so it can
+// stay on through load tests. Stacks are only as deep as the frame pointers
+// go: the runner is built with -fno-omit-frame-pointer, and a library built
+// without them ends the stack at its first frame. Such code leaves anything
+// in the frame register, so the walk reads each new stack page through
+// process_vm_readv first and stops where that fails rather than faulting;
+// where a sandbox forbids the call, stacks stop at the interrupted pc.
+
+// Starts sampling at hz samples per CPU second. Fails if a profile is
+// already running or the platform has no unwinder here.
+bool SamplingProfilerStart(int hz, std::string* error);
+
+// Stops sampling and writes the folded stacks to path; *samples (optional)
+// is the number of samples written.
+bool SamplingProfilerStop(const std::string& path, size_t* samples,
+                          std::string* error);
+
+// Starts a profile if FLASHSPRINT_PROFILE is set, to be written at exit.
+void SamplingProfilerStartFromEnvironment();
+
+#endif  // FLUTTER_SAMPLING_PROFILER_H_
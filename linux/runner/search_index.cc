@@ -0,0 +1,330 @@
+#include "search_index.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr size_t kMaxWord = 0xffff;
+
+bool IsWordByte(unsigned char c) {
+  return c >= 0x80 || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+         (c >= 'A' && c <= 'Z');
+}
+
+char Lower(char c) { return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c; }
+
+uint32_t HashWord(const char* data, size_t size) {
+  uint32_t h = 2166136261u;  // FNV-1a
+  for (size_t i = 0; i < size; ++i) h = (h ^ static_cast<uint8_t>(data[i])) * 16777619u;
+  return h;
+}
+
+int CompareBytes(const char* a, size_t a_size, const char* b, size_t b_size) {
+  int c = memcmp(a, b, std::min(a_size, b_size));
+  if (c != 0) return c;
+  return a_size < b_size ? -1 : a_size > b_size ? 1 : 0;
+}
+
+// Calls word(offset, data, size) for each word of text.
+template <typename F>
+void ForEachWord(const char* text, size_t size, F word) {
+  size_t i = 0;
+  while (i < size) {
+    while (i < size && !IsWordByte(static_cast<unsigned char>(text[i]))) ++i;
+    size_t start = i;
+    while (i < size && IsWordByte(static_cast<unsigned char>(text[i]))) ++i;
+    if (i > start) word(start, text + start, std::min(i - start, kMaxWord));
+  }
+}
+
+// Calls word(slot, field, tag, offset, data, size) for every word of every
+// card, in slot order, then field order (question, answer, tags in card
+// order), then offset order: the order postings are kept in.
+template <typename F>
+void ForEachCardWord(const CardStore& store, F word) {
+  for (uint32_t slot = 0; slot < store.size(); ++slot) {
+    StrRef question = store.question(slot);
+    ForEachWord(question.data, question.size,
+                [&](size_t offset, const char* data, size_t size) {
+                  word(slot, SearchIndex::kQuestion, 0, offset, data, size);
+                });
+    StrRef answer = store.answer(slot);
+    ForEachWord(answer.data, answer.size,
+                [&](size_t offset, const char* data, size_t size) {
+                  word(slot, SearchIndex::kAnswer, 0, offset, data, size);
+                });
+    const CardRecord& card = store.card(slot);
+    for (uint32_t i = 0; i < card.tag_count; ++i) {
+      StrRef name = store.tag_name(store.tag_refs()[card.tags_begin + i]);
+      const uint8_t tag = static_cast<uint8_t>(std::min<uint32_t>(i, 0xff));
+      ForEachWord(name.data, name.size,
+                  [&](size_t offset, const char* data, size_t size) {
+                    word(slot, SearchIndex::kTag, tag, offset, data, size);
+                  });
+    }
+  }
+}
+
+}  // namespace
+
+void SearchIndex::Build(const CardStore& store) {
+  // Pass 1: intern every word, in first-seen order, and count occurrences.
+  std::string heap;
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> lengths;
+  std::vector<uint32_t> counts;
+  std::vector<uint32_t> table(1024, 0);  // open addressing: id + 1
+  std::vector<uint32_t> word_terms;      // term id of each occurrence
+  std::string lower;
+  ForEachCardWord(store, [&](uint32_t, uint8_t, uint8_t, size_t,
+                             const char* data, size_t size) {
+    lower.assign(data, size);
+    for (char& c : lower) c = Lower(c);
+    if (table.size() < (offsets.size() + 1) * 2) {
+      std::vector<uint32_t> grown(table.size() * 2, 0);
+      const size_t mask = grown.size() - 1;
+      for (uint32_t id = 0; id < offsets.size(); ++id) {
+        size_t i = HashWord(heap.data() + offsets[id], lengths[id]) & mask;
+        while (grown[i] != 0) i = (i + 1) & mask;
+        grown[i] = id + 1;
+      }
+      table.swap(grown);
+    }
+    const size_t mask = table.size() - 1;
+    size_t i = HashWord(lower.data(), size) & mask;
+    for (; table[i] != 0; i = (i + 1) & mask) {
+      const uint32_t id = table[i] - 1;
+      if (lengths[id] == size &&
+          memcmp(heap.data() + offsets[id], lower.data(), size) == 0) {
+        break;
+      }
+    }
+    if (table[i] == 0) {
+      table[i] = static_cast<uint32_t>(offsets.size()) + 1;
+      offsets.push_back(static_cast<uint32_t>(heap.size()));
+      lengths.push_back(static_cast<uint32_t>(size));
+      counts.push_back(0);
+      heap.append(lower);
+    }
+    const uint32_t id = table[i] - 1;
+    ++counts[id];
+    word_terms.push_back(id);
+  });
+
+  // Sort the terms, so prefixes are contiguous ranges.
+  std::vector<uint32_t> order(offsets.size());
+  for (uint32_t id = 0; id < order.size(); ++id) order[id] = id;
+  std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return CompareBytes(heap.data() + offsets[a], lengths[a],
+                        heap.data() + offsets[b], lengths[b]) < 0;
+  });
+  std::vector<uint32_t> rank(order.size());
+  terms_.clear();
+  terms_.reserve(heap.size());
+  term_offsets_.resize(order.size());
+  term_lengths_.resize(order.size());
+  posting_begin_.assign(order.size() + 1, 0);
+  for (uint32_t r = 0; r < order.size(); ++r) {
+    const uint32_t id = order[r];
+    rank[id] = r;
+    term_offsets_[r] = static_cast<uint32_t>(terms_.size());
+    term_lengths_[r] = lengths[id];
+    terms_.append(heap, offsets[id], lengths[id]);
+    posting_begin_[r + 1] = posting_begin_[r] + counts[id];
+  }
+
+  // Pass 2: place each occurrence in its term's postings. Cards are walked
+  // in slot order, so every term's postings come out sorted.
+  postings_.resize(word_terms.size());
+  std::vector<uint32_t> next(posting_begin_.begin(), posting_begin_.end() - 1);
+  size_t n = 0;
+  ForEachCardWord(store, [&](uint32_t slot, uint8_t field, uint8_t tag,
+                             size_t offset, const char*, size_t size) {
+    postings_[next[rank[word_terms[n++]]]++] = {
+        slot, static_cast<uint32_t>(offset), static_cast<uint16_t>(size),
+        field, tag};
+  });
+
+  card_count_ = store.size();
+  version_ = store.text_version();
+  built_ = true;
+}
+
+uint32_t SearchIndex::LowerBound(const char* data, size_t size) const {
+  uint32_t lo = 0;
+  uint32_t hi = static_cast<uint32_t>(term_offsets_.size());
+  while (lo < hi) {
+    const uint32_t mid = lo + (hi - lo) / 2;
+    StrRef t = term(mid);
+    if (CompareBytes(t.data, t.size, data, size) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+bool SearchIndex::Parse(const char* query, size_t size, Query* out) const {
+  out->terms.clear();
+  // The last word is still being typed unless the query ends after it.
+  const bool open_end =
+      size > 0 && IsWordByte(static_cast<unsigned char>(query[size - 1]));
+  std::vector<std::string> words;
+  ForEachWord(query, size, [&](size_t, const char* data, size_t length) {
+    words.emplace_back(data, length);
+    for (char& c : words.back()) c = Lower(c);
+  });
+  for (size_t w = 0; w < words.size(); ++w) {
+    const std::string& word = words[w];
+    const uint32_t first = LowerBound(word.data(), word.size());
+    uint32_t last = first;
+    if (open_end && w + 1 == words.size()) {
+      // Every term starting with word follows first.
+      uint32_t hi = static_cast<uint32_t>(term_offsets_.size());
+      while (last < hi) {
+        const uint32_t mid = last + (hi - last) / 2;
+        StrRef t = term(mid);
+        if (t.size >= word.size() &&
+            memcmp(t.data, word.data(), word.size()) == 0) {
+          last = mid + 1;
+        } else {
+          hi = mid;
+        }
+      }
+    } else if (first < term_offsets_.size() &&
+               CompareBytes(term(first).data, term(first).size, word.data(),
+                            word.size()) == 0) {
+      last = first + 1;
+    }
+    if (last == first) {
+      out->terms.clear();
+      return false;
+    }
+    out->terms.emplace_back(first, last);
+  }
+  return !out->terms.empty();
+}
+
+void SearchIndex::Search(const Query& query,
+                         std::vector<uint32_t>* slots) const {
+  slots->clear();
+  if (query.empty()) return;
+
+  // Start from the word with the fewest occurrences.
+  std::vector<size_t> words(query.terms.size());
+  for (size_t w = 0; w < words.size(); ++w) words[w] = w;
+  auto occurrences = [&](size_t w) {
+    return posting_begin_[query.terms[w].second] -
+           posting_begin_[query.terms[w].first];
+  };
+  std::sort(words.begin(), words.end(), [&](size_t a, size_t b) {
+    return occurrences(a) < occurrences(b);
+  });
+
+  std::vector<uint32_t> cards;
+  std::vector<uint8_t> marks;
+  for (size_t k = 0; k < words.size(); ++k) {
+    const auto& range = query.terms[words[k]];
+    cards.clear();
+    if (range.second - range.first == 1) {
+      // One term: its postings are already in slot order.
+      for (uint32_t p = posting_begin_[range.first];
+           p < posting_begin_[range.second]; ++p) {
+        const uint32_t slot = postings_[p].slot;
+        if (cards.empty() || cards.back() != slot) cards.push_back(slot);
+      }
+    } else {
+      // A prefix: merge its terms' postings through a mark per card.
+      marks.assign(card_count_, 0);
+      for (uint32_t p = posting_begin_[range.first];
+           p < posting_begin_[range.second]; ++p) {
+        marks[postings_[p].slot] = 1;
+      }
+      for (uint32_t slot = 0; slot < card_count_; ++slot) {
+        if (marks[slot]) cards.push_back(slot);
+      }
+    }
+    if (k == 0) {
+      slots->swap(cards);
+    } else {
+      auto end = std::set_intersection(slots->begin(), slots->end(),
+                                       cards.begin(), cards.end(),
+                                       slots->begin());
+      slots->erase(end, slots->end());
+    }
+    if (slots->empty()) return;
+  }
+}
+
+void SearchIndex::Matches(const Query& query, uint32_t slot,
+                          std::vector<SearchMatch>* out) const {
+  out->clear();
+  for (const auto& range : query.terms) {
+    for (uint32_t t = range.first; t < range.second; ++t) {
+      auto begin = postings_.begin() + posting_begin_[t];
+      auto end = postings_.begin() + posting_begin_[t + 1];
+      auto it = std::lower_bound(
+          begin, end, slot,
+          [](const Posting& p, uint32_t s) { return p.slot < s; });
+      for (; it != end && it->slot == slot; ++it) {
+        out->push_back({it->offset, it->length, it->field, it->tag});
+      }
+    }
+  }
+  auto key = [](const SearchMatch& m) {
+    return (static_cast<uint64_t>(m.field) << 40) |
+           (static_cast<uint64_t>(m.tag) << 32) | m.offset;
+  };
+  std::sort(out->begin(), out->end(),
+            [&](const SearchMatch& a, const SearchMatch& b) {
+              return key(a) < key(b);
+            });
+  // Two words of the query can match the same occurrence ("tree tr").
+  out->erase(std::unique(out->begin(), out->end(),
+                         [&](const SearchMatch& a, const SearchMatch& b) {
+                           return key(a) == key(b);
+                         }),
+             out->end());
+}
+
+Snippet SearchIndex::Cut(StrRef text, const SearchMatch* matches,
+                         size_t count, size_t max_bytes) {
+  const size_t size = text.size;
+  if (size <= max_bytes) return {0, static_cast<uint32_t>(size), false, false};
+  auto word_at = [&](size_t i) {
+    return IsWordByte(static_cast<unsigned char>(text.data[i]));
+  };
+  auto continuation = [&](size_t i) {
+    return (static_cast<unsigned char>(text.data[i]) & 0xc0) == 0x80;
+  };
+
+  // Put the first match a quarter of the way in, keeping the window inside
+  // the text.
+  const size_t anchor = count > 0 ? matches[0].offset : 0;
+  const size_t anchor_end = count > 0 ? anchor + matches[0].length : 0;
+  size_t begin = anchor > max_bytes / 4 ? anchor - max_bytes / 4 : 0;
+  begin = std::min(begin, size - max_bytes);
+  if (begin > 0 && word_at(begin - 1)) {
+    // Don't open mid-word.
+    while (begin < anchor && word_at(begin)) ++begin;
+  }
+  while (begin < anchor && begin < size && !word_at(begin) &&
+         text.data[begin] == ' ') {
+    ++begin;
+  }
+  while (begin < size && continuation(begin)) ++begin;
+
+  size_t end = std::min(size, begin + max_bytes);
+  if (end < size && word_at(end) && word_at(end - 1)) {
+    // Don't close mid-word either, unless that would drop the first match.
+    size_t e = end;
+    while (e > begin && word_at(e - 1)) --e;
+    if (e > begin && e >= anchor_end) end = e;
+  }
+  while (end > begin && end < size && continuation(end)) --end;
+  while (end > begin && end < size && text.data[end - 1] == ' ') --end;
+  return {static_cast<uint32_t>(begin), static_cast<uint32_t>(end - begin),
+          begin > 0, end < size};
+}
@@ -0,0 +1,102 @@
+#ifndef FLUTTER_SEARCH_INDEX_H_
+#define FLUTTER_SEARCH_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "card_store.h"
+
+// Where a query term occurs in a card: a byte range of the question, the
+// answer, or one of the card's tag names.
+struct SearchMatch {
+  uint32_t offset;  // into the field's text (for kTag, into the tag name)
+  uint16_t length;
+  uint8_t field;    // SearchIndex::Field
+  uint8_t tag;      // for kTag, index into the card's tags
+};
+
+// A pre-cut excerpt of a field: begin/length are a byte range of the field's
+// text, snapped to word and UTF-8 boundaries.
+struct Snippet {
+  uint32_t begin;
+  uint32_t length;
+  bool clipped_head;  // text was cut before begin
+  bool clipped_tail;  // and after begin + length
+};
+
+// Positional inverted index over a CardStore's questions, answers and tag
+// names. Words are runs of ASCII letters and digits, plus any non-ASCII
+// UTF-8 bytes, compared ASCII case-insensitively. Each occurrence is kept
+// with its byte position, so a search can report where every term matched
+// and cut snippets around the matches without rescanning the text.
+//
+// Terms are kept sorted, so the last word of a query also matches as a
+// prefix ("tre" finds "tree" and "trie") for search as you type.
+class SearchIndex {
+ public:
+  enum Field : uint8_t { kQuestion = 0, kAnswer = 1, kTag = 2 };
+
+  // A parsed query: for each of its words, the range of matching terms.
+  struct Query {
+    std::vector<std::pair<uint32_t, uint32_t>> terms;
+    bool empty() const { return terms.empty(); }
+  };
+
+  // Rebuilds the index from store.
+  void Build(const CardStore& store);
+
+  // True if the index was built from store as it is now.
+  bool IsCurrent(const CardStore& store) const {
+    return built_ && version_ == store.text_version();
+  }
+
+  // Returns false if query has no words or one of them matches no term.
+  bool Parse(const char* query, size_t size, Query* out) const;
+
+  // Slots of the cards containing every word of query, in deck order.
+  void Search(const Query& query, std::vector<uint32_t>* slots) const;
+
+  // Every occurrence of query's words in the card at slot, ordered by field
+  // and offset.
+  void Matches(const Query& query, uint32_t slot,
+               std::vector<SearchMatch>* out) const;
+
+  // Cuts up to max_bytes of text around the first of matches, which must be
+  // sorted by offset and belong to this text (count may be 0).
+  static Snippet Cut(StrRef text, const SearchMatch* matches, size_t count,
+                     size_t max_bytes);
+
+  size_t term_count() const { return term_offsets_.size(); }
+  size_t posting_count() const { return postings_.size(); }
+
+ private:
+  struct Posting {
+    uint32_t slot;
+    uint32_t offset;
+    uint16_t length;
+    uint8_t field;
+    uint8_t tag;
+  };
+
+  StrRef term(uint32_t id) const {
+    return {terms_.data() + term_offsets_[id], term_lengths_[id]};
+  }
+  uint32_t LowerBound(const char* data, size_t size) const;
+
+  bool built_ = false;
+  uint64_t version_ = 0;
+  size_t card_count_ = 0;
+  // Terms in sorted order, lowercased, in one heap.
+  std::string terms_;
+  std::vector<uint32_t> term_offsets_;
+  std::vector<uint32_t> term_lengths_;
+  // Postings of term t are postings_[posting_begin_[t], posting_begin_[t+1]),
+  // sorted by slot, then field and offset.
+  std::vector<uint32_t> posting_begin_;
+  std::vector<Posting> postings_;
+};
+
+#endif  // FLUTTER_SEARCH_INDEX_H_
@@ -0,0 +1,49 @@
+#include "startup_trace.h"
+
+#include <glib.h>
+
+#include <cstddef>
+
+namespace {
+
+constexpr size_t kMaxMarks = 32;
+
+struct Mark {
+  const char* phase;
+  gint64 time_us;
+  double deferred_ms;  // < 0: not deferred work
+};
+
+Mark marks[kMaxMarks];
+size_t mark_count = 0;
+bool reported = false;
+
+void Record(const char* phase, double deferred_ms) {
+  if (mark_count == kMaxMarks) return;
+  marks[mark_count++] = Mark{phase, g_get_monotonic_time(), deferred_ms};
+}
+
+}  // namespace
+
+void StartupTraceMark(const char* phase) { Record(phase, -1); }
+
+void StartupTraceDeferred(const char* phase, double milliseconds) {
+  Record(phase, milliseconds);
+}
+
+void StartupTraceReport() {
+  if (reported || mark_count == 0) return;
+  reported = true;
+  if (g_getenv("FLASHSPRINT_TRACE_STARTUP") == nullptr) return;
+
+  const gint64 start = marks[0].time_us;
+  for (size_t i = 0; i < mark_count; i++) {
+    double at = (marks[i].time_us - start) / 1000.0;
+    if (marks[i].deferred_ms < 0) {
+      g_printerr("startup: %8.1f ms  %s\n", at, marks[i].phase);
+    } else {
+      g_printerr("startup: %8.1f ms  %s (%.1f ms off the first-frame path)\n",
+                 at, marks[i].phase, marks[i].deferred_ms);
+    }
+  }
+}
@@ -0,0 +1,25 @@
+#ifndef FLUTTER_STARTUP_TRACE_H_
+#define FLUTTER_STARTUP_TRACE_H_
+
+// Startup trace for the runner: named timestamps from main() onwards,
+// printed when FLASHSPRINT_TRACE_STARTUP is set in the environment, e.g.
+//
+//   startup:    0.0 ms  main
+//   startup:   41.7 ms  view created
+//   startup:  212.3 ms  first frame
+//   startup:  215.9 ms  deferred plugins registered (3.4 ms off the
+//                       first-frame path)
+//
+// Marks are cheap and recorded unconditionally; only the report is gated.
+
+// Records phase (a string literal) at the current monotonic time.
+void StartupTraceMark(const char* phase);
+
+// Records the duration of work that used to run before the first frame and
+// now runs after it, to be reported alongside the mark that ends it.
+void StartupTraceDeferred(const char* phase, double milliseconds);
+
+// Prints the marks recorded so far, once.
+void StartupTraceReport();
+
+#endif  // FLUTTER_STARTUP_TRACE_H_
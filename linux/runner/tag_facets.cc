@@ -0,0 +1,109 @@
+#include "tag_facets.h"
+
+#include <algorithm>
+
+namespace {
+
+// A tag gets a bitmap once it is on 1 in kDenseRatio cards: its bitmap then
+// takes no more room than its postings would.
+constexpr size_t kDenseRatio = 32;
+
+}  // namespace
+
+void TagFacets::Build(const CardStore& store) {
+  const size_t cards = store.size();
+  words_ = (cards + 63) / 64;
+  bitmap_tags_.clear();
+  bitmaps_.clear();
+  sparse_tags_.clear();
+  sparse_begin_.assign(1, 0);
+  sparse_slots_.clear();
+  for (uint32_t tag = 0; tag < store.tag_count(); ++tag) {
+    const std::vector<uint32_t>& postings = store.tag_postings(tag);
+    if (postings.empty()) continue;
+    if (postings.size() * kDenseRatio >= cards) {
+      bitmap_tags_.push_back(tag);
+      bitmaps_.resize(bitmaps_.size() + words_, 0);
+      uint64_t* bits = bitmaps_.data() + bitmaps_.size() - words_;
+      for (uint32_t slot : postings) bits[slot / 64] |= uint64_t{1} << (slot % 64);
+    } else {
+      // A card listing a tag twice has two postings; keep one.
+      size_t begin = sparse_slots_.size();
+      sparse_slots_.insert(sparse_slots_.end(), postings.begin(), postings.end());
+      std::sort(sparse_slots_.begin() + begin, sparse_slots_.end());
+      sparse_slots_.erase(
+          std::unique(sparse_slots_.begin() + begin, sparse_slots_.end()),
+          sparse_slots_.end());
+      sparse_tags_.push_back(tag);
+      sparse_begin_.push_back(static_cast<uint32_t>(sparse_slots_.size()));
+    }
+  }
+  version_ = store.text_version();
+  built_ = true;
+}
+
+void TagFacets::Count(const CardStore& store,
+                      const std::vector<uint32_t>& slots, size_t limit,
+                      std::vector<Facet>* out) const {
+  out->clear();
+  if (slots.empty() || limit == 0) return;
+  std::vector<uint32_t> counts(store.tag_count(), 0);
+
+  // Visiting each result card's tags costs about its share of all tag refs;
+  // the bitmaps cost a pass over each bitmap plus the rare tags' postings.
+  const size_t direct_cost =
+      slots.size() * store.tag_refs().size() / std::max<size_t>(store.size(), 1);
+  const size_t bitmap_cost =
+      slots.size() + bitmap_tags_.size() * words_ + sparse_slots_.size();
+  if (direct_cost <= bitmap_cost) {
+    const std::vector<uint32_t>& refs = store.tag_refs();
+    std::vector<uint32_t> seen(store.tag_count(), CardStore::kNoSlot);
+    for (uint32_t slot : slots) {
+      const CardRecord& card = store.card(slot);
+      for (uint32_t i = 0; i < card.tag_count; ++i) {
+        uint32_t tag = refs[card.tags_begin + i];
+        if (seen[tag] == slot) continue;  // listed twice
+        seen[tag] = slot;
+        ++counts[tag];
+      }
+    }
+  } else {
+    std::vector<uint64_t> result(words_, 0);
+    uint32_t lo = slots.front(), hi = slots.front();
+    for (uint32_t slot : slots) {
+      result[slot / 64] |= uint64_t{1} << (slot % 64);
+      lo = std::min(lo, slot);
+      hi = std::max(hi, slot);
+    }
+    const size_t first = lo / 64, last = hi / 64 + 1;
+    for (size_t i = 0; i < bitmap_tags_.size(); ++i) {
+      const uint64_t* bits = bitmaps_.data() + i * words_;
+      uint32_t n = 0;
+      for (size_t w = first; w < last; ++w) {
+        n += static_cast<uint32_t>(__builtin_popcountll(bits[w] & result[w]));
+      }
+      counts[bitmap_tags_[i]] = n;
+    }
+    for (size_t i = 0; i < sparse_tags_.size(); ++i) {
+      uint32_t n = 0;
+      for (uint32_t k = sparse_begin_[i]; k < sparse_begin_[i + 1]; ++k) {
+        uint32_t slot = sparse_slots_[k];
+        n += (result[slot / 64] >> (slot % 64)) & 1;
+      }
+      counts[sparse_tags_[i]] = n;
+    }
+  }
+
+  for (uint32_t tag = 0; tag < counts.size(); ++tag) {
+    if (counts[tag] > 0) out->push_back({tag, counts[tag]});
+  }
+  auto by_count = [](const Facet& a, const Facet& b) {
+    return a.count != b.count ? a.count > b.count : a.tag < b.tag;
+  };
+  if (out->size() > limit) {
+    std::partial_sort(out->begin(), out->begin() + limit, out->end(), by_count);
+    out->resize(limit);
+  } else {
+    std::sort(out->begin(), out->end(), by_count);
+  }
+}
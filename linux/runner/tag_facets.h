@@ -0,0 +1,53 @@
+#ifndef FLUTTER_TAG_FACETS_H_
+#define FLUTTER_TAG_FACETS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "card_store.h"
+
+// Tag counts over a set of cards, for faceting search results: how many of
+// the matching cards carry each tag. Tags on at least 1/32 of the deck keep a
+// bitmap over card slots (no bigger than their postings) and are counted by
+// ANDing it with the result set's bitmap and taking popcounts; rarer tags keep
+// sorted postings and test one bit per card. Small result sets skip both and
+// count the tags of each card directly.
+class TagFacets {
+ public:
+  struct Facet {
+    uint32_t tag;
+    uint32_t count;
+  };
+
+  // Rebuilds the bitmaps and postings from store.
+  void Build(const CardStore& store);
+
+  // True if built from store as it is now.
+  bool IsCurrent(const CardStore& store) const {
+    return built_ && version_ == store.text_version();
+  }
+
+  // The (up to) limit tags carried by most of the cards in slots, which must
+  // be distinct, ordered by count and then tag id. Tags with no card in
+  // slots are left out.
+  void Count(const CardStore& store, const std::vector<uint32_t>& slots,
+             size_t limit, std::vector<Facet>* out) const;
+
+  size_t bitmap_tag_count() const { return bitmap_tags_.size(); }
+
+ private:
+  bool built_ = false;
+  uint64_t version_ = 0;
+  size_t words_ = 0;  // per bitmap
+  // Tags with a bitmap; bitmap i is bitmaps_[i * words_, (i + 1) * words_).
+  std::vector<uint32_t> bitmap_tags_;
+  std::vector<uint64_t> bitmaps_;
+  // Other tags: postings of sparse_tags_[i] are
+  // sparse_slots_[sparse_begin_[i], sparse_begin_[i + 1]), sorted.
+  std::vector<uint32_t> sparse_tags_;
+  std::vector<uint32_t> sparse_begin_;
+  std::vector<uint32_t> sparse_slots_;
+};
+
+#endif  // FLUTTER_TAG_FACETS_H_